@@ -0,0 +1,333 @@
+#ifndef ASYNC_MESH_UTILITY_H
+#define ASYNC_MESH_UTILITY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "window_utility.h"
+#include "mesh_utility.h"
+#include "thread_utility.h"
+
+/*
+    Asynchronous mesh loading
+
+    AsyncMesh_Load hands a build function to a pool of worker threads. The
+    function fills a scratch Mesh the way the Mesh_Set* functions do (or
+    decodes a file into it), so the target mesh is never touched off the
+    render thread. Finished geometry goes to an upload thread that owns a
+    hidden GLFW context shared with the window; it creates the buffers,
+    fills them and drops a fence.
+
+    AsyncMesh_Poll runs once per frame on the render thread. It never
+    blocks: meshes whose fence has signalled get their VAO (VAOs are not
+    shared between contexts) and become drawable, the rest wait for the
+    next frame. Until then mesh.initialized is 1 and Mesh_Draw skips it.
+
+    If the shared context can not be created, Poll uploads finished
+    geometry itself, at most upload_budget bytes per frame.
+
+    The target mesh must stay alive (and not move) until it is ready.
+    Loading into a mesh that already has GL objects deletes them when the
+    new ones take over.
+*/
+
+struct AsyncMeshJob
+{
+    Mesh* target = nullptr;
+    std::function<void(Mesh&)> build;
+
+    Mesh staging;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    GLsync fence = 0;
+};
+
+struct AsyncMeshLoader
+{
+    GLFWwindow* context = nullptr;      // shared upload context, null on the fallback path
+
+    std::vector<std::thread> workers;
+    std::thread uploader;
+
+    std::mutex mutex;
+    std::condition_variable build_ready;
+    std::condition_variable upload_ready;
+    std::deque<std::unique_ptr<AsyncMeshJob>> build_queue;
+    std::deque<std::unique_ptr<AsyncMeshJob>> upload_queue;
+    std::vector<std::unique_ptr<AsyncMeshJob>> uploaded;
+    bool running = false;
+
+    // render thread only
+    std::vector<std::unique_ptr<AsyncMeshJob>> in_flight;
+    size_t upload_budget = 8 << 20;
+    std::atomic<unsigned int> pending{0};
+};
+
+namespace async_mesh_detail
+{
+    static inline size_t VertexBytes(const Mesh& mesh)
+    {
+        return mesh.vertices.size() * sizeof(float);
+    }
+
+    static inline size_t IndexBytes(const Mesh& mesh)
+    {
+        return mesh.use_indices ? mesh.indices.size() * sizeof(unsigned int) : 0;
+    }
+
+    // buffers only, the VAO is made on the render thread
+    static inline void Upload(AsyncMeshJob& job)
+    {
+        // copy write target, binding the element array buffer without a VAO is not allowed in core
+        glGenBuffers(1, &job.VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, job.VBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, VertexBytes(job.staging), job.staging.vertices.data(), GL_STATIC_DRAW);
+
+        if (job.staging.use_indices)
+        {
+            glGenBuffers(1, &job.EBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, job.EBO);
+            glBufferData(GL_COPY_WRITE_BUFFER, IndexBytes(job.staging), job.staging.indices.data(), GL_STATIC_DRAW);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    static inline void Work(AsyncMeshLoader& loader)
+    {
+        while (true)
+        {
+            std::unique_ptr<AsyncMeshJob> job;
+            {
+                std::unique_lock<std::mutex> lock(loader.mutex);
+                loader.build_ready.wait(lock, [&]() { return !loader.running || !loader.build_queue.empty(); });
+                if (!loader.running) return;
+                job = std::move(loader.build_queue.front());
+                loader.build_queue.pop_front();
+            }
+
+            job->build(job->staging);
+            Mesh_ComputeBounds(job->staging, job->staging.bounds_min, job->staging.bounds_max);
+
+            std::lock_guard<std::mutex> lock(loader.mutex);
+            if (loader.context)
+            {
+                loader.upload_queue.push_back(std::move(job));
+                loader.upload_ready.notify_one();
+            }
+            else loader.uploaded.push_back(std::move(job));
+        }
+    }
+
+    static inline void UploadThread(AsyncMeshLoader& loader)
+    {
+        glfwMakeContextCurrent(loader.context);
+
+        while (true)
+        {
+            std::unique_ptr<AsyncMeshJob> job;
+            {
+                std::unique_lock<std::mutex> lock(loader.mutex);
+                loader.upload_ready.wait(lock, [&]() { return !loader.running || !loader.upload_queue.empty(); });
+                if (!loader.running) break;
+                job = std::move(loader.upload_queue.front());
+                loader.upload_queue.pop_front();
+            }
+
+            Upload(*job);
+
+            // the fence has to reach the GPU before another context can wait on it
+            glFlush();
+
+            std::lock_guard<std::mutex> lock(loader.mutex);
+            loader.uploaded.push_back(std::move(job));
+        }
+
+        glfwMakeContextCurrent(NULL);
+    }
+
+    // render thread, makes the target drawable
+    static inline void Finish(AsyncMeshJob& job)
+    {
+        Mesh& mesh = *job.target;
+        Mesh& staging = job.staging;
+
+        // a reload replaces whatever the mesh was drawing before
+        Mesh_Delete(mesh);
+
+        mesh.vertices = std::move(staging.vertices);
+        mesh.indices = std::move(staging.indices);
+        mesh.layout = staging.layout;
+        mesh.use_indices = staging.use_indices;
+        mesh.primitive = staging.primitive;
+        mesh.bounds_min = staging.bounds_min;
+        mesh.bounds_max = staging.bounds_max;
+        mesh.vertex_count = Mesh_VertexCount(mesh);
+        mesh.index_count = mesh.use_indices ? (unsigned int)mesh.indices.size() : 0;
+        mesh.vertex_capacity = mesh.vertex_count;
+        mesh.index_capacity = mesh.index_count;
+        mesh.VBO = job.VBO;
+        mesh.EBO = job.EBO;
+
+        glGenVertexArrays(1, &mesh.VAO);
+        Mesh_BindVertexArray(mesh.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        if (mesh.EBO) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        Mesh_SetAttributes(mesh.layout);
+        Mesh_BindVertexArray(0);
+
+        glDeleteSync(job.fence);
+        mesh.initialized = 0;
+    }
+}
+
+// call on the render thread after Window_Generate, returns -1 if no worker could start
+static inline int AsyncMesh_Init(AsyncMeshLoader& loader, Window& window)
+{
+    // a hidden 1x1 window is the portable way to get a shared context from GLFW
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    loader.context = glfwCreateWindow(1, 1, "", NULL, window.w);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (!loader.context)
+    {
+        std::cout << "No shared context, meshes upload on the render thread" << std::endl;
+    }
+
+    // the render thread keeps its context, the upload thread makes its own current
+    glfwMakeContextCurrent(window.w);
+
+    loader.running = true;
+
+    unsigned int count = Thread_Count() > 2 ? Thread_Count() - 2 : 1;
+    try
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            loader.workers.emplace_back(async_mesh_detail::Work, std::ref(loader));
+        }
+        if (loader.context) loader.uploader = std::thread(async_mesh_detail::UploadThread, std::ref(loader));
+    }
+    catch (const std::system_error&)
+    {
+        std::cout << "Failed to start mesh loader threads" << std::endl;
+        if (loader.workers.empty()) return -1;
+    }
+
+    return 0;
+}
+
+// queues build(scratch) on a worker, mesh becomes drawable in a later AsyncMesh_Poll
+static inline void AsyncMesh_Load(AsyncMeshLoader& loader, Mesh& mesh, std::function<void(Mesh&)> build)
+{
+    std::unique_ptr<AsyncMeshJob> job(new AsyncMeshJob());
+    job->target = &mesh;
+    job->build = std::move(build);
+
+    mesh.initialized = 1;
+    loader.pending++;
+
+    std::lock_guard<std::mutex> lock(loader.mutex);
+    loader.build_queue.push_back(std::move(job));
+    loader.build_ready.notify_one();
+}
+
+// once per frame on the render thread, never waits, returns how many meshes became ready
+static inline unsigned int AsyncMesh_Poll(AsyncMeshLoader& loader)
+{
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        for (std::unique_ptr<AsyncMeshJob>& job : loader.uploaded) loader.in_flight.push_back(std::move(job));
+        loader.uploaded.clear();
+    }
+
+    // fallback path, upload here within the frame budget
+    if (!loader.context)
+    {
+        size_t spent = 0;
+        for (std::unique_ptr<AsyncMeshJob>& job : loader.in_flight)
+        {
+            if (job->fence) continue;
+
+            // always move at least one mesh so a large one can not stall the queue
+            size_t bytes = async_mesh_detail::VertexBytes(job->staging) + async_mesh_detail::IndexBytes(job->staging);
+            if (spent > 0 && spent + bytes > loader.upload_budget) break;
+
+            async_mesh_detail::Upload(*job);
+            spent += bytes;
+        }
+    }
+
+    unsigned int ready = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < loader.in_flight.size(); ++i)
+    {
+        std::unique_ptr<AsyncMeshJob>& job = loader.in_flight[i];
+
+        bool done = job->fence && glClientWaitSync(job->fence, 0, 0) != GL_TIMEOUT_EXPIRED;
+        if (done)
+        {
+            async_mesh_detail::Finish(*job);
+            ready++;
+        }
+        else loader.in_flight[kept++] = std::move(job);
+    }
+    loader.in_flight.resize(kept);
+
+    loader.pending -= ready;
+    return ready;
+}
+
+// meshes queued but not yet drawable
+static inline unsigned int AsyncMesh_Pending(const AsyncMeshLoader& loader)
+{
+    return loader.pending;
+}
+
+// stops the threads, meshes that never finished go back to initialized = -1
+static inline void AsyncMesh_Delete(AsyncMeshLoader& loader)
+{
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        loader.running = false;
+    }
+    loader.build_ready.notify_all();
+    loader.upload_ready.notify_all();
+
+    for (std::thread& worker : loader.workers) worker.join();
+    if (loader.uploader.joinable()) loader.uploader.join();
+    loader.workers.clear();
+
+    for (std::unique_ptr<AsyncMeshJob>& job : loader.uploaded) loader.in_flight.push_back(std::move(job));
+    for (std::unique_ptr<AsyncMeshJob>& job : loader.upload_queue) loader.in_flight.push_back(std::move(job));
+    for (std::unique_ptr<AsyncMeshJob>& job : loader.build_queue) loader.in_flight.push_back(std::move(job));
+
+    for (std::unique_ptr<AsyncMeshJob>& job : loader.in_flight)
+    {
+        if (job->fence) glDeleteSync(job->fence);
+        if (job->VBO) glDeleteBuffers(1, &job->VBO);
+        if (job->EBO) glDeleteBuffers(1, &job->EBO);
+        job->target->initialized = -1;
+    }
+
+    loader.uploaded.clear();
+    loader.upload_queue.clear();
+    loader.build_queue.clear();
+    loader.in_flight.clear();
+    loader.pending = 0;
+
+    if (loader.context) glfwDestroyWindow(loader.context);
+    loader.context = nullptr;
+}
+
+#endif
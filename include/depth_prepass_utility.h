@@ -0,0 +1,276 @@
+#ifndef DEPTH_PREPASS_UTILITY_H
+#define DEPTH_PREPASS_UTILITY_H
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <glad/glad.h>
+#include "math_utility.h"
+#include "mesh_utility.h"
+#include "mesh_process_utility.h"
+#include "shader_utility.h"
+
+/*
+    Depth pre-pass and draw ordering
+
+    Opaque draws are queued with DepthPrepass_Add and drawn by
+    DepthPrepass_Submit, which sorts them by view depth first. With the
+    pre-pass enabled every draw is rendered twice:
+
+    1. depth only, front to back, colour writes off, with a shader that
+       reads nothing but the position. Each mesh gets a packed position
+       stream (12 bytes a vertex, 8 quantized) made from its CPU copy, so
+       this pass fetches a fraction of the vertex data.
+    2. colour, sorted by shader then depth, with GL_EQUAL and depth writes
+       off. Only the visible surface passes, each pixel is shaded once.
+
+    GL_EQUAL needs both passes to produce the same depth bit for bit, so
+    the colour pass vertex shaders must compute gl_Position with the same
+    expression as shaders/depth_vertex.glsl and declare it invariant. All
+    the engine's vertex shaders declare it; vertex.glsl, lit_vertex.glsl,
+    quantized_vertex.glsl and material_vertex.glsl also take uModel and
+    can be queued here. indirect_vertex.glsl reads its model matrix from a
+    buffer and is drawn by the indirect renderer, not through this pass.
+
+    With the pre-pass disabled there is a single pass sorted front to back,
+    which still lets early-Z reject most hidden fragments.
+
+    Streams are built the first time a mesh is drawn and kept; call
+    DepthPrepass_Forget after editing a mesh's positions and before
+    deleting it. Meshes without a CPU copy, pooled meshes and meshes that
+    are nothing but positions draw their depth pass from their own VAO.
+*/
+
+struct DepthPrepassDraw
+{
+    Shader* shader;
+    const Mesh* mesh;
+    Matrix4 model;
+    Vector4 colour;
+    float depth;        // view space distance of the bounds centre
+};
+
+// packed positions of one mesh, indices come from the mesh's own EBO
+struct DepthStream
+{
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+};
+
+struct DepthPrepass
+{
+    bool enabled = true;
+
+    Shader depth_shader;
+    Shader depth_shader_quantized;
+
+    std::vector<DepthPrepassDraw> draws;
+    std::vector<unsigned int> order;
+    std::unordered_map<const Mesh*, DepthStream> streams;
+};
+
+namespace depth_prepass_detail
+{
+    // VAO the depth pass reads, 0 draws from the mesh's own
+    static inline unsigned int StreamVAO(DepthPrepass& prepass, const Mesh& mesh)
+    {
+        auto found = prepass.streams.find(&mesh);
+        if (found != prepass.streams.end()) return found->second.VAO;
+
+        DepthStream stream;
+        bool packed = (mesh.layout & ~(unsigned int)(MESH_ATTRIB_POSITION | MESH_ATTRIB_QUANTIZED)) == 0;
+        if (mesh.pool || packed || mesh.vertices.empty() || Mesh_VertexCount(mesh) != mesh.vertex_count)
+        {
+            prepass.streams[&mesh] = stream;
+            return 0;
+        }
+
+        // quantized positions are 4 shorts, 2 floats worth
+        int stride = Mesh_VertexStride(mesh.layout);
+        int floats = (mesh.layout & MESH_ATTRIB_QUANTIZED) ? 2 : 3;
+        std::vector<float> positions((size_t)mesh.vertex_count * floats);
+        for (size_t i = 0; i < mesh.vertex_count; ++i)
+        {
+            for (int k = 0; k < floats; ++k) positions[i * floats + k] = mesh.vertices[i * stride + k];
+        }
+
+        glGenVertexArrays(1, &stream.VAO);
+        glGenBuffers(1, &stream.VBO);
+
+        Mesh_BindVertexArray(stream.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.VBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+        if (mesh.use_indices) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        Mesh_SetAttributes(mesh.layout & (MESH_ATTRIB_POSITION | MESH_ATTRIB_QUANTIZED));
+        Mesh_BindVertexArray(0);
+
+        prepass.streams[&mesh] = stream;
+        return stream.VAO;
+    }
+
+    static inline void DrawDepth(DepthPrepass& prepass, const Mesh& mesh)
+    {
+        unsigned int vao = StreamVAO(prepass, mesh);
+        if (vao == 0)
+        {
+            Mesh_Draw(mesh);
+            return;
+        }
+
+        Mesh_SetPrimitiveRestart(mesh.primitive != GL_TRIANGLES);
+        Mesh_BindVertexArray(vao);
+
+        if (mesh.use_indices)
+            glDrawElements(mesh.primitive, mesh.index_count, GL_UNSIGNED_INT, 0);
+        else
+            glDrawArrays(mesh.primitive, 0, mesh.vertex_count);
+        Mesh_SetPrimitiveRestart(false);
+    }
+}
+
+// builds the depth only programs, throws like Shader_Init if the shader files are missing
+static inline void DepthPrepass_Init(DepthPrepass& prepass, bool enabled = true)
+{
+    prepass.enabled = enabled;
+    Shader_Init(prepass.depth_shader, "shaders/depth_vertex.glsl", "shaders/depth_fragment.glsl");
+    Shader_Init(prepass.depth_shader_quantized, "shaders/depth_vertex.glsl", "shaders/depth_fragment.glsl", "#define QUANTIZED\n");
+    prepass.draws.clear();
+}
+
+// starts a new frame of draws
+static inline void DepthPrepass_Begin(DepthPrepass& prepass)
+{
+    prepass.draws.clear();
+}
+
+// queues one opaque draw, the shader takes uModel, uView, uProjection and uColor like shaders/vertex.glsl
+// and must declare gl_Position invariant (see the list above)
+static inline void DepthPrepass_Add(DepthPrepass& prepass, Shader& shader, const Mesh& mesh, const Matrix4& model, const Vector4& colour)
+{
+    if (mesh.initialized != 0) return;
+    prepass.draws.push_back({&shader, &mesh, model, colour, 0.0f});
+}
+
+// draws everything queued since DepthPrepass_Begin, returns the number of draws
+static inline unsigned int DepthPrepass_Submit(DepthPrepass& prepass, const Matrix4& view, const Matrix4& projection)
+{
+    using namespace depth_prepass_detail;
+
+    unsigned int count = (unsigned int)prepass.draws.size();
+    if (count == 0) return 0;
+
+    // the camera looks down -z, so depth is minus the view space z of the centre
+    for (DepthPrepassDraw& draw : prepass.draws)
+    {
+        Vector3 c = Math_Vec3Scale(Math_Vec3Add(draw.mesh->bounds_min, draw.mesh->bounds_max), 0.5f);
+        const float* m = draw.model.m;
+        Vector3 world = {m[0] * c.x + m[4] * c.y + m[8] * c.z + m[12],
+                         m[1] * c.x + m[5] * c.y + m[9] * c.z + m[13],
+                         m[2] * c.x + m[6] * c.y + m[10] * c.z + m[14]};
+        const float* v = view.m;
+        draw.depth = -(v[2] * world.x + v[6] * world.y + v[10] * world.z + v[14]);
+    }
+
+    prepass.order.resize(count);
+    for (unsigned int i = 0; i < count; ++i) prepass.order[i] = i;
+
+    const std::vector<DepthPrepassDraw>& draws = prepass.draws;
+    auto front_to_back = [&](unsigned int a, unsigned int b) { return draws[a].depth < draws[b].depth; };
+
+    if (prepass.enabled)
+    {
+        std::sort(prepass.order.begin(), prepass.order.end(), front_to_back);
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+
+        Shader* bound = nullptr;
+        for (unsigned int i : prepass.order)
+        {
+            const DepthPrepassDraw& draw = draws[i];
+            Shader* shader = (draw.mesh->layout & MESH_ATTRIB_QUANTIZED) ? &prepass.depth_shader_quantized : &prepass.depth_shader;
+            if (shader != bound)
+            {
+                Shader_Enable(*shader);
+                Shader_SetUniformMat4(*shader, "uView", view);
+                Shader_SetUniformMat4(*shader, "uProjection", projection);
+                bound = shader;
+            }
+
+            Shader_SetUniformMat4(*shader, "uModel", draw.model);
+            if (draw.mesh->layout & MESH_ATTRIB_QUANTIZED) MeshProcess_SetDecodeUniforms(*shader, *draw.mesh);
+            DrawDepth(prepass, *draw.mesh);
+        }
+        Mesh_BindVertexArray(0);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_EQUAL);
+
+        // hidden surfaces are rejected either way now, so group by shader
+        std::sort(prepass.order.begin(), prepass.order.end(), [&](unsigned int a, unsigned int b)
+        {
+            if (draws[a].shader->program != draws[b].shader->program) return draws[a].shader->program < draws[b].shader->program;
+            return draws[a].depth < draws[b].depth;
+        });
+    }
+    else std::sort(prepass.order.begin(), prepass.order.end(), front_to_back);
+
+    unsigned int bound = 0;
+    for (unsigned int i : prepass.order)
+    {
+        const DepthPrepassDraw& draw = draws[i];
+        Shader& shader = *draw.shader;
+        if (shader.program != bound)
+        {
+            Shader_Enable(shader);
+            Shader_SetUniformMat4(shader, "uView", view);
+            Shader_SetUniformMat4(shader, "uProjection", projection);
+            bound = shader.program;
+        }
+
+        Shader_SetUniformMat4(shader, "uModel", draw.model);
+        Shader_SetUniform4f(shader, "uColor", draw.colour);
+        if (draw.mesh->layout & MESH_ATTRIB_QUANTIZED) MeshProcess_SetDecodeUniforms(shader, *draw.mesh);
+        Mesh_Draw(*draw.mesh);
+    }
+
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    Shader_Disable();
+    return count;
+}
+
+// drops the mesh's position stream, call after editing its positions and before Mesh_Delete
+static inline void DepthPrepass_Forget(DepthPrepass& prepass, const Mesh& mesh)
+{
+    auto found = prepass.streams.find(&mesh);
+    if (found == prepass.streams.end()) return;
+
+    DepthStream& stream = found->second;
+    if (stream.VAO == mesh_detail::bound_vao) Mesh_BindVertexArray(0);
+    if (stream.VAO) glDeleteVertexArrays(1, &stream.VAO);
+    if (stream.VBO) glDeleteBuffers(1, &stream.VBO);
+    prepass.streams.erase(found);
+}
+
+static inline void DepthPrepass_Delete(DepthPrepass& prepass)
+{
+    Mesh_BindVertexArray(0);
+    for (auto& entry : prepass.streams)
+    {
+        if (entry.second.VAO) glDeleteVertexArrays(1, &entry.second.VAO);
+        if (entry.second.VBO) glDeleteBuffers(1, &entry.second.VBO);
+    }
+    prepass.streams.clear();
+    prepass.draws.clear();
+    prepass.order.clear();
+
+    Shader_Delete(prepass.depth_shader);
+    Shader_Delete(prepass.depth_shader_quantized);
+}
+
+#endif
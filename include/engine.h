@@ -17,6 +17,27 @@
 #include "camera_utility.h"
 #include "transform_utility.h"
 #include "time_utility.h"
+#include "thread_utility.h"
+#include "simd_utility.h"
+#include "obj_utility.h"
+#include "mesh_cache_utility.h"
+#include "gltf_utility.h"
+#include "geometry_pool_utility.h"
+#include "indirect_utility.h"
+#include "stream_utility.h"
+#include "async_mesh_utility.h"
+#include "mesh_process_utility.h"
+#include "frustum_utility.h"
+#include "static_batch_utility.h"
+#include "mesh_memory_utility.h"
+#include "shader_variant_utility.h"
+#include "shader_batch_utility.h"
+#include "shader_reload_utility.h"
+#include "shader_reflect_utility.h"
+#include "material_utility.h"
+#include "depth_prepass_utility.h"
+#include "frame_graph_utility.h"
+#include "shadow_utility.h"
 
 // Engine specific utilities will be defined here
 
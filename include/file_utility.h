@@ -1,8 +1,16 @@
 #ifndef FILE_UTILITY_H
 #define FILE_UTILITY_H
 
+#include <errno.h>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 static inline std::string LoadTextFile(const char* name)
 {
@@ -25,4 +33,96 @@ static inline std::string LoadTextFile(const char* name)
     return contents;
 }
 
+// read-only view of a whole file mapped into memory
+struct MappedFile
+{
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+// maps the file read-only, pages are faulted in by the OS as they are touched
+// an empty file maps to { nullptr, 0 }
+static inline MappedFile File_Map(const char* name)
+{
+    int fd = open(name, O_RDONLY);
+    if (fd == -1)
+    {
+        throw(std::ios_base::failure(std::string("Error opening file: ") + std::string(name)));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        close(fd);
+        throw(std::ios_base::failure(std::string("Error reading file size: ") + std::string(name)));
+    }
+
+    MappedFile file;
+    file.size = (size_t)st.st_size;
+
+    if (file.size > 0)
+    {
+        void* ptr = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            close(fd);
+            throw(std::ios_base::failure(std::string("Error mapping file: ") + std::string(name)));
+        }
+
+        // we read front to back
+        madvise(ptr, file.size, MADV_SEQUENTIAL);
+        file.data = (const char*)ptr;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+
+    return file;
+}
+
+static inline void File_Unmap(MappedFile& file)
+{
+    if (file.data) munmap((void*)file.data, file.size);
+
+    file.data = nullptr;
+    file.size = 0;
+}
+
+// directory part of a path including the trailing slash, empty if there is none
+static inline std::string File_Directory(const char* name)
+{
+    std::string path(name);
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return std::string();
+    return path.substr(0, slash + 1);
+}
+
+// true for an existing regular file
+static inline bool File_Exists(const char* name)
+{
+    struct stat info;
+    return stat(name, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+// absolute path with . and .. and symlinks resolved, the path unchanged if it does not exist
+static inline std::string File_Canonical(const char* name)
+{
+    char resolved[PATH_MAX];
+    if (!realpath(name, resolved)) return std::string(name);
+    return resolved;
+}
+
+// creates the directory and any missing parents, returns -1 if one could not be made
+static inline int File_MakeDirectory(const char* name)
+{
+    std::string path(name);
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+    {
+        std::string part = path.substr(0, slash);
+        if (!part.empty() && mkdir(part.c_str(), 0755) == -1 && errno != EEXIST) return -1;
+        if (slash == std::string::npos) break;
+    }
+    return 0;
+}
+
 #endif
\ No newline at end of file
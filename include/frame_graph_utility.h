@@ -0,0 +1,805 @@
+#ifndef FRAME_GRAPH_UTILITY_H
+#define FRAME_GRAPH_UTILITY_H
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <glad/glad.h>
+#include "math_utility.h"
+
+/*
+    Frame graph
+
+    A frame is described before anything is drawn: FrameGraph_AddPass
+    registers a pass with a function that does the drawing, and the pass
+    declares which textures and buffers it reads and writes. Textures a
+    pass writes with FrameGraph_Write become its framebuffer attachments.
+    The graph is rebuilt every frame (FrameGraph_Begin); the GL objects
+    behind it are kept between frames.
+
+    FrameGraph_Compile then
+    - culls passes whose results nothing uses. Writing an imported
+      resource (the backbuffer, a texture owned elsewhere) or being marked
+      with FrameGraph_SetSideEffect keeps a pass, and a pass is kept when a
+      kept pass after it reads what it wrote. A write that clears or fully
+      overwrites (FRAME_GRAPH_CLEAR, FRAME_GRAPH_DONT_CARE) the whole
+      resource ends the need for whatever was written before it; one that
+      covers a single layer of an array does not.
+    - orders the passes. Declaration order is always valid; passes that do
+      not depend on each other are moved next to passes with the same
+      attachments so they share a framebuffer bind.
+    - maps transient resources onto real GL objects. Lifetimes run from a
+      resource's first to last use in that order, and resources whose
+      lifetimes do not overlap share one object: textures when their
+      size, format and layer count match (GL cannot alias storage across
+      formats), buffers when the shared buffer is big enough.
+
+    FrameGraph_Execute binds a cached framebuffer per attachment set, only
+    when it changes, and clears only what is written with
+    FRAME_GRAPH_CLEAR, every attachment of a pass in one go. The first
+    write of a transient resource must clear or overwrite it, with LOAD it
+    holds whatever the last resource aliased onto it left there.
+
+    Pass functions get the graph and look up the GL objects of what they
+    declared with FrameGraph_Texture / FrameGraph_Buffer. Objects not used
+    for FRAME_GRAPH_KEEP_FRAMES frames are deleted. Framebuffers are cached
+    by attachment, so an imported texture must outlive the graph or be
+    followed by FrameGraph_Delete once it is gone.
+*/
+
+static constexpr unsigned int FRAME_GRAPH_NONE = 0xFFFFFFFFu;
+static constexpr uint64_t FRAME_GRAPH_KEEP_FRAMES = 8;
+
+enum FrameGraphLoad
+{
+    FRAME_GRAPH_LOAD,           // keep what earlier passes wrote
+    FRAME_GRAPH_CLEAR,          // clear before the pass runs
+    FRAME_GRAPH_DONT_CARE       // the pass overwrites every pixel, nothing to keep or clear
+};
+
+struct FrameGraphTextureDesc
+{
+    int width = 0;
+    int height = 0;
+    GLenum format = GL_RGBA8;   // colour, or a GL_DEPTH_COMPONENT* / depth stencil format
+    int layers = 1;             // more than one makes a GL_TEXTURE_2D_ARRAY
+};
+
+struct FrameGraph;
+
+struct FrameGraphResource
+{
+    std::string name;
+    bool buffer = false;
+    bool imported = false;
+    bool backbuffer = false;
+    FrameGraphTextureDesc desc;
+    size_t size = 0;            // buffers only
+    unsigned int object = 0;    // GL texture or buffer, transient ones get theirs when compiled
+    int first = -1;             // positions in the execution order
+    int last = -1;
+};
+
+struct FrameGraphAccess
+{
+    unsigned int resource;
+    bool write;
+    bool attachment;            // written through the pass's framebuffer
+    FrameGraphLoad load;
+    int layer;                  // of an array texture, -1 attaches every layer
+};
+
+struct FrameGraphPass
+{
+    std::string name;
+    std::function<void(FrameGraph&)> execute;
+    std::vector<FrameGraphAccess> accesses;
+    Vector4 clear_colour = {0.0f, 0.0f, 0.0f, 1.0f};
+    float clear_depth = 1.0f;
+    bool side_effect = false;
+    bool culled = false;
+};
+
+// a GL object transient resources are mapped onto
+struct FrameGraphObject
+{
+    bool buffer = false;
+    FrameGraphTextureDesc desc;
+    size_t size = 0;
+    unsigned int object = 0;
+    int free_from = 0;          // first position this frame it can be handed out again
+    uint64_t last_frame = 0;
+};
+
+struct FrameGraphStats
+{
+    unsigned int passes = 0;
+    unsigned int culled = 0;
+    unsigned int transient = 0;         // transient resources used this frame
+    unsigned int objects = 0;           // GL objects they were mapped onto
+    unsigned int created = 0;           // of which created this frame
+    unsigned int framebuffer_binds = 0;
+    unsigned int clears = 0;
+};
+
+struct FrameGraph
+{
+    // rebuilt every frame
+    std::vector<FrameGraphResource> resources;
+    std::vector<FrameGraphPass> passes;
+    std::vector<unsigned int> order;
+    bool compiled = false;
+
+    // kept between frames
+    std::vector<FrameGraphObject> objects;
+    std::map<std::vector<unsigned int>, unsigned int> framebuffers;    // attachment (object, layer + 1) pairs -> FBO
+    uint64_t frame = 0;
+
+    FrameGraphStats stats;
+};
+
+namespace frame_graph_detail
+{
+    static inline bool IsDepth(GLenum format)
+    {
+        return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F ||
+               format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8 || format == GL_DEPTH_COMPONENT;
+    }
+
+    static inline bool HasStencil(GLenum format)
+    {
+        return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+    }
+
+    // client format and type for allocating storage, the upload is NULL but has to be valid for the internal format
+    static inline void UploadFormat(GLenum internal_format, GLenum& format, GLenum& type)
+    {
+        switch (internal_format)
+        {
+        case GL_DEPTH24_STENCIL8:   format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; return;
+        case GL_DEPTH32F_STENCIL8:  format = GL_DEPTH_STENCIL; type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV; return;
+        case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F:
+            format = GL_DEPTH_COMPONENT; type = GL_FLOAT; return;
+
+        case GL_R8I: case GL_R16I: case GL_R32I:            format = GL_RED_INTEGER; type = GL_INT; return;
+        case GL_RG8I: case GL_RG16I: case GL_RG32I:         format = GL_RG_INTEGER; type = GL_INT; return;
+        case GL_RGB8I: case GL_RGB16I: case GL_RGB32I:      format = GL_RGB_INTEGER; type = GL_INT; return;
+        case GL_RGBA8I: case GL_RGBA16I: case GL_RGBA32I:   format = GL_RGBA_INTEGER; type = GL_INT; return;
+        case GL_R8UI: case GL_R16UI: case GL_R32UI:         format = GL_RED_INTEGER; type = GL_UNSIGNED_INT; return;
+        case GL_RG8UI: case GL_RG16UI: case GL_RG32UI:      format = GL_RG_INTEGER; type = GL_UNSIGNED_INT; return;
+        case GL_RGB8UI: case GL_RGB16UI: case GL_RGB32UI:   format = GL_RGB_INTEGER; type = GL_UNSIGNED_INT; return;
+        case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI: case GL_RGB10_A2UI:
+            format = GL_RGBA_INTEGER; type = GL_UNSIGNED_INT; return;
+
+        // every normalised and float colour format accepts float data
+        default: format = GL_RGBA; type = GL_FLOAT; return;
+        }
+    }
+
+    static inline bool SameDesc(const FrameGraphTextureDesc& a, const FrameGraphTextureDesc& b)
+    {
+        return a.width == b.width && a.height == b.height && a.format == b.format && a.layers == b.layers;
+    }
+
+    static inline unsigned int AddResource(FrameGraph& graph, const FrameGraphResource& resource)
+    {
+        graph.resources.push_back(resource);
+        graph.compiled = false;
+        return (unsigned int)graph.resources.size() - 1;
+    }
+
+    static inline void AddAccess(FrameGraph& graph, unsigned int pass, const FrameGraphAccess& access)
+    {
+        if (pass >= graph.passes.size() || access.resource >= graph.resources.size())
+        {
+            std::cout << "Frame graph access to an unknown pass or resource" << std::endl;
+            return;
+        }
+        graph.passes[pass].accesses.push_back(access);
+        graph.compiled = false;
+    }
+
+    // (object, layer + 1) of every attachment, the framebuffer cache key; empty for passes that draw nowhere
+    static inline std::vector<unsigned int> Attachments(const FrameGraph& graph, const FrameGraphPass& pass, bool logical)
+    {
+        std::vector<unsigned int> key;
+        for (const FrameGraphAccess& access : pass.accesses)
+        {
+            if (!access.attachment) continue;
+            key.push_back(logical ? access.resource : graph.resources[access.resource].object);
+            key.push_back((unsigned int)(access.layer + 1));
+        }
+        return key;
+    }
+
+    // walks back from the passes that must run, keeping what they need
+    static inline void Cull(FrameGraph& graph)
+    {
+        std::vector<bool> needed(graph.resources.size(), false);
+
+        for (size_t p = graph.passes.size(); p-- > 0; )
+        {
+            FrameGraphPass& pass = graph.passes[p];
+
+            bool keep = pass.side_effect;
+            for (const FrameGraphAccess& access : pass.accesses)
+            {
+                if (access.write && (graph.resources[access.resource].imported || needed[access.resource])) keep = true;
+            }
+            pass.culled = !keep;
+            if (!keep) continue;
+
+            // a clear or full overwrite of the whole resource makes earlier contents irrelevant,
+            // reads and loads need them; one layer of an array leaves the other layers needed
+            for (const FrameGraphAccess& access : pass.accesses)
+            {
+                bool whole = access.layer < 0 || graph.resources[access.resource].desc.layers <= 1;
+                if (access.write && whole && access.load != FRAME_GRAPH_LOAD) needed[access.resource] = false;
+            }
+            for (const FrameGraphAccess& access : pass.accesses)
+            {
+                if (!access.write || access.load == FRAME_GRAPH_LOAD) needed[access.resource] = true;
+            }
+        }
+    }
+
+    // topological order of the surviving passes, same attachments back to back where the dependencies allow
+    static inline void Order(FrameGraph& graph)
+    {
+        size_t count = graph.passes.size();
+        std::vector<std::vector<unsigned int>> after(count);
+        std::vector<unsigned int> incoming(count, 0);
+
+        // per resource: the last writer and who read since, in declaration order
+        std::vector<unsigned int> last_writer(graph.resources.size(), FRAME_GRAPH_NONE);
+        std::vector<std::vector<unsigned int>> readers(graph.resources.size());
+
+        auto edge = [&](unsigned int from, unsigned int to)
+        {
+            if (from == FRAME_GRAPH_NONE || from == to) return;
+            after[from].push_back(to);
+            incoming[to]++;
+        };
+
+        for (unsigned int p = 0; p < count; ++p)
+        {
+            if (graph.passes[p].culled) continue;
+
+            for (const FrameGraphAccess& access : graph.passes[p].accesses)
+            {
+                if (access.write) continue;
+                edge(last_writer[access.resource], p);
+                readers[access.resource].push_back(p);
+            }
+            for (const FrameGraphAccess& access : graph.passes[p].accesses)
+            {
+                if (!access.write) continue;
+                edge(last_writer[access.resource], p);
+                for (unsigned int reader : readers[access.resource]) edge(reader, p);
+                readers[access.resource].clear();
+                last_writer[access.resource] = p;
+            }
+        }
+
+        std::vector<bool> ready(count, false);
+        size_t remaining = 0;
+        for (unsigned int p = 0; p < count; ++p)
+        {
+            if (graph.passes[p].culled) continue;
+            remaining++;
+            ready[p] = incoming[p] == 0;
+        }
+
+        graph.order.clear();
+        std::vector<unsigned int> previous;
+        while (remaining > 0)
+        {
+            unsigned int pick = FRAME_GRAPH_NONE;
+            for (unsigned int p = 0; p < count; ++p)
+            {
+                if (!ready[p]) continue;
+                if (pick == FRAME_GRAPH_NONE) pick = p;
+                if (!previous.empty() && Attachments(graph, graph.passes[p], true) == previous)
+                {
+                    pick = p;
+                    break;
+                }
+            }
+
+            ready[pick] = false;
+            remaining--;
+            graph.order.push_back(pick);
+
+            std::vector<unsigned int> attachments = Attachments(graph, graph.passes[pick], true);
+            if (!attachments.empty()) previous = attachments;
+
+            for (unsigned int next : after[pick])
+            {
+                if (--incoming[next] == 0) ready[next] = true;
+            }
+        }
+    }
+
+    static inline unsigned int CreateTexture(const FrameGraphTextureDesc& desc)
+    {
+        GLenum target = desc.layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        GLenum format, type;
+        UploadFormat(desc.format, format, type);
+
+        unsigned int texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(target, texture);
+        if (desc.layers > 1) glTexImage3D(target, 0, desc.format, desc.width, desc.height, desc.layers, 0, format, type, NULL);
+        else glTexImage2D(target, 0, desc.format, desc.width, desc.height, 0, format, type, NULL);
+
+        // integer textures are incomplete with linear filtering
+        bool integer = type == GL_INT || type == GL_UNSIGNED_INT;
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, integer ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, integer ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(target, 0);
+        return texture;
+    }
+
+    // hands each transient resource an object nobody else uses during its lifetime
+    static inline void Allocate(FrameGraph& graph)
+    {
+        for (FrameGraphResource& resource : graph.resources)
+        {
+            resource.first = resource.last = -1;
+        }
+        for (int i = 0; i < (int)graph.order.size(); ++i)
+        {
+            for (const FrameGraphAccess& access : graph.passes[graph.order[i]].accesses)
+            {
+                FrameGraphResource& resource = graph.resources[access.resource];
+                if (resource.first == -1) resource.first = i;
+                resource.last = i;
+            }
+        }
+
+        for (FrameGraphObject& object : graph.objects) object.free_from = 0;
+        std::vector<bool> used(graph.objects.size(), false);
+
+        // lifetimes in the order they start, so an object freed at i can go to anything starting after i
+        std::vector<std::vector<unsigned int>> starting(graph.order.size());
+        for (unsigned int r = 0; r < graph.resources.size(); ++r)
+        {
+            const FrameGraphResource& resource = graph.resources[r];
+            if (!resource.imported && resource.first != -1) starting[resource.first].push_back(r);
+        }
+
+        for (int i = 0; i < (int)starting.size(); ++i)
+        {
+            for (unsigned int r : starting[i])
+            {
+                FrameGraphResource& resource = graph.resources[r];
+
+                // textures need an exact match, buffers the smallest that fits
+                size_t best = graph.objects.size();
+                for (size_t o = 0; o < graph.objects.size(); ++o)
+                {
+                    const FrameGraphObject& object = graph.objects[o];
+                    if (object.buffer != resource.buffer || object.free_from > i) continue;
+                    if (resource.buffer)
+                    {
+                        if (object.size < resource.size) continue;
+                        if (best == graph.objects.size() || object.size < graph.objects[best].size) best = o;
+                    }
+                    else if (SameDesc(object.desc, resource.desc))
+                    {
+                        best = o;
+                        break;
+                    }
+                }
+
+                if (best == graph.objects.size())
+                {
+                    FrameGraphObject object;
+                    object.buffer = resource.buffer;
+                    object.desc = resource.desc;
+                    object.size = resource.size;
+                    if (resource.buffer)
+                    {
+                        glGenBuffers(1, &object.object);
+                        glBindBuffer(GL_ARRAY_BUFFER, object.object);
+                        glBufferData(GL_ARRAY_BUFFER, resource.size, NULL, GL_DYNAMIC_DRAW);
+                        glBindBuffer(GL_ARRAY_BUFFER, 0);
+                    }
+                    else object.object = CreateTexture(resource.desc);
+
+                    graph.objects.push_back(object);
+                    used.push_back(false);
+                    graph.stats.created++;
+                }
+
+                FrameGraphObject& object = graph.objects[best];
+                object.free_from = resource.last + 1;
+                object.last_frame = graph.frame;
+                resource.object = object.object;
+                graph.stats.transient++;
+                if (!used[best]) graph.stats.objects++;
+                used[best] = true;
+            }
+        }
+    }
+
+    static inline void DropFramebuffers(FrameGraph& graph, unsigned int texture)
+    {
+        for (auto it = graph.framebuffers.begin(); it != graph.framebuffers.end(); )
+        {
+            bool uses = false;
+            for (size_t k = 0; k < it->first.size(); k += 2) uses = uses || it->first[k] == texture;
+            if (uses)
+            {
+                glDeleteFramebuffers(1, &it->second);
+                it = graph.framebuffers.erase(it);
+            }
+            else ++it;
+        }
+    }
+
+    // objects no frame has used for a while
+    static inline void Collect(FrameGraph& graph)
+    {
+        size_t kept = 0;
+        for (size_t o = 0; o < graph.objects.size(); ++o)
+        {
+            FrameGraphObject& object = graph.objects[o];
+            if (object.last_frame + FRAME_GRAPH_KEEP_FRAMES >= graph.frame)
+            {
+                graph.objects[kept++] = object;
+                continue;
+            }
+
+            if (object.buffer) glDeleteBuffers(1, &object.object);
+            else
+            {
+                DropFramebuffers(graph, object.object);
+                glDeleteTextures(1, &object.object);
+            }
+        }
+        graph.objects.resize(kept);
+    }
+
+    static inline unsigned int Framebuffer(FrameGraph& graph, const FrameGraphPass& pass)
+    {
+        std::vector<unsigned int> key = Attachments(graph, pass, false);
+        auto found = graph.framebuffers.find(key);
+        if (found != graph.framebuffers.end()) return found->second;
+
+        unsigned int fbo = 0;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+        std::vector<GLenum> draw_buffers;
+        for (const FrameGraphAccess& access : pass.accesses)
+        {
+            if (!access.attachment) continue;
+            const FrameGraphResource& resource = graph.resources[access.resource];
+
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)draw_buffers.size();
+            if (HasStencil(resource.desc.format)) attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+            else if (IsDepth(resource.desc.format)) attachment = GL_DEPTH_ATTACHMENT;
+            else draw_buffers.push_back(attachment);
+
+            if (resource.desc.layers > 1 && access.layer >= 0)
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, resource.object, 0, access.layer);
+            else
+                glFramebufferTexture(GL_FRAMEBUFFER, attachment, resource.object, 0);
+        }
+
+        if (draw_buffers.empty())
+        {
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        else glDrawBuffers((GLsizei)draw_buffers.size(), draw_buffers.data());
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "Framebuffer incomplete for pass: " << pass.name << std::endl;
+        }
+
+        graph.framebuffers[key] = fbo;
+        return fbo;
+    }
+
+    // every FRAME_GRAPH_CLEAR attachment of the pass, the backbuffer with a single glClear
+    static inline void Clear(FrameGraph& graph, const FrameGraphPass& pass)
+    {
+        GLbitfield backbuffer = 0;
+        int colour_index = 0;
+        bool masks_reset = false;
+
+        for (const FrameGraphAccess& access : pass.accesses)
+        {
+            if (!access.attachment) continue;
+            const FrameGraphResource& resource = graph.resources[access.resource];
+            bool depth = IsDepth(resource.desc.format);
+            int index = depth ? 0 : colour_index++;
+            if (access.load != FRAME_GRAPH_CLEAR) continue;
+
+            // clears obey the write masks, earlier passes may have left them off
+            if (!masks_reset)
+            {
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthMask(GL_TRUE);
+                masks_reset = true;
+            }
+
+            if (resource.backbuffer)
+            {
+                backbuffer = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+                continue;
+            }
+
+            GLenum format, type;
+            UploadFormat(resource.desc.format, format, type);
+            const Vector4& c = pass.clear_colour;
+
+            if (HasStencil(resource.desc.format)) glClearBufferfi(GL_DEPTH_STENCIL, 0, pass.clear_depth, 0);
+            else if (depth) glClearBufferfv(GL_DEPTH, 0, &pass.clear_depth);
+            else if (type == GL_INT)
+            {
+                GLint value[4] = {(GLint)c.x, (GLint)c.y, (GLint)c.z, (GLint)c.w};
+                glClearBufferiv(GL_COLOR, index, value);
+            }
+            else if (type == GL_UNSIGNED_INT)
+            {
+                GLuint value[4] = {(GLuint)c.x, (GLuint)c.y, (GLuint)c.z, (GLuint)c.w};
+                glClearBufferuiv(GL_COLOR, index, value);
+            }
+            else glClearBufferfv(GL_COLOR, index, &c.x);
+            graph.stats.clears++;
+        }
+
+        if (backbuffer)
+        {
+            glClearColor(pass.clear_colour.x, pass.clear_colour.y, pass.clear_colour.z, pass.clear_colour.w);
+            glClearDepth(pass.clear_depth);
+            glClear(backbuffer);
+            graph.stats.clears++;
+        }
+    }
+}
+
+// starts describing a new frame, GL objects from earlier frames are kept for reuse
+static inline void FrameGraph_Begin(FrameGraph& graph)
+{
+    graph.resources.clear();
+    graph.passes.clear();
+    graph.order.clear();
+    graph.compiled = false;
+    graph.frame++;
+    graph.stats = FrameGraphStats();
+}
+
+// a texture that only lives for this frame
+static inline unsigned int FrameGraph_CreateTexture(FrameGraph& graph, const char* name, const FrameGraphTextureDesc& desc)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    return frame_graph_detail::AddResource(graph, resource);
+}
+
+// a buffer that only lives for this frame
+static inline unsigned int FrameGraph_CreateBuffer(FrameGraph& graph, const char* name, size_t size)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.buffer = true;
+    resource.size = size;
+    return frame_graph_detail::AddResource(graph, resource);
+}
+
+// a texture owned elsewhere, passes writing it are never culled
+static inline unsigned int FrameGraph_ImportTexture(FrameGraph& graph, const char* name, unsigned int texture,
+                                                    const FrameGraphTextureDesc& desc)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.desc = desc;
+    resource.object = texture;
+    return frame_graph_detail::AddResource(graph, resource);
+}
+
+static inline unsigned int FrameGraph_ImportBuffer(FrameGraph& graph, const char* name, unsigned int buffer, size_t size)
+{
+    FrameGraphResource resource;
+    resource.name = name;
+    resource.buffer = true;
+    resource.imported = true;
+    resource.size = size;
+    resource.object = buffer;
+    return frame_graph_detail::AddResource(graph, resource);
+}
+
+// the default framebuffer, colour and depth together; a pass writing it can have no other attachment
+static inline unsigned int FrameGraph_ImportBackbuffer(FrameGraph& graph)
+{
+    FrameGraphResource resource;
+    resource.name = "backbuffer";
+    resource.imported = true;
+    resource.backbuffer = true;
+    return frame_graph_detail::AddResource(graph, resource);
+}
+
+// execute runs when the frame is executed, with the pass's framebuffer bound and cleared
+static inline unsigned int FrameGraph_AddPass(FrameGraph& graph, const char* name, std::function<void(FrameGraph&)> execute)
+{
+    FrameGraphPass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    graph.passes.push_back(std::move(pass));
+    graph.compiled = false;
+    return (unsigned int)graph.passes.size() - 1;
+}
+
+// sampled texture, uniform or vertex buffer, anything the pass only looks at
+static inline void FrameGraph_Read(FrameGraph& graph, unsigned int pass, unsigned int resource)
+{
+    frame_graph_detail::AddAccess(graph, pass, {resource, false, false, FRAME_GRAPH_LOAD, -1});
+}
+
+// textures become attachments in the order written (depth formats go to the depth attachment),
+// layer picks one layer of an array texture; buffers are written as storage
+static inline void FrameGraph_Write(FrameGraph& graph, unsigned int pass, unsigned int resource,
+                                    FrameGraphLoad load = FRAME_GRAPH_LOAD, int layer = -1)
+{
+    bool attachment = resource < graph.resources.size() && !graph.resources[resource].buffer;
+    frame_graph_detail::AddAccess(graph, pass, {resource, true, attachment, load, layer});
+}
+
+// written by image store or transform feedback rather than as an attachment
+static inline void FrameGraph_WriteStorage(FrameGraph& graph, unsigned int pass, unsigned int resource)
+{
+    frame_graph_detail::AddAccess(graph, pass, {resource, true, false, FRAME_GRAPH_LOAD, -1});
+}
+
+// values FRAME_GRAPH_CLEAR writes use, integer attachments get the colour cast to integers
+static inline void FrameGraph_SetClear(FrameGraph& graph, unsigned int pass, const Vector4& colour, float depth = 1.0f)
+{
+    graph.passes[pass].clear_colour = colour;
+    graph.passes[pass].clear_depth = depth;
+}
+
+// the pass does something the graph can not see (reads back, presents), it is never culled
+static inline void FrameGraph_SetSideEffect(FrameGraph& graph, unsigned int pass)
+{
+    graph.passes[pass].side_effect = true;
+}
+
+// culls, orders and maps transient resources onto GL objects, Execute calls it if needed
+static inline void FrameGraph_Compile(FrameGraph& graph)
+{
+    using namespace frame_graph_detail;
+
+    Cull(graph);
+    Order(graph);
+    Allocate(graph);
+    Collect(graph);
+
+    graph.stats.passes = (unsigned int)graph.order.size();
+    graph.stats.culled = (unsigned int)(graph.passes.size() - graph.order.size());
+    graph.compiled = true;
+}
+
+// runs the passes, leaves the default framebuffer bound
+static inline void FrameGraph_Execute(FrameGraph& graph)
+{
+    using namespace frame_graph_detail;
+
+    if (!graph.compiled) FrameGraph_Compile(graph);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    unsigned int bound = FRAME_GRAPH_NONE;
+    GLint current[4] = {viewport[0], viewport[1], viewport[2], viewport[3]};
+
+    for (unsigned int p : graph.order)
+    {
+        FrameGraphPass& pass = graph.passes[p];
+
+        // the first attachment decides the size, the backbuffer keeps the window's viewport
+        const FrameGraphResource* target = nullptr;
+        for (const FrameGraphAccess& access : pass.accesses)
+        {
+            if (access.attachment && !target) target = &graph.resources[access.resource];
+        }
+
+        if (target)
+        {
+            unsigned int fbo = target->backbuffer ? 0 : Framebuffer(graph, pass);
+            if (fbo != bound)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                bound = fbo;
+                graph.stats.framebuffer_binds++;
+            }
+
+            GLint rect[4] = {0, 0, target->desc.width, target->desc.height};
+            if (target->backbuffer) memcpy(rect, viewport, sizeof(rect));
+            if (memcmp(rect, current, sizeof(rect)) != 0)
+            {
+                glViewport(rect[0], rect[1], rect[2], rect[3]);
+                memcpy(current, rect, sizeof(rect));
+            }
+
+            Clear(graph, pass);
+        }
+
+        if (pass.execute) pass.execute(graph);
+    }
+
+    if (bound != 0 && bound != FRAME_GRAPH_NONE)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        graph.stats.framebuffer_binds++;
+    }
+    if (memcmp(current, viewport, sizeof(current)) != 0) glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+// the GL texture behind a resource, valid inside pass functions
+static inline unsigned int FrameGraph_Texture(const FrameGraph& graph, unsigned int resource)
+{
+    return graph.resources[resource].object;
+}
+
+static inline unsigned int FrameGraph_Buffer(const FrameGraph& graph, unsigned int resource)
+{
+    return graph.resources[resource].object;
+}
+
+// the execution order and what each pass touches
+static inline void FrameGraph_Print(const FrameGraph& graph)
+{
+    const FrameGraphStats& stats = graph.stats;
+    std::cout << "Frame graph: " << stats.passes << " passes, " << stats.culled << " culled, " << stats.transient
+              << " transient resources on " << stats.objects << " objects (" << stats.created << " new), "
+              << stats.framebuffer_binds << " framebuffer binds, " << stats.clears << " clears" << std::endl;
+
+    for (unsigned int p : graph.order)
+    {
+        const FrameGraphPass& pass = graph.passes[p];
+        std::cout << "  " << pass.name << ":";
+        for (const FrameGraphAccess& access : pass.accesses)
+        {
+            std::cout << (access.write ? " w " : " r ") << graph.resources[access.resource].name;
+        }
+        std::cout << std::endl;
+    }
+    for (const FrameGraphPass& pass : graph.passes)
+    {
+        if (pass.culled) std::cout << "  (culled) " << pass.name << std::endl;
+    }
+}
+
+// deletes every object and framebuffer the graph made, imported resources are left alone
+static inline void FrameGraph_Delete(FrameGraph& graph)
+{
+    for (auto& entry : graph.framebuffers) glDeleteFramebuffers(1, &entry.second);
+    graph.framebuffers.clear();
+
+    for (FrameGraphObject& object : graph.objects)
+    {
+        if (object.buffer) glDeleteBuffers(1, &object.object);
+        else glDeleteTextures(1, &object.object);
+    }
+    graph.objects.clear();
+
+    graph.resources.clear();
+    graph.passes.clear();
+    graph.order.clear();
+    graph.compiled = false;
+}
+
+#endif
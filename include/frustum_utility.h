@@ -0,0 +1,78 @@
+#ifndef FRUSTUM_UTILITY_H
+#define FRUSTUM_UTILITY_H
+
+#include <math.h>
+#include "math_utility.h"
+
+// six planes (left, right, bottom, top, near, far) as xyz normal pointing inwards and w distance
+struct Frustum
+{
+    Vector4 planes[6];
+};
+
+// planes of projection * view (or any clip matrix), world space if the matrix maps from world space
+static inline Frustum Frustum_FromMatrix(const Matrix4& clip)
+{
+    const float* m = clip.m;
+    Frustum frustum;
+
+    // rows of the column major matrix
+    Vector4 row[4];
+    for (int i = 0; i < 4; ++i) row[i] = {m[i], m[4 + i], m[8 + i], m[12 + i]};
+
+    for (int i = 0; i < 3; ++i)
+    {
+        frustum.planes[i * 2 + 0] = Math_Vec4Add(row[3], row[i]);
+        frustum.planes[i * 2 + 1] = Math_Vec4Sub(row[3], row[i]);
+    }
+
+    for (Vector4& plane : frustum.planes)
+    {
+        float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f) plane = Math_Vec4Scale(plane, 1.0f / length);
+    }
+
+    return frustum;
+}
+
+// false only if the box is entirely outside one plane, boxes near corners can pass
+static inline bool Frustum_TestAABB(const Frustum& frustum, const Vector3& bounds_min, const Vector3& bounds_max)
+{
+    for (const Vector4& plane : frustum.planes)
+    {
+        // the corner furthest along the plane normal
+        float x = plane.x >= 0.0f ? bounds_max.x : bounds_min.x;
+        float y = plane.y >= 0.0f ? bounds_max.y : bounds_min.y;
+        float z = plane.z >= 0.0f ? bounds_max.z : bounds_min.z;
+
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) return false;
+    }
+    return true;
+}
+
+// world space bounds of a transformed box, the eight corners folded into min/max per axis
+static inline void Frustum_TransformAABB(const Matrix4& model, const Vector3& bounds_min, const Vector3& bounds_max,
+                                         Vector3& out_min, Vector3& out_max)
+{
+    const float* m = model.m;
+    float lo[3] = {bounds_min.x, bounds_min.y, bounds_min.z};
+    float hi[3] = {bounds_max.x, bounds_max.y, bounds_max.z};
+    float out_lo[3], out_hi[3];
+
+    for (int row = 0; row < 3; ++row)
+    {
+        out_lo[row] = out_hi[row] = m[12 + row];
+        for (int col = 0; col < 3; ++col)
+        {
+            float a = m[col * 4 + row] * lo[col];
+            float b = m[col * 4 + row] * hi[col];
+            out_lo[row] += fminf(a, b);
+            out_hi[row] += fmaxf(a, b);
+        }
+    }
+
+    out_min = {out_lo[0], out_lo[1], out_lo[2]};
+    out_max = {out_hi[0], out_hi[1], out_hi[2]};
+}
+
+#endif
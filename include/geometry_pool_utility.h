@@ -0,0 +1,320 @@
+#ifndef GEOMETRY_POOL_UTILITY_H
+#define GEOMETRY_POOL_UTILITY_H
+
+#include <iostream>
+#include <map>
+#include <glad/glad.h>
+#include "mesh_utility.h"
+
+/*
+    Shared geometry pool
+
+    One big VBO and EBO per vertex layout with a single VAO describing them.
+    Meshes added to a pool get a range of vertices and indices in those
+    buffers and are drawn with glDrawElementsBaseVertex, so drawing many
+    pooled meshes never switches VAO and the driver only tracks a handful
+    of buffer objects.
+
+    Space is managed by an offset allocator (best fit over free ranges,
+    neighbours coalesce on free). When a pool runs out it grows in place,
+    the buffer names stay the same so nothing that holds them goes stale.
+*/
+
+static constexpr unsigned int POOL_INVALID = 0xFFFFFFFFu;
+
+// hands out [offset, offset + size) ranges of a linear space, sizes are in elements
+struct PoolAllocator
+{
+    unsigned int capacity = 0;
+    unsigned int used = 0;
+    std::map<unsigned int, unsigned int> free_by_offset;        // offset -> size
+    std::multimap<unsigned int, unsigned int> free_by_size;     // size -> offset
+};
+
+namespace pool_detail
+{
+    static inline void InsertFree(PoolAllocator& a, unsigned int offset, unsigned int size)
+    {
+        a.free_by_offset.emplace(offset, size);
+        a.free_by_size.emplace(size, offset);
+    }
+
+    static inline void EraseFree(PoolAllocator& a, std::map<unsigned int, unsigned int>::iterator it)
+    {
+        auto range = a.free_by_size.equal_range(it->second);
+        for (auto s = range.first; s != range.second; ++s)
+        {
+            if (s->second == it->first)
+            {
+                a.free_by_size.erase(s);
+                break;
+            }
+        }
+        a.free_by_offset.erase(it);
+    }
+}
+
+static inline void PoolAllocator_Init(PoolAllocator& a, unsigned int capacity)
+{
+    a.capacity = capacity;
+    a.used = 0;
+    a.free_by_offset.clear();
+    a.free_by_size.clear();
+    if (capacity > 0) pool_detail::InsertFree(a, 0, capacity);
+}
+
+// smallest free range that fits, POOL_INVALID if none does
+static inline unsigned int PoolAllocator_Alloc(PoolAllocator& a, unsigned int size)
+{
+    if (size == 0) return 0;
+
+    auto best = a.free_by_size.lower_bound(size);
+    if (best == a.free_by_size.end()) return POOL_INVALID;
+
+    unsigned int offset = best->second;
+    unsigned int free_size = best->first;
+
+    pool_detail::EraseFree(a, a.free_by_offset.find(offset));
+    if (free_size > size) pool_detail::InsertFree(a, offset + size, free_size - size);
+
+    a.used += size;
+    return offset;
+}
+
+static inline void PoolAllocator_Free(PoolAllocator& a, unsigned int offset, unsigned int size)
+{
+    if (size == 0 || offset == POOL_INVALID) return;
+
+    a.used -= size;
+
+    // merge with the free neighbours on either side
+    auto next = a.free_by_offset.lower_bound(offset);
+    if (next != a.free_by_offset.end() && next->first == offset + size)
+    {
+        size += next->second;
+        pool_detail::EraseFree(a, next);
+    }
+
+    auto prev = a.free_by_offset.lower_bound(offset);
+    if (prev != a.free_by_offset.begin())
+    {
+        --prev;
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            size += prev->second;
+            pool_detail::EraseFree(a, prev);
+        }
+    }
+
+    pool_detail::InsertFree(a, offset, size);
+}
+
+// extends the space, the new tail joins the last free range if it touches it
+static inline void PoolAllocator_Grow(PoolAllocator& a, unsigned int capacity)
+{
+    if (capacity <= a.capacity) return;
+
+    unsigned int old_capacity = a.capacity;
+    a.capacity = capacity;
+    a.used += capacity - old_capacity;
+    PoolAllocator_Free(a, old_capacity, capacity - old_capacity);
+}
+
+struct GeometryPool
+{
+    unsigned int layout = MESH_ATTRIB_POSITION;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    PoolAllocator vertices;     // in vertices
+    PoolAllocator indices;      // in indices
+};
+
+namespace pool_detail
+{
+    // one pool per layout for GeometryPool_Add(mesh)
+    inline std::map<unsigned int, GeometryPool> pools;
+
+    static constexpr unsigned int DEFAULT_VERTICES = 1 << 20;
+    static constexpr unsigned int DEFAULT_INDICES = 1 << 22;
+
+    // resizes a buffer keeping its name and contents, via a scratch copy on the GPU
+    static inline void GrowBuffer(unsigned int buffer, size_t old_size, size_t new_size)
+    {
+        unsigned int scratch = 0;
+        if (old_size > 0)
+        {
+            glGenBuffers(1, &scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, old_size, NULL, GL_STREAM_COPY);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBufferData(GL_COPY_READ_BUFFER, new_size, NULL, GL_STATIC_DRAW);
+
+        if (scratch)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+            glDeleteBuffers(1, &scratch);
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    static inline unsigned int GrownCapacity(unsigned int capacity, unsigned int needed)
+    {
+        unsigned long long grown = capacity ? capacity : 1024;
+        while (grown < (unsigned long long)capacity + needed) grown *= 2;
+        return grown > 0xFFFFFFFEull ? 0xFFFFFFFEu : (unsigned int)grown;
+    }
+}
+
+// creates the buffers and the VAO for one layout, capacities are in vertices and indices
+static inline void GeometryPool_Init(GeometryPool& pool, unsigned int layout, unsigned int vertex_capacity, unsigned int index_capacity)
+{
+    pool.layout = layout;
+    PoolAllocator_Init(pool.vertices, vertex_capacity);
+    PoolAllocator_Init(pool.indices, index_capacity);
+
+    glGenVertexArrays(1, &pool.VAO);
+    glGenBuffers(1, &pool.VBO);
+    glGenBuffers(1, &pool.EBO);
+
+    Mesh_BindVertexArray(pool.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)vertex_capacity * Mesh_VertexStride(layout) * sizeof(float), NULL, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)index_capacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+    Mesh_SetAttributes(layout);
+}
+
+// the shared pool for a layout, created on first use
+static inline GeometryPool& GeometryPool_ForLayout(unsigned int layout)
+{
+    auto found = pool_detail::pools.find(layout);
+    if (found != pool_detail::pools.end()) return found->second;
+
+    GeometryPool& pool = pool_detail::pools[layout];
+    GeometryPool_Init(pool, layout, pool_detail::DEFAULT_VERTICES, pool_detail::DEFAULT_INDICES);
+    return pool;
+}
+
+// copies the mesh CPU data into the pool, the mesh draws from the pool afterwards
+// use this instead of Mesh_Generate, returns -1 if the layouts differ
+static inline int GeometryPool_Add(GeometryPool& pool, Mesh& mesh)
+{
+    if (mesh.initialized == -1)
+    {
+        std::cout<< "Mesh not initialized with shape" << std::endl;
+        return -1;
+    }
+
+    if (mesh.layout != pool.layout)
+    {
+        std::cout << "Mesh layout does not match the geometry pool" << std::endl;
+        return -1;
+    }
+
+    unsigned int vertex_count = Mesh_VertexCount(mesh);
+    unsigned int index_count = mesh.use_indices ? (unsigned int)mesh.indices.size() : 0;
+    size_t vertex_size = Mesh_VertexStride(pool.layout) * sizeof(float);
+
+    unsigned int base_vertex = PoolAllocator_Alloc(pool.vertices, vertex_count);
+    if (base_vertex == POOL_INVALID)
+    {
+        unsigned int capacity = pool_detail::GrownCapacity(pool.vertices.capacity, vertex_count);
+        pool_detail::GrowBuffer(pool.VBO, (size_t)pool.vertices.capacity * vertex_size, (size_t)capacity * vertex_size);
+        PoolAllocator_Grow(pool.vertices, capacity);
+        base_vertex = PoolAllocator_Alloc(pool.vertices, vertex_count);
+    }
+
+    unsigned int first_index = PoolAllocator_Alloc(pool.indices, index_count);
+    if (first_index == POOL_INVALID)
+    {
+        unsigned int capacity = pool_detail::GrownCapacity(pool.indices.capacity, index_count);
+        pool_detail::GrowBuffer(pool.EBO, (size_t)pool.indices.capacity * sizeof(unsigned int), (size_t)capacity * sizeof(unsigned int));
+        PoolAllocator_Grow(pool.indices, capacity);
+        first_index = PoolAllocator_Alloc(pool.indices, index_count);
+    }
+
+    if (base_vertex == POOL_INVALID || first_index == POOL_INVALID)
+    {
+        std::cout << "Geometry pool is full" << std::endl;
+        PoolAllocator_Free(pool.vertices, base_vertex, vertex_count);
+        PoolAllocator_Free(pool.indices, first_index, index_count);
+        return -1;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (size_t)base_vertex * vertex_size, (size_t)vertex_count * vertex_size, mesh.vertices.data());
+
+    if (index_count > 0)
+    {
+        // the element buffer binding is VAO state, go through the pool VAO
+        Mesh_BindVertexArray(pool.VAO);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (size_t)first_index * sizeof(unsigned int), (size_t)index_count * sizeof(unsigned int), mesh.indices.data());
+    }
+
+    mesh.pool = &pool;
+    mesh.VAO = pool.VAO;
+    mesh.VBO = pool.VBO;
+    mesh.EBO = pool.EBO;
+    mesh.base_vertex = base_vertex;
+    mesh.first_index = first_index;
+    mesh.vertex_count = vertex_count;
+    mesh.index_count = index_count;
+    mesh.vertex_capacity = vertex_count;
+    mesh.index_capacity = index_count;
+    Mesh_ComputeBounds(mesh, mesh.bounds_min, mesh.bounds_max);
+
+    return 0;
+}
+
+// adds the mesh to the shared pool for its layout
+static inline int GeometryPool_Add(Mesh& mesh)
+{
+    return GeometryPool_Add(GeometryPool_ForLayout(mesh.layout), mesh);
+}
+
+// gives the mesh's ranges back to its pool and clears the mesh
+static inline void GeometryPool_Remove(Mesh& mesh)
+{
+    if (!mesh.pool) return;
+
+    PoolAllocator_Free(mesh.pool->vertices, mesh.base_vertex, mesh.vertex_capacity);
+    PoolAllocator_Free(mesh.pool->indices, mesh.first_index, mesh.index_capacity);
+
+    Mesh_Delete(mesh);
+}
+
+static inline void GeometryPool_Delete(GeometryPool& pool)
+{
+    if (pool.VAO == mesh_detail::bound_vao) Mesh_BindVertexArray(0);
+    if (pool.EBO) glDeleteBuffers(1, &pool.EBO);
+    if (pool.VBO) glDeleteBuffers(1, &pool.VBO);
+    if (pool.VAO) glDeleteVertexArrays(1, &pool.VAO);
+
+    pool.VAO = 0;
+    pool.VBO = 0;
+    pool.EBO = 0;
+    PoolAllocator_Init(pool.vertices, 0);
+    PoolAllocator_Init(pool.indices, 0);
+}
+
+// deletes the shared per layout pools
+static inline void GeometryPool_DeleteAll()
+{
+    for (auto& entry : pool_detail::pools) GeometryPool_Delete(entry.second);
+    pool_detail::pools.clear();
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef GLEXT_UTILITY_H
+#define GLEXT_UTILITY_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <string.h>
+
+/*
+    Entry points past GL 3.3
+
+    glad is generated for 3.3 core, which is what we ask GLFW for. Drivers
+    usually hand back a newer context or expose the ARB extensions anyway,
+    so the newer functions we use are looked up here at runtime and every
+    feature that needs them checks GLExt_Caps() and keeps a 3.3 path.
+*/
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_COMPUTE_WORK_GROUP_SIZE 0x8267
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DISPATCH_INDIRECT_BUFFER 0x90EE
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_ELEMENT_ARRAY_BARRIER_BIT 0x00000002
+#define GL_UNIFORM_BARRIER_BIT 0x00000004
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_ALL_BARRIER_BITS 0xFFFFFFFF
+#endif
+
+#ifndef GL_SHADER_STORAGE_BLOCK
+#define GL_BUFFER_VARIABLE 0x92E5
+#define GL_SHADER_STORAGE_BLOCK 0x92E6
+#define GL_ACTIVE_RESOURCES 0x92F5
+#define GL_NAME_LENGTH 0x92F9
+#define GL_TYPE 0x92FA
+#define GL_ARRAY_SIZE 0x92FB
+#define GL_OFFSET 0x92FC
+#define GL_BLOCK_INDEX 0x92FD
+#define GL_ARRAY_STRIDE 0x92FE
+#define GL_MATRIX_STRIDE 0x92FF
+#define GL_BUFFER_BINDING 0x9302
+#define GL_BUFFER_DATA_SIZE 0x9303
+#define GL_NUM_ACTIVE_VARIABLES 0x9304
+#define GL_ACTIVE_VARIABLES 0x9305
+#define GL_TOP_LEVEL_ARRAY_SIZE 0x9308
+#define GL_TOP_LEVEL_ARRAY_STRIDE 0x9309
+#endif
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEINDIRECTPROC)(GLintptr indirect);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP PFNGLGETPROGRAMINTERFACEIVPROC)(GLuint program, GLenum programInterface, GLenum pname, GLint* params);
+typedef void (APIENTRYP PFNGLGETPROGRAMRESOURCEIVPROC)(GLuint program, GLenum programInterface, GLuint index, GLsizei propCount, const GLenum* props, GLsizei count, GLsizei* length, GLint* params);
+typedef void (APIENTRYP PFNGLGETPROGRAMRESOURCENAMEPROC)(GLuint program, GLenum programInterface, GLuint index, GLsizei bufSize, GLsizei* length, GLchar* name);
+
+struct GLCapabilities
+{
+    int major = 3;
+    int minor = 3;
+
+    bool multi_draw_indirect = false;   // glMultiDrawElementsIndirect with base instance
+    bool buffer_storage = false;        // glBufferStorage, persistent mapping
+    bool program_binary = false;        // glGetProgramBinary / glProgramBinary with at least one format
+    bool parallel_shader_compile = false;   // GL_COMPLETION_STATUS_KHR can be polled without waiting
+    bool compute = false;               // compute shaders, storage buffers, image load/store and barriers
+    bool program_interface_query = false;   // glGetProgramResource*, the only way to reflect storage blocks
+};
+
+namespace glext
+{
+    inline PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+    inline PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+    inline PFNGLGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+    inline PFNGLPROGRAMBINARYPROC ProgramBinary = nullptr;
+    inline PFNGLPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+    inline PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads = nullptr;
+    inline PFNGLDISPATCHCOMPUTEPROC DispatchCompute = nullptr;
+    inline PFNGLDISPATCHCOMPUTEINDIRECTPROC DispatchComputeIndirect = nullptr;
+    inline PFNGLMEMORYBARRIERPROC MemoryBarrier = nullptr;
+    inline PFNGLBINDIMAGETEXTUREPROC BindImageTexture = nullptr;
+    inline PFNGLGETPROGRAMINTERFACEIVPROC GetProgramInterfaceiv = nullptr;
+    inline PFNGLGETPROGRAMRESOURCEIVPROC GetProgramResourceiv = nullptr;
+    inline PFNGLGETPROGRAMRESOURCENAMEPROC GetProgramResourceName = nullptr;
+}
+
+namespace glext_detail
+{
+    inline GLCapabilities caps;
+
+    static inline bool AtLeast(int major, int minor)
+    {
+        return caps.major > major || (caps.major == major && caps.minor >= minor);
+    }
+}
+
+// true if the current context advertises the extension
+static inline bool GLExt_Supported(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0) return true;
+    }
+    return false;
+}
+
+// call once after glad has loaded, Window_Generate does this
+static inline void GLExt_Load()
+{
+    using namespace glext_detail;
+
+    glGetIntegerv(GL_MAJOR_VERSION, &caps.major);
+    glGetIntegerv(GL_MINOR_VERSION, &caps.minor);
+
+    // indirect draws read the base instance, so 4.2 / ARB_base_instance is needed as well
+    bool indirect = AtLeast(4, 3) ||
+                    (GLExt_Supported("GL_ARB_multi_draw_indirect") && GLExt_Supported("GL_ARB_base_instance"));
+    if (indirect)
+    {
+        glext::MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+    }
+    caps.multi_draw_indirect = glext::MultiDrawElementsIndirect != nullptr;
+
+    if (AtLeast(4, 4) || GLExt_Supported("GL_ARB_buffer_storage"))
+    {
+        glext::BufferStorage = (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+    }
+    caps.buffer_storage = glext::BufferStorage != nullptr;
+
+    // some drivers expose the entry points but accept no binary format at all
+    if (AtLeast(4, 1) || GLExt_Supported("GL_ARB_get_program_binary"))
+    {
+        glext::GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+        glext::ProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+        glext::ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+    }
+    GLint formats = 0;
+    if (glext::GetProgramBinary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    caps.program_binary = glext::GetProgramBinary && glext::ProgramBinary && glext::ProgramParameteri && formats > 0;
+
+    // the ARB version has the same enums, only the thread count entry point is named differently
+    if (GLExt_Supported("GL_KHR_parallel_shader_compile"))
+    {
+        glext::MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    }
+    else if (GLExt_Supported("GL_ARB_parallel_shader_compile"))
+    {
+        glext::MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+    caps.parallel_shader_compile = glext::MaxShaderCompilerThreads != nullptr;
+
+    // compute is only useful with somewhere to write, so storage buffers and images come with it
+    bool compute = AtLeast(4, 3) ||
+                   (GLExt_Supported("GL_ARB_compute_shader") && GLExt_Supported("GL_ARB_shader_storage_buffer_object") &&
+                    GLExt_Supported("GL_ARB_shader_image_load_store"));
+    if (compute)
+    {
+        glext::DispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)glfwGetProcAddress("glDispatchCompute");
+        glext::DispatchComputeIndirect = (PFNGLDISPATCHCOMPUTEINDIRECTPROC)glfwGetProcAddress("glDispatchComputeIndirect");
+        glext::MemoryBarrier = (PFNGLMEMORYBARRIERPROC)glfwGetProcAddress("glMemoryBarrier");
+        glext::BindImageTexture = (PFNGLBINDIMAGETEXTUREPROC)glfwGetProcAddress("glBindImageTexture");
+    }
+    caps.compute = glext::DispatchCompute && glext::DispatchComputeIndirect && glext::MemoryBarrier && glext::BindImageTexture;
+
+    if (AtLeast(4, 3) || GLExt_Supported("GL_ARB_program_interface_query"))
+    {
+        glext::GetProgramInterfaceiv = (PFNGLGETPROGRAMINTERFACEIVPROC)glfwGetProcAddress("glGetProgramInterfaceiv");
+        glext::GetProgramResourceiv = (PFNGLGETPROGRAMRESOURCEIVPROC)glfwGetProcAddress("glGetProgramResourceiv");
+        glext::GetProgramResourceName = (PFNGLGETPROGRAMRESOURCENAMEPROC)glfwGetProcAddress("glGetProgramResourceName");
+    }
+    caps.program_interface_query = glext::GetProgramInterfaceiv && glext::GetProgramResourceiv && glext::GetProgramResourceName;
+}
+
+static inline const GLCapabilities& GLExt_Caps() { return glext_detail::caps; }
+
+#endif
@@ -0,0 +1,947 @@
+#ifndef GLTF_UTILITY_H
+#define GLTF_UTILITY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include "file_utility.h"
+#include "math_utility.h"
+#include "mesh_utility.h"
+#include "parse_utility.h"
+#include "shader_utility.h"
+#include "thread_utility.h"
+
+/*
+    glTF 2.0 binary (.glb) importer
+
+    Gltf_Load maps the file, reads the JSON chunk in a single pass straight
+    into the structs below (no DOM), then decodes every primitive in parallel.
+    Primitives whose buffer views already match our interleaved Mesh layout
+    and 32 bit indices are not decoded at all, Gltf_Generate uploads those
+    bytes directly out of the mapped BIN chunk.
+
+    Supported: triangle primitives, POSITION/NORMAL/TEXCOORD_0, any index
+    type, node hierarchies with TRS or matrix transforms, metallic-roughness
+    material factors. Not supported: external buffer uris, sparse accessors,
+    skins, morph targets, animations, cameras.
+*/
+
+struct GltfMaterial
+{
+    std::string name;
+    Vector4 base_colour = {1.0f, 1.0f, 1.0f, 1.0f};
+    float metallic = 1.0f;
+    float roughness = 1.0f;
+    Vector3 emissive = {0.0f, 0.0f, 0.0f};
+    int base_colour_texture = -1;
+    int metallic_roughness_texture = -1;
+    int normal_texture = -1;
+    int alpha_mode = 0;             // 0 opaque, 1 mask, 2 blend
+    float alpha_cutoff = 0.5f;
+    bool double_sided = false;
+};
+
+struct GltfPrimitive
+{
+    Mesh mesh;
+    int material = -1;
+
+    // set when the mapped bytes can be uploaded as they are
+    const void* vertex_data = nullptr;
+    const unsigned int* index_data = nullptr;
+};
+
+struct GltfMesh
+{
+    std::string name;
+    std::vector<GltfPrimitive> primitives;
+};
+
+struct GltfNode
+{
+    std::string name;
+    int mesh = -1;
+    int parent = -1;
+    std::vector<int> children;
+
+    Vector3 translation = {0.0f, 0.0f, 0.0f};
+    Quaternion rotation;
+    Vector3 scale = {1.0f, 1.0f, 1.0f};
+
+    // nodes given as a matrix keep it, TRS is ignored for them
+    bool has_matrix = false;
+    Matrix4 matrix = Math_Mat4Identity();
+
+    Matrix4 world = Math_Mat4Identity();
+};
+
+struct GltfScene
+{
+    std::vector<GltfMesh> meshes;
+    std::vector<GltfMaterial> materials;
+    std::vector<GltfNode> nodes;
+    std::vector<int> roots;
+
+    // kept mapped between Gltf_Load and Gltf_Generate for the zero copy uploads
+    MappedFile file;
+};
+
+namespace gltf_detail
+{
+    static constexpr uint32_t GLB_MAGIC = 0x46546C67;   // "glTF"
+    static constexpr uint32_t CHUNK_JSON = 0x4E4F534A;  // "JSON"
+    static constexpr uint32_t CHUNK_BIN = 0x004E4942;   // "BIN\0"
+
+    static constexpr int BYTE = 5120;
+    static constexpr int UNSIGNED_BYTE = 5121;
+    static constexpr int SHORT = 5122;
+    static constexpr int UNSIGNED_SHORT = 5123;
+    static constexpr int UNSIGNED_INT = 5125;
+    static constexpr int FLOAT = 5126;
+
+    static constexpr int MODE_TRIANGLES = 4;
+
+    // deeper values than this are not something a glTF file needs and would overflow the stack
+    static constexpr int MAX_JSON_DEPTH = 64;
+
+    struct Accessor
+    {
+        int buffer_view = -1;
+        size_t offset = 0;
+        int component_type = FLOAT;
+        bool normalized = false;
+        size_t count = 0;
+        int components = 1;
+        bool sparse = false;
+        float min[3] = {0.0f, 0.0f, 0.0f};
+        float max[3] = {0.0f, 0.0f, 0.0f};
+        bool has_bounds = false;
+    };
+
+    struct BufferView
+    {
+        int buffer = 0;
+        size_t offset = 0;
+        size_t length = 0;
+        size_t stride = 0;
+    };
+
+    struct PrimitiveSource
+    {
+        int position = -1;
+        int normal = -1;
+        int texcoord = -1;
+        int indices = -1;
+        int mode = MODE_TRIANGLES;
+    };
+
+    // everything the JSON chunk holds that is not already in the scene
+    struct Document
+    {
+        std::vector<Accessor> accessors;
+        std::vector<BufferView> views;
+        std::vector<std::vector<PrimitiveSource>> sources;  // per mesh
+        std::vector<std::vector<int>> scene_nodes;
+        int scene = 0;
+        bool external_buffers = false;
+    };
+
+    // forward only reader over the JSON text
+    struct Json
+    {
+        const char* p;
+        const char* end;
+        bool error;
+        int depth;      // of the values SkipValue is inside
+    };
+
+    struct Span
+    {
+        const char* data;
+        size_t length;
+    };
+
+    static inline void SkipSpace(Json& json)
+    {
+        while (json.p < json.end && (*json.p == ' ' || *json.p == '\t' || *json.p == '\n' || *json.p == '\r')) ++json.p;
+    }
+
+    static inline bool Consume(Json& json, char c)
+    {
+        SkipSpace(json);
+        if (json.p < json.end && *json.p == c)
+        {
+            ++json.p;
+            return true;
+        }
+        return false;
+    }
+
+    static inline bool Is(const Span& key, const char* word)
+    {
+        size_t length = strlen(word);
+        return key.length == length && memcmp(key.data, word, length) == 0;
+    }
+
+    // the raw string between the quotes, escapes are left in place
+    static inline Span ReadString(Json& json)
+    {
+        Span span = {json.p, 0};
+        if (!Consume(json, '"'))
+        {
+            json.error = true;
+            return span;
+        }
+
+        span.data = json.p;
+        while (json.p < json.end && *json.p != '"')
+        {
+            if (*json.p == '\\') ++json.p;
+            ++json.p;
+        }
+
+        if (json.p >= json.end)
+        {
+            json.error = true;
+            return span;
+        }
+
+        span.length = json.p - span.data;
+        ++json.p;
+        return span;
+    }
+
+    static inline void AssignString(std::string& out, const Span& span)
+    {
+        out.clear();
+        out.reserve(span.length);
+
+        for (size_t i = 0; i < span.length; ++i)
+        {
+            char c = span.data[i];
+            if (c == '\\' && i + 1 < span.length)
+            {
+                char e = span.data[++i];
+                if (e == 'n') c = '\n';
+                else if (e == 't') c = '\t';
+                else if (e == 'r') c = '\r';
+                else if (e == 'b') c = '\b';
+                else if (e == 'f') c = '\f';
+                else if (e == 'u')
+                {
+                    // names only, non ascii code points are not worth decoding
+                    i += 4;
+                    c = '?';
+                }
+                else c = e;
+            }
+            out.push_back(c);
+        }
+    }
+
+    static inline double ReadNumber(Json& json)
+    {
+        SkipSpace(json);
+        const char* start = json.p;
+        double value = Parse_Number(json.p, json.end);
+        if (json.p == start) json.error = true;
+        return value;
+    }
+
+    static inline bool ReadBool(Json& json)
+    {
+        SkipSpace(json);
+        if (json.end - json.p >= 4 && memcmp(json.p, "true", 4) == 0)
+        {
+            json.p += 4;
+            return true;
+        }
+        if (json.end - json.p >= 5 && memcmp(json.p, "false", 5) == 0)
+        {
+            json.p += 5;
+            return false;
+        }
+        json.error = true;
+        return false;
+    }
+
+    static inline void SkipValue(Json& json);
+
+    // calls fn(key) for each member, fn has to consume the value
+    template <typename Fn>
+    static inline void ReadObject(Json& json, Fn&& fn)
+    {
+        if (!Consume(json, '{'))
+        {
+            json.error = true;
+            return;
+        }
+        if (Consume(json, '}')) return;
+
+        while (!json.error)
+        {
+            Span key = ReadString(json);
+            if (!Consume(json, ':'))
+            {
+                json.error = true;
+                return;
+            }
+
+            fn(key);
+
+            if (Consume(json, ',')) continue;
+            if (!Consume(json, '}')) json.error = true;
+            return;
+        }
+    }
+
+    // calls fn(index) for each element, fn has to consume the element
+    template <typename Fn>
+    static inline void ReadArray(Json& json, Fn&& fn)
+    {
+        if (!Consume(json, '['))
+        {
+            json.error = true;
+            return;
+        }
+        if (Consume(json, ']')) return;
+
+        size_t index = 0;
+        while (!json.error)
+        {
+            fn(index++);
+
+            if (Consume(json, ',')) continue;
+            if (!Consume(json, ']')) json.error = true;
+            return;
+        }
+    }
+
+    static inline void SkipValue(Json& json)
+    {
+        SkipSpace(json);
+        if (json.p >= json.end)
+        {
+            json.error = true;
+            return;
+        }
+
+        char c = *json.p;
+        if ((c == '{' || c == '[') && json.depth >= MAX_JSON_DEPTH)
+        {
+            json.error = true;
+            return;
+        }
+
+        ++json.depth;
+        if (c == '{') ReadObject(json, [&json](const Span&) { SkipValue(json); });
+        else if (c == '[') ReadArray(json, [&json](size_t) { SkipValue(json); });
+        else if (c == '"') ReadString(json);
+        else if (c == 't' || c == 'f') ReadBool(json);
+        else if (c == 'n' && json.end - json.p >= 4 && memcmp(json.p, "null", 4) == 0) json.p += 4;
+        else ReadNumber(json);
+        --json.depth;
+    }
+
+    static inline int ReadInt(Json& json) { return (int)ReadNumber(json); }
+
+    static inline size_t ReadSize(Json& json) { return (size_t)ReadNumber(json); }
+
+    static inline void ReadFloats(Json& json, float* out, size_t count)
+    {
+        ReadArray(json, [&](size_t i)
+        {
+            float value = (float)ReadNumber(json);
+            if (i < count) out[i] = value;
+        });
+    }
+
+    // {"index": n, ...} as used by texture references
+    static inline int ReadTextureIndex(Json& json)
+    {
+        int index = -1;
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "index")) index = ReadInt(json);
+            else SkipValue(json);
+        });
+        return index;
+    }
+
+    static inline int ComponentCount(const Span& type)
+    {
+        if (Is(type, "SCALAR")) return 1;
+        if (Is(type, "VEC2")) return 2;
+        if (Is(type, "VEC3")) return 3;
+        if (Is(type, "VEC4")) return 4;
+        if (Is(type, "MAT2")) return 4;
+        if (Is(type, "MAT3")) return 9;
+        if (Is(type, "MAT4")) return 16;
+        return 1;
+    }
+
+    static inline void ReadAccessor(Json& json, Accessor& a)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "bufferView")) a.buffer_view = ReadInt(json);
+            else if (Is(key, "byteOffset")) a.offset = ReadSize(json);
+            else if (Is(key, "componentType")) a.component_type = ReadInt(json);
+            else if (Is(key, "normalized")) a.normalized = ReadBool(json);
+            else if (Is(key, "count")) a.count = ReadSize(json);
+            else if (Is(key, "type")) a.components = ComponentCount(ReadString(json));
+            else if (Is(key, "min")) { ReadFloats(json, a.min, 3); a.has_bounds = true; }
+            else if (Is(key, "max")) ReadFloats(json, a.max, 3);
+            else if (Is(key, "sparse")) { a.sparse = true; SkipValue(json); }
+            else SkipValue(json);
+        });
+    }
+
+    static inline void ReadBufferView(Json& json, BufferView& v)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "buffer")) v.buffer = ReadInt(json);
+            else if (Is(key, "byteOffset")) v.offset = ReadSize(json);
+            else if (Is(key, "byteLength")) v.length = ReadSize(json);
+            else if (Is(key, "byteStride")) v.stride = ReadSize(json);
+            else SkipValue(json);
+        });
+    }
+
+    static inline void ReadPrimitive(Json& json, PrimitiveSource& source, int& material)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "attributes"))
+            {
+                ReadObject(json, [&](const Span& attribute)
+                {
+                    if (Is(attribute, "POSITION")) source.position = ReadInt(json);
+                    else if (Is(attribute, "NORMAL")) source.normal = ReadInt(json);
+                    else if (Is(attribute, "TEXCOORD_0")) source.texcoord = ReadInt(json);
+                    else SkipValue(json);
+                });
+            }
+            else if (Is(key, "indices")) source.indices = ReadInt(json);
+            else if (Is(key, "material")) material = ReadInt(json);
+            else if (Is(key, "mode")) source.mode = ReadInt(json);
+            else SkipValue(json);
+        });
+    }
+
+    static inline void ReadMesh(Json& json, GltfMesh& mesh, std::vector<PrimitiveSource>& sources)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "name")) AssignString(mesh.name, ReadString(json));
+            else if (Is(key, "primitives"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    mesh.primitives.emplace_back();
+                    sources.emplace_back();
+                    ReadPrimitive(json, sources.back(), mesh.primitives.back().material);
+                });
+            }
+            else SkipValue(json);
+        });
+    }
+
+    static inline void ReadNode(Json& json, GltfNode& node)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "name")) AssignString(node.name, ReadString(json));
+            else if (Is(key, "mesh")) node.mesh = ReadInt(json);
+            else if (Is(key, "children")) ReadArray(json, [&](size_t) { node.children.push_back(ReadInt(json)); });
+            else if (Is(key, "translation")) ReadFloats(json, &node.translation.x, 3);
+            else if (Is(key, "scale")) ReadFloats(json, &node.scale.x, 3);
+            else if (Is(key, "rotation"))
+            {
+                // glTF stores x, y, z, w
+                float q[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+                ReadFloats(json, q, 4);
+                node.rotation = Quaternion(q[3], q[0], q[1], q[2]);
+            }
+            else if (Is(key, "matrix"))
+            {
+                ReadFloats(json, node.matrix.m, 16);
+                node.has_matrix = true;
+            }
+            else SkipValue(json);
+        });
+    }
+
+    static inline void ReadMaterial(Json& json, GltfMaterial& material)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "name")) AssignString(material.name, ReadString(json));
+            else if (Is(key, "pbrMetallicRoughness"))
+            {
+                ReadObject(json, [&](const Span& pbr)
+                {
+                    if (Is(pbr, "baseColorFactor")) ReadFloats(json, &material.base_colour.x, 4);
+                    else if (Is(pbr, "metallicFactor")) material.metallic = (float)ReadNumber(json);
+                    else if (Is(pbr, "roughnessFactor")) material.roughness = (float)ReadNumber(json);
+                    else if (Is(pbr, "baseColorTexture")) material.base_colour_texture = ReadTextureIndex(json);
+                    else if (Is(pbr, "metallicRoughnessTexture")) material.metallic_roughness_texture = ReadTextureIndex(json);
+                    else SkipValue(json);
+                });
+            }
+            else if (Is(key, "normalTexture")) material.normal_texture = ReadTextureIndex(json);
+            else if (Is(key, "emissiveFactor")) ReadFloats(json, &material.emissive.x, 3);
+            else if (Is(key, "alphaMode"))
+            {
+                Span mode = ReadString(json);
+                material.alpha_mode = Is(mode, "MASK") ? 1 : Is(mode, "BLEND") ? 2 : 0;
+            }
+            else if (Is(key, "alphaCutoff")) material.alpha_cutoff = (float)ReadNumber(json);
+            else if (Is(key, "doubleSided")) material.double_sided = ReadBool(json);
+            else SkipValue(json);
+        });
+    }
+
+    static inline void ReadDocument(Json& json, GltfScene& scene, Document& doc)
+    {
+        ReadObject(json, [&](const Span& key)
+        {
+            if (Is(key, "accessors"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    doc.accessors.emplace_back();
+                    ReadAccessor(json, doc.accessors.back());
+                });
+            }
+            else if (Is(key, "bufferViews"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    doc.views.emplace_back();
+                    ReadBufferView(json, doc.views.back());
+                });
+            }
+            else if (Is(key, "buffers"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    ReadObject(json, [&](const Span& field)
+                    {
+                        if (Is(field, "uri")) doc.external_buffers = true;
+                        SkipValue(json);
+                    });
+                });
+            }
+            else if (Is(key, "meshes"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    scene.meshes.emplace_back();
+                    doc.sources.emplace_back();
+                    ReadMesh(json, scene.meshes.back(), doc.sources.back());
+                });
+            }
+            else if (Is(key, "nodes"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    scene.nodes.emplace_back();
+                    ReadNode(json, scene.nodes.back());
+                });
+            }
+            else if (Is(key, "materials"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    scene.materials.emplace_back();
+                    ReadMaterial(json, scene.materials.back());
+                });
+            }
+            else if (Is(key, "scenes"))
+            {
+                ReadArray(json, [&](size_t)
+                {
+                    doc.scene_nodes.emplace_back();
+                    ReadObject(json, [&](const Span& field)
+                    {
+                        if (Is(field, "nodes")) ReadArray(json, [&](size_t) { doc.scene_nodes.back().push_back(ReadInt(json)); });
+                        else SkipValue(json);
+                    });
+                });
+            }
+            else if (Is(key, "scene")) doc.scene = ReadInt(json);
+            else SkipValue(json);
+        });
+    }
+
+    // one component of one element as a float, normalized integers map to [0,1] or [-1,1]
+    static inline float ReadComponent(const unsigned char* at, int type, bool normalized)
+    {
+        switch (type)
+        {
+            case FLOAT: { float v; memcpy(&v, at, 4); return v; }
+            case UNSIGNED_BYTE: { uint8_t v = *at; return normalized ? v / 255.0f : (float)v; }
+            case BYTE: { int8_t v = (int8_t)*at; return normalized ? fmaxf(v / 127.0f, -1.0f) : (float)v; }
+            case UNSIGNED_SHORT: { uint16_t v; memcpy(&v, at, 2); return normalized ? v / 65535.0f : (float)v; }
+            case SHORT: { int16_t v; memcpy(&v, at, 2); return normalized ? fmaxf(v / 32767.0f, -1.0f) : (float)v; }
+            case UNSIGNED_INT: { uint32_t v; memcpy(&v, at, 4); return (float)v; }
+        }
+        return 0.0f;
+    }
+
+    static inline size_t ComponentSize(int type)
+    {
+        if (type == BYTE || type == UNSIGNED_BYTE) return 1;
+        if (type == SHORT || type == UNSIGNED_SHORT) return 2;
+        return 4;
+    }
+
+    // start of the accessor data and its element stride, nullptr if it does not fit the BIN chunk
+    static inline const unsigned char* AccessorData(const Document& doc, const unsigned char* bin, size_t bin_size,
+                                                    const Accessor& a, size_t& stride)
+    {
+        if (a.buffer_view < 0 || a.buffer_view >= (int)doc.views.size() || a.sparse) return nullptr;
+
+        const BufferView& view = doc.views[a.buffer_view];
+        size_t element = ComponentSize(a.component_type) * a.components;
+        stride = view.stride ? view.stride : element;
+
+        size_t begin = view.offset + a.offset;
+        size_t bytes = a.count ? (a.count - 1) * stride + element : 0;
+        if (view.buffer != 0 || begin + bytes > view.offset + view.length || view.offset + view.length > bin_size) return nullptr;
+
+        return bin + begin;
+    }
+
+    // interleaves the attributes into mesh.vertices
+    static inline void DecodeAttribute(std::vector<float>& vertices, int vertex_stride, int offset, int components,
+                                       const unsigned char* data, size_t stride, const Accessor& a, size_t count)
+    {
+        size_t component_size = ComponentSize(a.component_type);
+        for (size_t i = 0; i < count; ++i)
+        {
+            float* out = &vertices[i * vertex_stride + offset];
+            const unsigned char* in = data + i * stride;
+            for (int c = 0; c < components; ++c)
+            {
+                out[c] = c < a.components ? ReadComponent(in + c * component_size, a.component_type, a.normalized) : 0.0f;
+            }
+        }
+    }
+
+    static inline bool DecodePrimitive(const Document& doc, const unsigned char* bin, size_t bin_size,
+                                       const PrimitiveSource& source, GltfPrimitive& primitive)
+    {
+        Mesh& mesh = primitive.mesh;
+
+        if (source.mode != MODE_TRIANGLES || source.position < 0 || source.position >= (int)doc.accessors.size()) return false;
+
+        const Accessor& position = doc.accessors[source.position];
+        const Accessor* normal = source.normal >= 0 && source.normal < (int)doc.accessors.size() ? &doc.accessors[source.normal] : nullptr;
+        const Accessor* texcoord = source.texcoord >= 0 && source.texcoord < (int)doc.accessors.size() ? &doc.accessors[source.texcoord] : nullptr;
+        const Accessor* indices = source.indices >= 0 && source.indices < (int)doc.accessors.size() ? &doc.accessors[source.indices] : nullptr;
+
+        size_t position_stride = 0, normal_stride = 0, texcoord_stride = 0, index_stride = 0;
+        const unsigned char* position_data = AccessorData(doc, bin, bin_size, position, position_stride);
+        const unsigned char* normal_data = normal ? AccessorData(doc, bin, bin_size, *normal, normal_stride) : nullptr;
+        const unsigned char* texcoord_data = texcoord ? AccessorData(doc, bin, bin_size, *texcoord, texcoord_stride) : nullptr;
+        const unsigned char* index_data = indices ? AccessorData(doc, bin, bin_size, *indices, index_stride) : nullptr;
+
+        if (!position_data || (normal && !normal_data) || (texcoord && !texcoord_data) || (indices && !index_data)) return false;
+        if ((normal && normal->count != position.count) || (texcoord && texcoord->count != position.count)) return false;
+
+        mesh.layout = MESH_ATTRIB_POSITION;
+        if (normal) mesh.layout |= MESH_ATTRIB_NORMAL;
+        if (texcoord) mesh.layout |= MESH_ATTRIB_UV;
+
+        int vertex_stride = Mesh_VertexStride(mesh.layout);
+        size_t count = position.count;
+
+        // already interleaved exactly like Mesh: float attributes at our offsets in one view
+        bool direct = position.component_type == FLOAT && position.components == 3 &&
+                      position_stride == vertex_stride * sizeof(float);
+        size_t offset = 3 * sizeof(float);
+        if (direct && normal)
+        {
+            direct = normal->component_type == FLOAT && normal->components == 3 &&
+                     normal_data == position_data + offset && normal_stride == position_stride;
+            offset += 3 * sizeof(float);
+        }
+        if (direct && texcoord)
+        {
+            direct = texcoord->component_type == FLOAT && texcoord->components == 2 &&
+                     texcoord_data == position_data + offset && texcoord_stride == position_stride;
+        }
+
+        if (direct) primitive.vertex_data = position_data;
+        else
+        {
+            mesh.vertices.resize(count * vertex_stride);
+            DecodeAttribute(mesh.vertices, vertex_stride, 0, 3, position_data, position_stride, position, count);
+            if (normal) DecodeAttribute(mesh.vertices, vertex_stride, 3, 3, normal_data, normal_stride, *normal, count);
+            if (texcoord) DecodeAttribute(mesh.vertices, vertex_stride, normal ? 6 : 3, 2, texcoord_data, texcoord_stride, *texcoord, count);
+        }
+
+        mesh.vertex_count = (unsigned int)count;
+        mesh.use_indices = indices != nullptr;
+        mesh.index_count = indices ? (unsigned int)indices->count : 0;
+
+        if (indices)
+        {
+            if (indices->component_type == UNSIGNED_INT && index_stride == 4 && ((uintptr_t)index_data & 3) == 0)
+            {
+                primitive.index_data = (const unsigned int*)index_data;
+            }
+            else
+            {
+                mesh.indices.resize(indices->count);
+                for (size_t i = 0; i < indices->count; ++i)
+                {
+                    const unsigned char* in = index_data + i * index_stride;
+                    if (indices->component_type == UNSIGNED_BYTE) mesh.indices[i] = *in;
+                    else if (indices->component_type == UNSIGNED_SHORT) { uint16_t v; memcpy(&v, in, 2); mesh.indices[i] = v; }
+                    else { uint32_t v; memcpy(&v, in, 4); mesh.indices[i] = v; }
+                }
+            }
+
+            // an index past the last vertex would fetch outside the vertex buffer
+            const unsigned int* index = primitive.index_data ? primitive.index_data : mesh.indices.data();
+            for (size_t i = 0; i < indices->count; ++i)
+            {
+                if (index[i] < count) continue;
+
+                primitive.vertex_data = nullptr;
+                primitive.index_data = nullptr;
+                std::vector<float>().swap(mesh.vertices);
+                std::vector<unsigned int>().swap(mesh.indices);
+                return false;
+            }
+        }
+
+        // POSITION is required to carry min/max, so the bounds usually come for free
+        if (position.has_bounds)
+        {
+            mesh.bounds_min = {position.min[0], position.min[1], position.min[2]};
+            mesh.bounds_max = {position.max[0], position.max[1], position.max[2]};
+        }
+        else if (direct)
+        {
+            // nothing was decoded into mesh.vertices, read the float positions where they lie
+            Vector3 lo = {0.0f, 0.0f, 0.0f}, hi = {0.0f, 0.0f, 0.0f};
+            for (size_t i = 0; i < count; ++i)
+            {
+                float p[3];
+                memcpy(p, position_data + i * position_stride, sizeof(p));
+                Vector3 v = {p[0], p[1], p[2]};
+                lo = i == 0 ? v : Vector3{fminf(lo.x, v.x), fminf(lo.y, v.y), fminf(lo.z, v.z)};
+                hi = i == 0 ? v : Vector3{fmaxf(hi.x, v.x), fmaxf(hi.y, v.y), fmaxf(hi.z, v.z)};
+            }
+            mesh.bounds_min = lo;
+            mesh.bounds_max = hi;
+        }
+        else Mesh_ComputeBounds(mesh, mesh.bounds_min, mesh.bounds_max);
+
+        mesh.VAO = 0;
+        mesh.VBO = 0;
+        mesh.EBO = 0;
+        mesh.initialized = 0;
+        return true;
+    }
+
+    static inline Matrix4 LocalMatrix(const GltfNode& node)
+    {
+        if (node.has_matrix) return node.matrix;
+
+        Matrix4 rotation_scale = Math_Mat4Multiply(Math_QuatConvertToMat4(node.rotation), Math_Mat4Scale(node.scale));
+        return Math_Mat4Multiply(Math_Mat4Translate(node.translation), rotation_scale);
+    }
+
+    static inline void UpdateNode(GltfScene& scene, int index, const Matrix4& parent, int depth)
+    {
+        // a cyclic hierarchy is invalid glTF, do not recurse forever on one
+        if (index < 0 || index >= (int)scene.nodes.size() || depth > 1024) return;
+
+        GltfNode& node = scene.nodes[index];
+        node.world = Math_Mat4Multiply(parent, LocalMatrix(node));
+
+        for (int child : node.children) UpdateNode(scene, child, node.world, depth + 1);
+    }
+}
+
+// recomputes every world matrix from the node TRS, call after editing nodes
+static inline void Gltf_UpdateTransforms(GltfScene& scene)
+{
+    for (int root : scene.roots) gltf_detail::UpdateNode(scene, root, Math_Mat4Identity(), 0);
+}
+
+// maps and decodes a .glb, the meshes are ready for Gltf_Generate
+// throws std::ios_base::failure if the file can not be opened, returns -1 if it is not valid glTF
+static inline int Gltf_Load(GltfScene& scene, const char* file)
+{
+    using namespace gltf_detail;
+
+    scene.file = File_Map(file);
+    const unsigned char* data = (const unsigned char*)scene.file.data;
+    size_t size = scene.file.size;
+
+    uint32_t header[5];
+    if (size < sizeof(header))
+    {
+        std::cout << "Not a glb file: " << file << std::endl;
+        File_Unmap(scene.file);
+        return -1;
+    }
+    memcpy(header, data, sizeof(header));
+
+    if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size || header[4] != CHUNK_JSON || 20 + (size_t)header[3] > size)
+    {
+        std::cout << "Not a glTF 2.0 glb file: " << file << std::endl;
+        File_Unmap(scene.file);
+        return -1;
+    }
+
+    const char* json_data = (const char*)data + 20;
+    size_t json_size = header[3];
+
+    // the BIN chunk is optional and 4 byte aligned after the JSON
+    const unsigned char* bin = nullptr;
+    size_t bin_size = 0;
+    size_t bin_header = 20 + ((json_size + 3) & ~(size_t)3);
+    if (bin_header + 8 <= size)
+    {
+        uint32_t chunk[2];
+        memcpy(chunk, data + bin_header, sizeof(chunk));
+        if (chunk[1] == CHUNK_BIN && bin_header + 8 + chunk[0] <= size)
+        {
+            bin = data + bin_header + 8;
+            bin_size = chunk[0];
+        }
+    }
+
+    Document doc;
+    Json json = {json_data, json_data + json_size, false, 0};
+    ReadDocument(json, scene, doc);
+
+    if (json.error)
+    {
+        std::cout << "Malformed glTF JSON: " << file << std::endl;
+        File_Unmap(scene.file);
+        return -1;
+    }
+
+    if (doc.external_buffers) std::cout << "glTF external buffers are not supported: " << file << std::endl;
+
+    // every primitive decodes independently
+    std::vector<std::pair<int, int>> work;
+    for (size_t m = 0; m < scene.meshes.size(); ++m)
+    {
+        for (size_t p = 0; p < scene.meshes[m].primitives.size(); ++p) work.push_back({(int)m, (int)p});
+    }
+
+    std::vector<char> decoded(work.size(), 0);
+    Thread_ParallelFor(work.size(), 1, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            const PrimitiveSource& source = doc.sources[work[i].first][work[i].second];
+            GltfPrimitive& primitive = scene.meshes[work[i].first].primitives[work[i].second];
+            decoded[i] = DecodePrimitive(doc, bin, bin_size, source, primitive);
+        }
+    });
+
+    for (size_t i = 0; i < work.size(); ++i)
+    {
+        if (!decoded[i])
+        {
+            std::cout << "Skipped glTF primitive " << work[i].second << " of mesh " << work[i].first
+                      << " (not triangles, sparse, out of range or bad indices): " << file << std::endl;
+        }
+    }
+
+    // hierarchy
+    for (size_t i = 0; i < scene.nodes.size(); ++i)
+    {
+        for (int child : scene.nodes[i].children)
+        {
+            if (child >= 0 && child < (int)scene.nodes.size()) scene.nodes[child].parent = (int)i;
+        }
+    }
+
+    if (doc.scene >= 0 && doc.scene < (int)doc.scene_nodes.size()) scene.roots = doc.scene_nodes[doc.scene];
+    else
+    {
+        for (size_t i = 0; i < scene.nodes.size(); ++i)
+        {
+            if (scene.nodes[i].parent == -1) scene.roots.push_back((int)i);
+        }
+    }
+
+    Gltf_UpdateTransforms(scene);
+
+    return 0;
+}
+
+// uploads every decoded primitive and releases the mapped file
+static inline void Gltf_Generate(GltfScene& scene)
+{
+    for (GltfMesh& mesh : scene.meshes)
+    {
+        for (GltfPrimitive& primitive : mesh.primitives)
+        {
+            Mesh& m = primitive.mesh;
+            if (m.initialized == -1) continue;
+
+            const void* vertices = primitive.vertex_data ? primitive.vertex_data : m.vertices.data();
+            const unsigned int* indices = primitive.index_data ? primitive.index_data : m.indices.data();
+
+            Mesh_GenerateFrom(m, vertices, m.vertex_count, indices, m.index_count);
+
+            primitive.vertex_data = nullptr;
+            primitive.index_data = nullptr;
+        }
+    }
+
+    File_Unmap(scene.file);
+}
+
+// draws every node with a mesh using its world matrix and material base colour
+static inline void Gltf_Draw(GltfScene& scene, Shader& shader, const Matrix4& model)
+{
+    for (const GltfNode& node : scene.nodes)
+    {
+        if (node.mesh < 0 || node.mesh >= (int)scene.meshes.size()) continue;
+
+        Shader_SetUniformMat4(shader, "uModel", Math_Mat4Multiply(model, node.world));
+
+        for (const GltfPrimitive& primitive : scene.meshes[node.mesh].primitives)
+        {
+            if (primitive.mesh.initialized == -1) continue;
+
+            Vector4 colour = {1.0f, 1.0f, 1.0f, 1.0f};
+            if (primitive.material >= 0 && primitive.material < (int)scene.materials.size()) colour = scene.materials[primitive.material].base_colour;
+
+            Shader_SetUniform4f(shader, "uColor", colour);
+            Mesh_Draw(primitive.mesh);
+        }
+    }
+}
+
+static inline void Gltf_Delete(GltfScene& scene)
+{
+    for (GltfMesh& mesh : scene.meshes)
+    {
+        for (GltfPrimitive& primitive : mesh.primitives) Mesh_Delete(primitive.mesh);
+    }
+
+    File_Unmap(scene.file);
+    scene.meshes.clear();
+    scene.materials.clear();
+    scene.nodes.clear();
+    scene.roots.clear();
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef INDIRECT_UTILITY_H
+#define INDIRECT_UTILITY_H
+
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include "glext_utility.h"
+#include "math_utility.h"
+#include "mesh_utility.h"
+#include "geometry_pool_utility.h"
+#include "shader_utility.h"
+
+/*
+    Multi draw indirect submission
+
+    Draws of pooled meshes are collected into one bucket per (shader, pool).
+    On submit each bucket becomes a DrawElementsIndirectCommand array and
+    one glMultiDrawElementsIndirect call, so the CPU cost no longer grows
+    with the number of draws.
+
+    Per draw data (model matrix and colour) goes into a texture buffer,
+    which a 3.3 shader can read. The draw index reaches the shader as an
+    instanced attribute (location 7) fed by baseInstance. Without indirect
+    support the same shader runs from a plain loop, the draw index is then
+    set as the current value of that attribute before each draw.
+
+    Use shaders/indirect_vertex.glsl and shaders/indirect_fragment.glsl.
+*/
+
+static constexpr unsigned int INDIRECT_DRAW_ID_LOCATION = 7;
+static constexpr int INDIRECT_TEXELS_PER_DRAW = 5;
+
+// layout fixed by GL
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+struct IndirectBatch
+{
+    Shader* shader;
+    GeometryPool* pool;
+    GLenum primitive;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<Vector4> draw_data;     // INDIRECT_TEXELS_PER_DRAW per command
+};
+
+struct IndirectRenderer
+{
+    std::vector<IndirectBatch> batches;
+    size_t last_batch = 0;
+
+    unsigned int command_buffer = 0;
+    unsigned int data_buffer = 0;
+    unsigned int data_texture = 0;
+
+    // 0, 1, 2, ... read through the instanced draw id attribute
+    unsigned int id_buffer = 0;
+    unsigned int id_capacity = 0;
+
+    // draws per submission, bounded by GL_MAX_TEXTURE_BUFFER_SIZE
+    unsigned int max_draws = 0;
+};
+
+static inline void Indirect_Init(IndirectRenderer& renderer)
+{
+    glGenBuffers(1, &renderer.command_buffer);
+    glGenBuffers(1, &renderer.data_buffer);
+    glGenBuffers(1, &renderer.id_buffer);
+    glGenTextures(1, &renderer.data_texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, renderer.data_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, INDIRECT_TEXELS_PER_DRAW * sizeof(Vector4), NULL, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, renderer.data_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, renderer.data_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    renderer.max_draws = (unsigned int)max_texels / INDIRECT_TEXELS_PER_DRAW;
+    if (renderer.max_draws == 0) renderer.max_draws = 1;
+}
+
+// starts a new frame of draws, buckets keep their memory
+static inline void Indirect_Begin(IndirectRenderer& renderer)
+{
+    for (IndirectBatch& batch : renderer.batches)
+    {
+        batch.commands.clear();
+        batch.draw_data.clear();
+    }
+}
+
+// queues one draw of a pooled, indexed mesh
+static inline void Indirect_Add(IndirectRenderer& renderer, Shader& shader, const Mesh& mesh, const Matrix4& model, const Vector4& colour)
+{
+    if (!mesh.pool || !mesh.use_indices)
+    {
+        std::cout << "Indirect draws need an indexed mesh in a GeometryPool" << std::endl;
+        return;
+    }
+
+    // consecutive draws almost always hit the same bucket
+    IndirectBatch* batch = nullptr;
+    if (renderer.last_batch < renderer.batches.size())
+    {
+        IndirectBatch& last = renderer.batches[renderer.last_batch];
+        if (last.shader == &shader && last.pool == mesh.pool && last.primitive == mesh.primitive) batch = &last;
+    }
+
+    if (!batch)
+    {
+        for (size_t i = 0; i < renderer.batches.size(); ++i)
+        {
+            const IndirectBatch& candidate = renderer.batches[i];
+            if (candidate.shader == &shader && candidate.pool == mesh.pool && candidate.primitive == mesh.primitive)
+            {
+                batch = &renderer.batches[i];
+                renderer.last_batch = i;
+                break;
+            }
+        }
+    }
+
+    if (!batch)
+    {
+        renderer.batches.push_back({&shader, mesh.pool, mesh.primitive, {}, {}});
+        renderer.last_batch = renderer.batches.size() - 1;
+        batch = &renderer.batches.back();
+    }
+
+    GLuint draw_index = (GLuint)batch->commands.size();
+    batch->commands.push_back({mesh.index_count, 1, mesh.first_index, (GLint)mesh.base_vertex, draw_index});
+
+    const float* m = model.m;
+    batch->draw_data.push_back({m[0], m[1], m[2], m[3]});
+    batch->draw_data.push_back({m[4], m[5], m[6], m[7]});
+    batch->draw_data.push_back({m[8], m[9], m[10], m[11]});
+    batch->draw_data.push_back({m[12], m[13], m[14], m[15]});
+    batch->draw_data.push_back(colour);
+}
+
+namespace indirect_detail
+{
+    static inline void EnsureIds(IndirectRenderer& renderer, unsigned int count)
+    {
+        if (count <= renderer.id_capacity) return;
+
+        unsigned int capacity = renderer.id_capacity ? renderer.id_capacity : 1024;
+        while (capacity < count) capacity *= 2;
+
+        std::vector<GLuint> ids(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) ids[i] = i;
+
+        glBindBuffer(GL_ARRAY_BUFFER, renderer.id_buffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+        renderer.id_capacity = capacity;
+    }
+}
+
+// draws every queued bucket, one multi draw per bucket (and per max_draws draws)
+static inline void Indirect_Submit(IndirectRenderer& renderer, const Matrix4& view, const Matrix4& projection)
+{
+    bool indirect = GLExt_Caps().multi_draw_indirect;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, renderer.data_texture);
+
+    for (IndirectBatch& batch : renderer.batches)
+    {
+        unsigned int count = (unsigned int)batch.commands.size();
+        if (count == 0) continue;
+
+        Shader_Enable(*batch.shader);
+        Shader_SetUniformMat4(*batch.shader, "uView", view);
+        Shader_SetUniformMat4(*batch.shader, "uProjection", projection);
+        Shader_SetUniform1i(*batch.shader, "uDrawData", 0);
+
+        Mesh_SetPrimitiveRestart(batch.primitive != GL_TRIANGLES);
+        Mesh_BindVertexArray(batch.pool->VAO);
+
+        if (indirect)
+        {
+            indirect_detail::EnsureIds(renderer, count);
+            glBindBuffer(GL_ARRAY_BUFFER, renderer.id_buffer);
+            glVertexAttribIPointer(INDIRECT_DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, (void*)0);
+            glVertexAttribDivisor(INDIRECT_DRAW_ID_LOCATION, 1);
+            glEnableVertexAttribArray(INDIRECT_DRAW_ID_LOCATION);
+        }
+        else glDisableVertexAttribArray(INDIRECT_DRAW_ID_LOCATION);
+
+        for (unsigned int start = 0; start < count; start += renderer.max_draws)
+        {
+            unsigned int n = count - start < renderer.max_draws ? count - start : renderer.max_draws;
+
+            // orphan and refill, the previous contents may still be in flight
+            glBindBuffer(GL_TEXTURE_BUFFER, renderer.data_buffer);
+            glBufferData(GL_TEXTURE_BUFFER, (size_t)n * INDIRECT_TEXELS_PER_DRAW * sizeof(Vector4),
+                         &batch.draw_data[(size_t)start * INDIRECT_TEXELS_PER_DRAW], GL_STREAM_DRAW);
+            Shader_SetUniform1i(*batch.shader, "uDrawBase", (int)start);
+
+            if (indirect)
+            {
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.command_buffer);
+                glBufferData(GL_DRAW_INDIRECT_BUFFER, (size_t)n * sizeof(DrawElementsIndirectCommand), &batch.commands[start], GL_STREAM_DRAW);
+                glext::MultiDrawElementsIndirect(batch.primitive, GL_UNSIGNED_INT, (void*)0, (GLsizei)n, 0);
+            }
+            else
+            {
+                for (unsigned int i = start; i < start + n; ++i)
+                {
+                    const DrawElementsIndirectCommand& cmd = batch.commands[i];
+                    glVertexAttribI1ui(INDIRECT_DRAW_ID_LOCATION, cmd.base_instance);
+                    glDrawElementsBaseVertex(batch.primitive, cmd.count, GL_UNSIGNED_INT,
+                                             (void*)((size_t)cmd.first_index * sizeof(unsigned int)), cmd.base_vertex);
+                }
+            }
+        }
+    }
+
+    Mesh_SetPrimitiveRestart(false);
+    if (indirect) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+static inline void Indirect_Delete(IndirectRenderer& renderer)
+{
+    if (renderer.command_buffer) glDeleteBuffers(1, &renderer.command_buffer);
+    if (renderer.data_buffer) glDeleteBuffers(1, &renderer.data_buffer);
+    if (renderer.id_buffer) glDeleteBuffers(1, &renderer.id_buffer);
+    if (renderer.data_texture) glDeleteTextures(1, &renderer.data_texture);
+
+    renderer.command_buffer = 0;
+    renderer.data_buffer = 0;
+    renderer.id_buffer = 0;
+    renderer.data_texture = 0;
+    renderer.id_capacity = 0;
+    renderer.batches.clear();
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef MATERIAL_UTILITY_H
+#define MATERIAL_UTILITY_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <glad/glad.h>
+#include "math_utility.h"
+#include "shader_reflect_utility.h"
+#include "shader_utility.h"
+
+/*
+    Materials
+
+    A material is a shader plus a packed parameter block (MaterialParams).
+    Every block lives in one uniform buffer owned by the MaterialLibrary;
+    shaders include shaders/material.glsl and read their parameters as
+    uMaterials[index]. The index reaches the shader as the current value
+    of a uint vertex attribute (MATERIAL_INDEX_LOCATION) that no VAO
+    enables, so switching between materials of the same shader is one
+    glVertexAttribI1ui and no uniform call at all.
+
+    A uniform block is only guaranteed 16 KB, so the buffer is split into
+    pages of MATERIAL_PAGE_SIZE blocks and the page holding a material is
+    bound with glBindBufferRange when it changes. Sorting draws by
+    Material_SortKey keeps shader changes, then page changes, rare.
+
+    Material ids are stable for the life of the material and are reused
+    after Material_Destroy. Parameter edits are uploaded by Material_Upload,
+    call it once per frame before drawing.
+
+    MaterialParams is checked against std140 when compiled; Material_Validate
+    checks a linked material shader's Materials block against it as well.
+*/
+
+static constexpr unsigned int MATERIAL_PAGE_SIZE = 256;         // 16 KB of blocks, the smallest max block size GL allows
+static constexpr unsigned int MATERIAL_BINDING = 1;             // uniform buffer binding point of the Materials block
+static constexpr unsigned int MATERIAL_INDEX_LOCATION = 6;      // uint attribute carrying the index within the page
+static constexpr unsigned int MATERIAL_INVALID = 0xFFFFFFFFu;
+
+// std140 array element, only vec4s so the C++ and GLSL layouts agree
+struct MaterialParams
+{
+    Vector4 colour = {1.0f, 1.0f, 1.0f, 1.0f};
+    Vector4 params[3] = {};     // free for the shader: roughness, metalness, scales...
+};
+
+LAYOUT_CHECK_STD140(MaterialParams, LAYOUT_FIELD(MaterialParams, colour), LAYOUT_FIELD(MaterialParams, params));
+
+struct MaterialLibrary
+{
+    std::vector<MaterialParams> params;     // by material id
+    std::vector<Shader*> shaders;           // by material id, null when free
+    std::vector<unsigned int> free_ids;
+
+    unsigned int buffer = 0;
+    unsigned int capacity = 0;              // materials the buffer holds, a whole number of pages
+    unsigned int dirty_first = MATERIAL_INVALID;
+    unsigned int dirty_last = 0;
+
+    // what Material_Use last bound, cleared by Material_Reset
+    unsigned int bound_program = 0;
+    unsigned int bound_page = MATERIAL_INVALID;
+};
+
+namespace material_detail
+{
+    static inline void MarkDirty(MaterialLibrary& library, unsigned int id)
+    {
+        if (library.dirty_first == MATERIAL_INVALID || id < library.dirty_first) library.dirty_first = id;
+        if (id > library.dirty_last) library.dirty_last = id;
+    }
+}
+
+static inline void Material_Init(MaterialLibrary& library)
+{
+    library.params.clear();
+    library.shaders.clear();
+    library.free_ids.clear();
+    library.capacity = 0;
+    library.dirty_first = MATERIAL_INVALID;
+    library.dirty_last = 0;
+    library.bound_program = 0;
+    library.bound_page = MATERIAL_INVALID;
+    glGenBuffers(1, &library.buffer);
+}
+
+// returns the new material's id
+static inline unsigned int Material_Create(MaterialLibrary& library, Shader& shader, const MaterialParams& params = MaterialParams())
+{
+    unsigned int id;
+    if (!library.free_ids.empty())
+    {
+        id = library.free_ids.back();
+        library.free_ids.pop_back();
+        library.params[id] = params;
+        library.shaders[id] = &shader;
+    }
+    else
+    {
+        id = (unsigned int)library.params.size();
+        library.params.push_back(params);
+        library.shaders.push_back(&shader);
+    }
+
+    material_detail::MarkDirty(library, id);
+    return id;
+}
+
+static inline void Material_Set(MaterialLibrary& library, unsigned int id, const MaterialParams& params)
+{
+    if (id >= library.params.size() || !library.shaders[id]) return;
+    library.params[id] = params;
+    material_detail::MarkDirty(library, id);
+}
+
+static inline const MaterialParams& Material_Get(const MaterialLibrary& library, unsigned int id)
+{
+    return library.params[id];
+}
+
+static inline Shader* Material_Shader(const MaterialLibrary& library, unsigned int id)
+{
+    return id < library.shaders.size() ? library.shaders[id] : nullptr;
+}
+
+// the id may be handed out again by a later Material_Create
+static inline void Material_Destroy(MaterialLibrary& library, unsigned int id)
+{
+    if (id >= library.shaders.size() || !library.shaders[id]) return;
+    library.shaders[id] = nullptr;
+    library.free_ids.push_back(id);
+}
+
+// sends edited blocks to the GPU, the buffer doubles when it runs out of pages
+static inline void Material_Upload(MaterialLibrary& library)
+{
+    unsigned int count = (unsigned int)library.params.size();
+    if (count == 0) return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, library.buffer);
+
+    if (count > library.capacity)
+    {
+        unsigned int capacity = library.capacity ? library.capacity : MATERIAL_PAGE_SIZE;
+        while (capacity < count) capacity *= 2;
+
+        // the whole array goes up with the new storage, nothing is left dirty
+        std::vector<MaterialParams> padded(capacity);
+        std::copy(library.params.begin(), library.params.end(), padded.begin());
+        glBufferData(GL_UNIFORM_BUFFER, capacity * sizeof(MaterialParams), padded.data(), GL_DYNAMIC_DRAW);
+
+        library.capacity = capacity;
+        library.bound_page = MATERIAL_INVALID;
+    }
+    else if (library.dirty_first != MATERIAL_INVALID)
+    {
+        unsigned int first = library.dirty_first;
+        unsigned int last = library.dirty_last < count ? library.dirty_last : count - 1;
+        glBufferSubData(GL_UNIFORM_BUFFER, first * sizeof(MaterialParams), (last - first + 1) * sizeof(MaterialParams),
+                        &library.params[first]);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    library.dirty_first = MATERIAL_INVALID;
+    library.dirty_last = 0;
+}
+
+// forget what is bound, call when other code may have changed the program (start of a pass)
+static inline void Material_Reset(MaterialLibrary& library)
+{
+    library.bound_program = 0;
+    library.bound_page = MATERIAL_INVALID;
+}
+
+// makes the material current for the next draws, true if its shader had to be bound
+// (set that shader's per pass uniforms, view and projection, when it is)
+// a destroyed or unknown id binds nothing and returns false
+static inline bool Material_Use(MaterialLibrary& library, unsigned int id)
+{
+    if (id >= library.shaders.size() || !library.shaders[id])
+    {
+        std::cout << "Material " << id << " does not exist" << std::endl;
+        return false;
+    }
+
+    Shader* shader = library.shaders[id];
+    bool switched = shader->program != library.bound_program;
+
+    if (switched)
+    {
+        Shader_Enable(*shader);
+
+        // set every time the program is bound, a hot reloaded program starts without it
+        GLuint block = glGetUniformBlockIndex(shader->program, "Materials");
+        if (block != GL_INVALID_INDEX) glUniformBlockBinding(shader->program, block, MATERIAL_BINDING);
+        library.bound_program = shader->program;
+    }
+
+    unsigned int page = id / MATERIAL_PAGE_SIZE;
+    if (page != library.bound_page)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BINDING, library.buffer,
+                          (GLintptr)page * MATERIAL_PAGE_SIZE * sizeof(MaterialParams),
+                          MATERIAL_PAGE_SIZE * sizeof(MaterialParams));
+        library.bound_page = page;
+    }
+
+    glVertexAttribI1ui(MATERIAL_INDEX_LOCATION, id % MATERIAL_PAGE_SIZE);
+    return switched;
+}
+
+// shader in the top bits, then material, then depth (0 near, 1 far): sorted ascending this
+// changes program least, pages next, and draws each material's opaque objects front to back
+static inline uint64_t Material_SortKey(const MaterialLibrary& library, unsigned int id, float depth = 0.0f)
+{
+    uint64_t program = library.shaders[id] ? library.shaders[id]->program & 0xFFFF : 0xFFFF;
+    depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+    return (program << 48) | ((uint64_t)(id & 0xFFFFFF) << 24) | (uint64_t)(depth * 0xFFFFFF);
+}
+
+// true if the shader reads MaterialParams where the library writes them, prints what differs otherwise
+// (reflects the whole program, call after building or reloading a shader rather than per frame)
+static inline bool Material_Validate(const Shader& shader)
+{
+    std::vector<ShaderBlock> blocks = ShaderReflect_Blocks(shader);
+    const ShaderBlock* block = ShaderReflect_Find(blocks, "Materials");
+    if (!block)
+    {
+        std::cout << "Shader has no active Materials block" << std::endl;
+        return false;
+    }
+
+    std::vector<ShaderLayoutMember> members = {LAYOUT_MEMBER(MaterialParams, colour), LAYOUT_MEMBER(MaterialParams, params)};
+    return ShaderReflect_Validate(*block, members, sizeof(MaterialParams), "uMaterials") == 0;
+}
+
+static inline void Material_Delete(MaterialLibrary& library)
+{
+    if (library.buffer) glDeleteBuffers(1, &library.buffer);
+    library.buffer = 0;
+    library.params.clear();
+    library.shaders.clear();
+    library.free_ids.clear();
+    library.capacity = 0;
+}
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef MESH_CACHE_UTILITY_H
+#define MESH_CACHE_UTILITY_H
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <glad/glad.h>
+#include "file_utility.h"
+#include "mesh_utility.h"
+
+/*
+    Binary mesh cache (.gbm)
+
+    Written offline by the cook tool (src/cook.cpp), loaded by mapping the
+    file and handing the vertex and index blobs straight to glBufferData.
+    Nothing is parsed or converted at load time, the header says where
+    everything is.
+
+    [header][attributes][lods][pad][vertex blob][pad][index blob]
+
+    Blobs start on a 64 byte boundary. The format is little endian, which is
+    every machine we ship on. Bump MESH_CACHE_VERSION on any layout change,
+    old files are rejected and recooked.
+*/
+
+static constexpr uint32_t MESH_CACHE_VERSION = 2;
+static constexpr uint64_t MESH_CACHE_ALIGN = 64;
+
+struct MeshCacheHeader
+{
+    char magic[4];              // "GBMC"
+    uint32_t version;
+    uint32_t layout;            // MeshAttribute bits the data was cooked from
+    uint32_t vertex_stride;     // bytes
+    uint32_t vertex_count;
+    uint32_t index_count;       // all lods together
+    uint32_t attribute_count;
+    uint32_t lod_count;
+    uint32_t primitive;         // GL enum, strips use MESH_RESTART_INDEX
+    uint32_t reserved;
+    uint64_t attributes_offset;
+    uint64_t lods_offset;
+    uint64_t vertex_offset;
+    uint64_t vertex_size;
+    uint64_t index_offset;
+    uint64_t index_size;
+    uint64_t file_size;
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+// one glVertexAttribPointer call
+struct MeshCacheAttribute
+{
+    uint32_t location;
+    uint32_t components;
+    uint32_t type;              // GL enum
+    uint32_t normalized;
+    uint32_t offset;            // bytes into the vertex
+};
+
+// lod 0 is the full mesh, later lods are coarser index lists over the same vertices
+struct MeshCacheLod
+{
+    uint32_t first_index;
+    uint32_t index_count;
+    float error;                // object space error of the simplification
+    uint32_t reserved;
+};
+
+namespace mesh_cache_detail
+{
+    static inline uint64_t Align(uint64_t value)
+    {
+        return (value + MESH_CACHE_ALIGN - 1) & ~(MESH_CACHE_ALIGN - 1);
+    }
+
+    static inline void AttributesForLayout(unsigned int layout, std::vector<MeshCacheAttribute>& attributes)
+    {
+        uint32_t offset = 0;
+
+        if (layout & MESH_ATTRIB_QUANTIZED)
+        {
+            attributes.push_back({0, 3, GL_UNSIGNED_SHORT, 1, offset});
+            offset += 4 * sizeof(uint16_t);
+        }
+        else
+        {
+            attributes.push_back({0, 3, GL_FLOAT, 0, offset});
+            offset += 3 * sizeof(float);
+        }
+
+        if (layout & MESH_ATTRIB_NORMAL)
+        {
+            attributes.push_back({1, 3, GL_FLOAT, 0, offset});
+            offset += 3 * sizeof(float);
+        }
+
+        if (layout & MESH_ATTRIB_UV)
+        {
+            attributes.push_back({2, 2, GL_FLOAT, 0, offset});
+            offset += 2 * sizeof(float);
+        }
+
+        if (layout & MESH_ATTRIB_TANGENT)
+        {
+            attributes.push_back({3, 4, GL_FLOAT, 0, offset});
+        }
+    }
+
+    static inline uint32_t TypeSize(uint32_t type)
+    {
+        switch (type)
+        {
+        case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+        case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+        case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+        default: return 0;
+        }
+    }
+
+    // everything the draw calls will trust: blob sizes, attributes inside the vertex, lods inside the indices
+    static inline bool Consistent(const MeshCacheHeader& header, const MeshCacheAttribute* attributes, const MeshCacheLod* lods)
+    {
+        if (header.vertex_size != (uint64_t)header.vertex_count * header.vertex_stride) return false;
+        if (header.index_size != (uint64_t)header.index_count * sizeof(uint32_t)) return false;
+
+        for (uint32_t i = 0; i < header.attribute_count; ++i)
+        {
+            const MeshCacheAttribute& a = attributes[i];
+            uint32_t size = TypeSize(a.type);
+            if (size == 0 || a.components < 1 || a.components > 4 || a.location >= 16) return false;
+            if ((uint64_t)a.offset + (uint64_t)a.components * size > header.vertex_stride) return false;
+        }
+
+        for (uint32_t i = 0; i < header.lod_count; ++i)
+        {
+            if ((uint64_t)lods[i].first_index + lods[i].index_count > header.index_count) return false;
+        }
+        return true;
+    }
+
+    static inline void Pad(std::ofstream& out, uint64_t& at, uint64_t to)
+    {
+        static const char zeros[MESH_CACHE_ALIGN] = {};
+        out.write(zeros, (std::streamsize)(to - at));
+        at = to;
+    }
+}
+
+// cooks the CPU side of a mesh, lods are optional coarser index lists with their error
+// throws std::ios_base::failure if the file can not be written
+static inline void MeshCache_Write(const Mesh& mesh, const char* file,
+                                   const std::vector<std::vector<unsigned int>>& lods = {},
+                                   const std::vector<float>& lod_errors = {})
+{
+    using namespace mesh_cache_detail;
+
+    std::vector<MeshCacheAttribute> attributes;
+    AttributesForLayout(mesh.layout, attributes);
+
+    std::vector<MeshCacheLod> lod_table;
+    uint32_t index_count = 0;
+
+    if (mesh.use_indices)
+    {
+        lod_table.push_back({0, (uint32_t)mesh.indices.size(), 0.0f, 0});
+        index_count += (uint32_t)mesh.indices.size();
+
+        for (size_t i = 0; i < lods.size(); ++i)
+        {
+            float error = i < lod_errors.size() ? lod_errors[i] : 0.0f;
+            lod_table.push_back({index_count, (uint32_t)lods[i].size(), error, 0});
+            index_count += (uint32_t)lods[i].size();
+        }
+    }
+
+    // the mesh may never have been generated, so bounds come from the vertices
+    Vector3 bounds_min, bounds_max;
+    Mesh_ComputeBounds(mesh, bounds_min, bounds_max);
+
+    MeshCacheHeader header = {};
+    memcpy(header.magic, "GBMC", 4);
+    header.version = MESH_CACHE_VERSION;
+    header.layout = mesh.layout;
+    header.vertex_stride = Mesh_VertexStride(mesh.layout) * sizeof(float);
+    header.vertex_count = Mesh_VertexCount(mesh);
+    header.index_count = index_count;
+    header.attribute_count = (uint32_t)attributes.size();
+    header.lod_count = (uint32_t)lod_table.size();
+    header.primitive = mesh.primitive;
+
+    header.attributes_offset = sizeof(MeshCacheHeader);
+    header.lods_offset = header.attributes_offset + attributes.size() * sizeof(MeshCacheAttribute);
+    header.vertex_offset = Align(header.lods_offset + lod_table.size() * sizeof(MeshCacheLod));
+    header.vertex_size = (uint64_t)header.vertex_count * header.vertex_stride;
+    header.index_offset = Align(header.vertex_offset + header.vertex_size);
+    header.index_size = (uint64_t)index_count * sizeof(uint32_t);
+    header.file_size = header.index_offset + header.index_size;
+
+    header.bounds_min[0] = bounds_min.x;
+    header.bounds_min[1] = bounds_min.y;
+    header.bounds_min[2] = bounds_min.z;
+    header.bounds_max[0] = bounds_max.x;
+    header.bounds_max[1] = bounds_max.y;
+    header.bounds_max[2] = bounds_max.z;
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (out.fail())
+    {
+        throw(std::ios_base::failure(std::string("Error opening file: ") + std::string(file)));
+    }
+
+    uint64_t at = 0;
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)attributes.data(), attributes.size() * sizeof(MeshCacheAttribute));
+    out.write((const char*)lod_table.data(), lod_table.size() * sizeof(MeshCacheLod));
+    at = header.lods_offset + lod_table.size() * sizeof(MeshCacheLod);
+
+    Pad(out, at, header.vertex_offset);
+    out.write((const char*)mesh.vertices.data(), (std::streamsize)header.vertex_size);
+    at += header.vertex_size;
+
+    Pad(out, at, header.index_offset);
+    if (mesh.use_indices)
+    {
+        out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+        for (const std::vector<unsigned int>& lod : lods)
+        {
+            out.write((const char*)lod.data(), lod.size() * sizeof(uint32_t));
+        }
+    }
+
+    if (out.fail())
+    {
+        throw(std::ios_base::failure(std::string("Error writing file: ") + std::string(file)));
+    }
+}
+
+// maps a cooked mesh and uploads it as is, the mesh is ready to draw afterwards
+// vertices/indices stay empty, returns -1 if the file is missing, stale or corrupt
+static inline int MeshCache_Load(Mesh& mesh, const char* file, std::vector<MeshCacheLod>* lods = nullptr)
+{
+    MappedFile map;
+    try
+    {
+        map = File_Map(file);
+    }
+    catch (const std::ios_base::failure&)
+    {
+        return -1;
+    }
+
+    MeshCacheHeader header;
+    if (map.size < sizeof(header))
+    {
+        std::cout << "Mesh cache truncated: " << file << std::endl;
+        File_Unmap(map);
+        return -1;
+    }
+    memcpy(&header, map.data, sizeof(header));
+
+    if (memcmp(header.magic, "GBMC", 4) != 0 || header.version != MESH_CACHE_VERSION)
+    {
+        std::cout << "Mesh cache has the wrong version, recook it: " << file << std::endl;
+        File_Unmap(map);
+        return -1;
+    }
+
+    if (header.file_size != map.size ||
+        header.lods_offset + (uint64_t)header.lod_count * sizeof(MeshCacheLod) > map.size ||
+        header.attributes_offset + (uint64_t)header.attribute_count * sizeof(MeshCacheAttribute) > map.size ||
+        header.vertex_offset + header.vertex_size > map.size ||
+        header.index_offset + header.index_size > map.size)
+    {
+        std::cout << "Mesh cache corrupt: " << file << std::endl;
+        File_Unmap(map);
+        return -1;
+    }
+
+    const MeshCacheAttribute* attributes = (const MeshCacheAttribute*)(map.data + header.attributes_offset);
+    const MeshCacheLod* lod_table = (const MeshCacheLod*)(map.data + header.lods_offset);
+
+    if (!mesh_cache_detail::Consistent(header, attributes, lod_table))
+    {
+        std::cout << "Mesh cache corrupt: " << file << std::endl;
+        File_Unmap(map);
+        return -1;
+    }
+
+    // loading over an uploaded mesh replaces it
+    Mesh_Delete(mesh);
+    mesh.layout = header.layout;
+    mesh.use_indices = header.index_count > 0;
+    mesh.primitive = header.primitive;
+    mesh.vertex_count = header.vertex_count;
+    mesh.index_count = header.lod_count > 0 ? lod_table[0].index_count : 0;
+    mesh.vertex_capacity = mesh.vertex_count;
+    mesh.index_capacity = header.index_count;
+    mesh.bounds_min = {header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]};
+    mesh.bounds_max = {header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]};
+
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+    Mesh_BindVertexArray(mesh.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, header.vertex_size, map.data + header.vertex_offset, GL_STATIC_DRAW);
+
+    if (mesh.use_indices)
+    {
+        glGenBuffers(1, &mesh.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, header.index_size, map.data + header.index_offset, GL_STATIC_DRAW);
+    }
+
+    for (uint32_t i = 0; i < header.attribute_count; ++i)
+    {
+        const MeshCacheAttribute& a = attributes[i];
+        glVertexAttribPointer(a.location, a.components, a.type, a.normalized ? GL_TRUE : GL_FALSE,
+                              header.vertex_stride, (void*)(size_t)a.offset);
+        glEnableVertexAttribArray(a.location);
+    }
+
+    Mesh_BindVertexArray(0);
+
+    if (lods) lods->assign(lod_table, lod_table + header.lod_count);
+
+    File_Unmap(map);
+
+    mesh.initialized = 0;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef MESH_MEMORY_UTILITY_H
+#define MESH_MEMORY_UTILITY_H
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <glad/glad.h>
+#include "mesh_utility.h"
+
+/*
+    Mesh memory accounting and GPU residency
+
+    Meshes registered with MeshMemory_Track are counted: CPU bytes are the
+    vertex and index vectors, GPU bytes the buffers they own (capacity, not
+    just what is used). MeshMemory_Use is called for every mesh about to be
+    drawn and stamps it with the current frame.
+
+    MeshMemory_Update runs once per frame after drawing. When the GPU total
+    is over budget, the meshes drawn longest ago lose their buffers; they
+    keep layout, counts and bounds, and initialized becomes 1 so Mesh_Draw
+    skips them. Using an evicted mesh asks for it back, the next Update
+    re-uploads it (at most stream_budget bytes per frame) and it draws
+    again from the frame after.
+
+    Re-uploading needs the data. A mesh either keeps its CPU copy or is
+    tracked with a reload function that refills mesh.vertices/indices or
+    uploads by itself (MeshCache_Load). With drop_cpu_copies the vectors
+    are freed after every upload; meshes without a reload function keep
+    them regardless, otherwise they could never come back. Meshes edited
+    through Mesh_UpdateRange must keep their copies.
+
+    Pooled meshes share their buffers and are not tracked.
+*/
+
+struct MeshMemoryEntry
+{
+    Mesh* mesh = nullptr;
+    std::function<void(Mesh&)> reload;
+    size_t cpu_bytes = 0;
+    size_t gpu_bytes = 0;
+    uint64_t last_used = 0;
+    bool resident = true;
+    bool requested = false;
+};
+
+struct MeshMemoryTracker
+{
+    size_t gpu_budget = 0;              // 0 never evicts
+    size_t stream_budget = 8 << 20;     // re-upload bytes per Update
+    bool drop_cpu_copies = false;
+
+    std::vector<MeshMemoryEntry> entries;
+    std::unordered_map<const Mesh*, size_t> lookup;
+    uint64_t frame = 1;
+
+    // totals as of the last Track or Update
+    size_t cpu_bytes = 0;
+    size_t gpu_bytes = 0;
+    unsigned int evicted = 0;           // meshes not on the GPU right now
+};
+
+// bytes held by the vertex and index vectors
+static inline size_t MeshMemory_CPUBytes(const Mesh& mesh)
+{
+    return mesh.vertices.capacity() * sizeof(float) + mesh.indices.capacity() * sizeof(unsigned int);
+}
+
+// bytes of GPU buffers the mesh owns, 0 for pooled or evicted meshes
+static inline size_t MeshMemory_GPUBytes(const Mesh& mesh)
+{
+    if (mesh.pool || mesh.VAO == 0) return 0;
+    return (size_t)mesh.vertex_capacity * Mesh_VertexStride(mesh.layout) * sizeof(float) +
+           (size_t)mesh.index_capacity * sizeof(unsigned int);
+}
+
+namespace mesh_memory_detail
+{
+    static inline bool CanReload(const MeshMemoryEntry& entry)
+    {
+        return entry.reload || !entry.mesh->vertices.empty();
+    }
+
+    static inline void DropCopy(MeshMemoryTracker& tracker, MeshMemoryEntry& entry)
+    {
+        if (!tracker.drop_cpu_copies || !entry.reload) return;
+        std::vector<float>().swap(entry.mesh->vertices);
+        std::vector<unsigned int>().swap(entry.mesh->indices);
+    }
+
+    // frees the buffers, everything else about the mesh stays
+    static inline void Evict(MeshMemoryEntry& entry)
+    {
+        Mesh& mesh = *entry.mesh;
+        if (mesh.VAO == mesh_detail::bound_vao) Mesh_BindVertexArray(0);
+        if (mesh.EBO) glDeleteBuffers(1, &mesh.EBO);
+        if (mesh.VAO) glDeleteVertexArrays(1, &mesh.VAO);
+        if (mesh.VBO) glDeleteBuffers(1, &mesh.VBO);
+
+        mesh.VAO = 0;
+        mesh.VBO = 0;
+        mesh.EBO = 0;
+        mesh.vertex_capacity = 0;
+        mesh.index_capacity = 0;
+        mesh.initialized = 1;
+
+        entry.resident = false;
+        entry.gpu_bytes = 0;
+    }
+
+    // returns the bytes uploaded, 0 if the mesh could not come back
+    static inline size_t Restore(MeshMemoryTracker& tracker, MeshMemoryEntry& entry)
+    {
+        Mesh& mesh = *entry.mesh;
+        Vector3 bounds_min = mesh.bounds_min, bounds_max = mesh.bounds_max;
+
+        if (mesh.vertices.empty() && entry.reload) entry.reload(mesh);
+
+        // the reload function may have uploaded already (MeshCache_Load does)
+        if (mesh.VAO == 0)
+        {
+            if (mesh.vertices.empty())
+            {
+                std::cout << "Evicted mesh has no data to upload from" << std::endl;
+                return 0;
+            }
+            mesh.initialized = 0;
+            Mesh_Generate(mesh);
+        }
+
+        // quantized meshes can not recompute their bounds, keep what we had
+        mesh.bounds_min = bounds_min;
+        mesh.bounds_max = bounds_max;
+        mesh.initialized = 0;
+
+        entry.resident = true;
+        entry.requested = false;
+        entry.gpu_bytes = MeshMemory_GPUBytes(mesh);
+        DropCopy(tracker, entry);
+        return entry.gpu_bytes;
+    }
+}
+
+// gpu_budget in bytes, 0 only counts and never evicts
+static inline void MeshMemory_Init(MeshMemoryTracker& tracker, size_t gpu_budget, bool drop_cpu_copies = false)
+{
+    tracker.gpu_budget = gpu_budget;
+    tracker.drop_cpu_copies = drop_cpu_copies;
+    tracker.entries.clear();
+    tracker.lookup.clear();
+    tracker.frame = 1;
+    tracker.cpu_bytes = 0;
+    tracker.gpu_bytes = 0;
+    tracker.evicted = 0;
+}
+
+// call after the mesh is uploaded, reload brings the data back once the CPU copy is gone
+static inline void MeshMemory_Track(MeshMemoryTracker& tracker, Mesh& mesh, std::function<void(Mesh&)> reload = nullptr)
+{
+    if (mesh.pool || mesh.VAO == 0)
+    {
+        std::cout << "Only uploaded meshes that own their buffers can be tracked" << std::endl;
+        return;
+    }
+    if (tracker.lookup.count(&mesh)) return;
+
+    MeshMemoryEntry entry;
+    entry.mesh = &mesh;
+    entry.reload = std::move(reload);
+    entry.last_used = tracker.frame;
+    mesh_memory_detail::DropCopy(tracker, entry);
+    entry.cpu_bytes = MeshMemory_CPUBytes(mesh);
+    entry.gpu_bytes = MeshMemory_GPUBytes(mesh);
+
+    tracker.cpu_bytes += entry.cpu_bytes;
+    tracker.gpu_bytes += entry.gpu_bytes;
+    tracker.lookup[&mesh] = tracker.entries.size();
+    tracker.entries.push_back(std::move(entry));
+}
+
+// stop tracking before Mesh_Delete, an evicted mesh is left with initialized = 1
+static inline void MeshMemory_Untrack(MeshMemoryTracker& tracker, Mesh& mesh)
+{
+    auto found = tracker.lookup.find(&mesh);
+    if (found == tracker.lookup.end()) return;
+
+    size_t index = found->second;
+    MeshMemoryEntry& entry = tracker.entries[index];
+    tracker.cpu_bytes -= entry.cpu_bytes;
+    tracker.gpu_bytes -= entry.gpu_bytes;
+    if (!entry.resident) tracker.evicted--;
+
+    tracker.lookup.erase(found);
+    if (index + 1 != tracker.entries.size())
+    {
+        entry = std::move(tracker.entries.back());
+        tracker.lookup[entry.mesh] = index;
+    }
+    tracker.entries.pop_back();
+}
+
+// call for every tracked mesh about to be drawn, false if it is evicted and skipped this frame
+static inline bool MeshMemory_Use(MeshMemoryTracker& tracker, const Mesh& mesh)
+{
+    auto found = tracker.lookup.find(&mesh);
+    if (found == tracker.lookup.end()) return mesh.initialized == 0;
+
+    MeshMemoryEntry& entry = tracker.entries[found->second];
+    entry.last_used = tracker.frame;
+    if (!entry.resident) entry.requested = true;
+    return entry.resident;
+}
+
+// once per frame after drawing: refreshes the counts, brings back requested meshes and evicts to fit
+// returns how many meshes were evicted
+static inline unsigned int MeshMemory_Update(MeshMemoryTracker& tracker)
+{
+    using namespace mesh_memory_detail;
+
+    // buffers grow under Mesh_FlushUpdates, so counts are refreshed rather than kept incrementally
+    tracker.cpu_bytes = 0;
+    tracker.gpu_bytes = 0;
+    for (MeshMemoryEntry& entry : tracker.entries)
+    {
+        entry.cpu_bytes = MeshMemory_CPUBytes(*entry.mesh);
+        entry.gpu_bytes = entry.resident ? MeshMemory_GPUBytes(*entry.mesh) : 0;
+    }
+
+    // most recently wanted first, always at least one so a big mesh can not stall the queue
+    std::vector<size_t> wanted;
+    for (size_t i = 0; i < tracker.entries.size(); ++i)
+    {
+        if (tracker.entries[i].requested) wanted.push_back(i);
+    }
+    std::sort(wanted.begin(), wanted.end(), [&](size_t a, size_t b)
+    {
+        return tracker.entries[a].last_used > tracker.entries[b].last_used;
+    });
+
+    size_t streamed = 0;
+    for (size_t i : wanted)
+    {
+        if (streamed > 0 && streamed >= tracker.stream_budget) break;
+        MeshMemoryEntry& entry = tracker.entries[i];
+        streamed += Restore(tracker, entry);
+        entry.cpu_bytes = MeshMemory_CPUBytes(*entry.mesh);
+        entry.requested = false;
+    }
+
+    for (const MeshMemoryEntry& entry : tracker.entries)
+    {
+        tracker.cpu_bytes += entry.cpu_bytes;
+        tracker.gpu_bytes += entry.gpu_bytes;
+    }
+
+    // least recently drawn first, nothing drawn this frame goes
+    unsigned int evicted = 0;
+    if (tracker.gpu_budget > 0 && tracker.gpu_bytes > tracker.gpu_budget)
+    {
+        std::vector<size_t> candidates;
+        for (size_t i = 0; i < tracker.entries.size(); ++i)
+        {
+            const MeshMemoryEntry& entry = tracker.entries[i];
+            if (entry.resident && entry.last_used < tracker.frame && CanReload(entry)) candidates.push_back(i);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b)
+        {
+            return tracker.entries[a].last_used < tracker.entries[b].last_used;
+        });
+
+        for (size_t i : candidates)
+        {
+            if (tracker.gpu_bytes <= tracker.gpu_budget) break;
+            tracker.gpu_bytes -= tracker.entries[i].gpu_bytes;
+            Evict(tracker.entries[i]);
+            evicted++;
+        }
+    }
+
+    tracker.evicted = 0;
+    for (const MeshMemoryEntry& entry : tracker.entries)
+    {
+        if (!entry.resident) tracker.evicted++;
+    }
+
+    tracker.frame++;
+    return evicted;
+}
+
+// prints the totals and the biggest meshes
+static inline void MeshMemory_Print(const MeshMemoryTracker& tracker, size_t top = 8)
+{
+    std::cout << "Meshes: " << tracker.entries.size() << " tracked, " << tracker.evicted << " evicted, CPU "
+              << tracker.cpu_bytes / 1024 << " KB, GPU " << tracker.gpu_bytes / 1024 << " KB";
+    if (tracker.gpu_budget) std::cout << " of " << tracker.gpu_budget / 1024 << " KB";
+    std::cout << std::endl;
+
+    std::vector<const MeshMemoryEntry*> sorted;
+    for (const MeshMemoryEntry& entry : tracker.entries) sorted.push_back(&entry);
+    std::sort(sorted.begin(), sorted.end(), [](const MeshMemoryEntry* a, const MeshMemoryEntry* b)
+    {
+        return a->cpu_bytes + a->gpu_bytes > b->cpu_bytes + b->gpu_bytes;
+    });
+
+    for (size_t i = 0; i < sorted.size() && i < top; ++i)
+    {
+        std::cout << "  " << sorted[i]->mesh << " CPU " << sorted[i]->cpu_bytes / 1024 << " KB, GPU "
+                  << sorted[i]->gpu_bytes / 1024 << " KB" << (sorted[i]->resident ? "" : " (evicted)") << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,940 @@
+#ifndef MESH_PROCESS_UTILITY_H
+#define MESH_PROCESS_UTILITY_H
+
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <glad/glad.h>
+#include "mesh_utility.h"
+#include "shader_utility.h"
+#include "simd_utility.h"
+#include "thread_utility.h"
+
+/*
+    Mesh processing
+
+    Passes over the CPU side of a mesh, run them after the shape is set and
+    before Mesh_Generate (or before cooking with MeshCache_Write).
+
+    MeshProcess_Weld merges vertices whose position and attributes agree
+    within a tolerance and remaps the indices. Positions are hashed into
+    cells one tolerance wide and each vertex is compared against the 27
+    surrounding cells, so near duplicates on either side of a cell edge are
+    still found.
+
+    MeshProcess_Stripify turns a triangle list into triangle strips joined
+    by MESH_RESTART_INDEX. Strips are grown greedily across shared edges,
+    trying all three ways into the first triangle and keeping the longest.
+    Grid shaped meshes (spheres, planes, terrain) come out as one strip per
+    row, close to half the indices of the list.
+
+    MeshProcess_GenerateTangents follows MikkTSpace: per face tangent
+    directions from the uv gradients, projected onto each vertex normal,
+    weighted by the corner angle and summed; w holds the uv orientation and
+    vertices shared by mirrored and unmirrored faces are split. Face math
+    runs four triangles at a time, a list of meshes is spread over threads.
+
+    MeshProcess_ComputeNormals writes smooth or flat normals, adding the
+    attribute if the mesh has none. Smooth normals sum the unit face normals
+    around every position (so uv seams stay smooth) weighted by the corner
+    angle; with a crease angle, faces further apart than it do not share a
+    normal and the vertex is split. Face normals are computed four at a
+    time and large meshes spread over threads, so deforming meshes can
+    call it every frame followed by Mesh_UpdateRange; without a crease the
+    vertex count never changes after the first call.
+
+    MeshProcess_QuantizePositions stores positions as 16 bit unorm over the
+    mesh bounds, 8 bytes instead of 12. Draw such meshes with
+    shaders/quantized_vertex.glsl and MeshProcess_SetDecodeUniforms.
+*/
+
+enum MeshNormalMode
+{
+    MESH_NORMALS_SMOOTH,
+    MESH_NORMALS_FLAT
+};
+
+struct WeldOptions
+{
+    // largest per component difference that still counts as the same vertex, 0 welds exact copies only
+    float position_tolerance = 1e-6f;
+    float normal_tolerance = 1e-3f;
+    float uv_tolerance = 1e-6f;
+    float tangent_tolerance = 1e-3f;
+};
+
+struct StripStats
+{
+    size_t list_indices = 0;
+    size_t strip_indices = 0;       // restart indices included
+    size_t strips = 0;
+};
+
+namespace mesh_process_detail
+{
+    static constexpr unsigned int EMPTY = 0xffffffffu;
+
+    static inline uint64_t Mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static inline uint64_t CellHash(int64_t x, int64_t y, int64_t z)
+    {
+        return Mix((uint64_t)x * 0x9e3779b97f4a7c15ull ^ (uint64_t)y * 0xc2b2ae3d27d4eb4full ^ (uint64_t)z * 0x165667b19e3779f9ull);
+    }
+
+    // exact mode hashes the bits, -0 and 0 land together
+    static inline uint32_t FloatBits(float f)
+    {
+        if (f == 0.0f) f = 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+}
+
+// welds duplicate vertices in place and remaps (or creates) the indices
+// returns how many vertices were removed, -1 if the mesh can not be welded
+static inline int MeshProcess_Weld(Mesh& mesh, const WeldOptions& options = WeldOptions())
+{
+    using namespace mesh_process_detail;
+
+    if (mesh.layout & MESH_ATTRIB_QUANTIZED)
+    {
+        std::cout << "Weld before quantizing, quantized meshes can not be welded" << std::endl;
+        return -1;
+    }
+
+    int stride = Mesh_VertexStride(mesh.layout);
+    size_t count = mesh.vertices.size() / stride;
+    if (count == 0) return 0;
+
+    // attribute ranges inside a vertex and the tolerance for each float
+    float tolerance[12];
+    int at = 0;
+    for (int i = 0; i < 3; ++i) tolerance[at++] = options.position_tolerance;
+    if (mesh.layout & MESH_ATTRIB_NORMAL) for (int i = 0; i < 3; ++i) tolerance[at++] = options.normal_tolerance;
+    if (mesh.layout & MESH_ATTRIB_UV) for (int i = 0; i < 2; ++i) tolerance[at++] = options.uv_tolerance;
+    if (mesh.layout & MESH_ATTRIB_TANGENT) for (int i = 0; i < 4; ++i) tolerance[at++] = options.tangent_tolerance;
+
+    bool exact = options.position_tolerance <= 0.0f;
+    float inverse_cell = exact ? 0.0f : 1.0f / options.position_tolerance;
+
+    size_t bucket_count = 1;
+    while (bucket_count < count * 2) bucket_count <<= 1;
+    std::vector<unsigned int> buckets(bucket_count, EMPTY);
+    std::vector<unsigned int> next(count, EMPTY);
+    std::vector<unsigned int> remap(count);
+
+    auto same = [&](const float* a, const float* b)
+    {
+        for (int i = 0; i < stride; ++i)
+        {
+            if (fabsf(a[i] - b[i]) > tolerance[i]) return false;
+        }
+        return true;
+    };
+
+    auto cell_of = [&](const float* v, int64_t cell[3])
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            cell[i] = exact ? (int64_t)FloatBits(v[i]) : (int64_t)floorf(v[i] * inverse_cell);
+        }
+    };
+
+    // survivors are compacted to the front as we go, a survivor never moves past its source
+    float* vertices = mesh.vertices.data();
+    unsigned int unique = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* v = vertices + i * stride;
+        int64_t cell[3];
+        cell_of(v, cell);
+
+        unsigned int found = EMPTY;
+        int reach = exact ? 0 : 1;
+
+        for (int dx = -reach; dx <= reach && found == EMPTY; ++dx)
+        for (int dy = -reach; dy <= reach && found == EMPTY; ++dy)
+        for (int dz = -reach; dz <= reach && found == EMPTY; ++dz)
+        {
+            size_t bucket = CellHash(cell[0] + dx, cell[1] + dy, cell[2] + dz) & (bucket_count - 1);
+            for (unsigned int k = buckets[bucket]; k != EMPTY; k = next[k])
+            {
+                if (same(vertices + (size_t)k * stride, v))
+                {
+                    found = k;
+                    break;
+                }
+            }
+        }
+
+        if (found == EMPTY)
+        {
+            if (unique != i) memmove(vertices + (size_t)unique * stride, v, stride * sizeof(float));
+
+            size_t bucket = CellHash(cell[0], cell[1], cell[2]) & (bucket_count - 1);
+            next[unique] = buckets[bucket];
+            buckets[bucket] = unique;
+            found = unique++;
+        }
+
+        remap[i] = found;
+    }
+
+    mesh.vertices.resize((size_t)unique * stride);
+
+    if (mesh.use_indices)
+    {
+        for (unsigned int& index : mesh.indices)
+        {
+            if (index != MESH_RESTART_INDEX) index = remap[index];
+        }
+    }
+    else
+    {
+        mesh.indices.swap(remap);
+        mesh.use_indices = true;
+    }
+
+    return (int)(count - unique);
+}
+
+// converts an indexed triangle list to restart separated strips, stats reports the savings
+// returns 0 if converted, 1 if strips would not be smaller and the list was kept, -1 on bad input
+static inline int MeshProcess_Stripify(Mesh& mesh, StripStats* stats = nullptr)
+{
+    if (!mesh.use_indices || mesh.primitive != GL_TRIANGLES)
+    {
+        std::cout << "Stripify needs an indexed triangle list" << std::endl;
+        return -1;
+    }
+
+    const std::vector<unsigned int>& tris = mesh.indices;
+    size_t tri_count = tris.size() / 3;
+
+    unsigned int vertex_count = 0;
+    for (size_t i = 0; i < tri_count * 3; ++i)
+    {
+        if (tris[i] + 1 > vertex_count) vertex_count = tris[i] + 1;
+    }
+
+    // triangles around each vertex
+    std::vector<unsigned int> first(vertex_count + 1, 0);
+    for (size_t i = 0; i < tri_count * 3; ++i) first[tris[i] + 1]++;
+    for (unsigned int v = 0; v < vertex_count; ++v) first[v + 1] += first[v];
+
+    std::vector<unsigned int> around(tri_count * 3);
+    std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+    for (size_t t = 0; t < tri_count; ++t)
+    {
+        for (int k = 0; k < 3; ++k) around[fill[tris[t * 3 + k]]++] = (unsigned int)t;
+    }
+
+    // 0 free, USED taken, anything else claimed by the trial with that tag
+    const unsigned int USED = 0xffffffffu;
+    std::vector<unsigned int> owner(tri_count, 0);
+    unsigned int tag = 0;
+
+    auto same_winding = [](const unsigned int* t, unsigned int a, unsigned int b, unsigned int c)
+    {
+        return (t[0] == a && t[1] == b && t[2] == c) ||
+               (t[1] == a && t[2] == b && t[0] == c) ||
+               (t[2] == a && t[0] == b && t[1] == c);
+    };
+
+    auto grow = [&](size_t start, int rotation, std::vector<unsigned int>& strip, std::vector<unsigned int>& claimed)
+    {
+        ++tag;
+        strip.clear();
+        claimed.clear();
+
+        const unsigned int* t = &tris[start * 3];
+        strip.push_back(t[rotation]);
+        strip.push_back(t[(rotation + 1) % 3]);
+        strip.push_back(t[(rotation + 2) % 3]);
+        owner[start] = tag;
+        claimed.push_back((unsigned int)start);
+
+        while (true)
+        {
+            size_t n = strip.size();
+            unsigned int p = strip[n - 2], q = strip[n - 1];
+
+            // odd triangles of a strip are drawn with their first two corners swapped
+            bool odd = ((n - 2) & 1) != 0;
+            bool extended = false;
+
+            for (unsigned int k = first[p]; k < first[p + 1] && !extended; ++k)
+            {
+                unsigned int u = around[k];
+                if (owner[u] == USED || owner[u] == tag) continue;
+
+                const unsigned int* v = &tris[(size_t)u * 3];
+                unsigned int r;
+                if (v[0] != p && v[0] != q) r = v[0];
+                else if (v[1] != p && v[1] != q) r = v[1];
+                else r = v[2];
+
+                bool has_q = v[0] == q || v[1] == q || v[2] == q;
+                if (!has_q || r == p || r == q || p == q) continue;
+
+                if (odd ? same_winding(v, q, p, r) : same_winding(v, p, q, r))
+                {
+                    owner[u] = tag;
+                    claimed.push_back(u);
+                    strip.push_back(r);
+                    extended = true;
+                }
+            }
+
+            if (!extended) break;
+        }
+    };
+
+    std::vector<unsigned int> out;
+    out.reserve(tris.size());
+
+    std::vector<unsigned int> strip, claimed, best, best_claimed;
+    size_t strips = 0;
+
+    for (size_t t = 0; t < tri_count; ++t)
+    {
+        if (owner[t] == USED) continue;
+
+        best.clear();
+        for (int rotation = 0; rotation < 3; ++rotation)
+        {
+            grow(t, rotation, strip, claimed);
+            if (strip.size() > best.size())
+            {
+                best.swap(strip);
+                best_claimed.swap(claimed);
+            }
+        }
+
+        for (unsigned int u : best_claimed) owner[u] = USED;
+
+        if (strips > 0) out.push_back(MESH_RESTART_INDEX);
+        out.insert(out.end(), best.begin(), best.end());
+        strips++;
+    }
+
+    if (stats)
+    {
+        stats->list_indices = tris.size();
+        stats->strip_indices = out.size();
+        stats->strips = strips;
+    }
+
+    if (out.size() >= tris.size()) return 1;
+
+    mesh.indices.swap(out);
+    mesh.primitive = GL_TRIANGLE_STRIP;
+    return 0;
+}
+
+namespace mesh_process_detail
+{
+    // per triangle inputs and results, one array per component so four triangles load at once
+    enum FaceArray
+    {
+        P0X, P0Y, P0Z, P1X, P1Y, P1Z, P2X, P2Y, P2Z,
+        U0, V0, U1, V1, U2, V2,
+        OSX, OSY, OSZ, AREA, COS0, COS1, COS2,
+        FACE_ARRAYS
+    };
+
+    // face tangent directions (MikkTSpace eq. 18) and corner angle cosines
+    static inline void TangentFaces(float* const* a, size_t count)
+    {
+        Float4 one = Simd_Set(1.0f);
+
+        for (size_t i = 0; i < count; i += 4)
+        {
+            Float4 p0x = Simd_Load(a[P0X] + i), p0y = Simd_Load(a[P0Y] + i), p0z = Simd_Load(a[P0Z] + i);
+            Float4 d1x = Simd_Sub(Simd_Load(a[P1X] + i), p0x), d1y = Simd_Sub(Simd_Load(a[P1Y] + i), p0y), d1z = Simd_Sub(Simd_Load(a[P1Z] + i), p0z);
+            Float4 d2x = Simd_Sub(Simd_Load(a[P2X] + i), p0x), d2y = Simd_Sub(Simd_Load(a[P2Y] + i), p0y), d2z = Simd_Sub(Simd_Load(a[P2Z] + i), p0z);
+
+            Float4 u0 = Simd_Load(a[U0] + i), v0 = Simd_Load(a[V0] + i);
+            Float4 t21x = Simd_Sub(Simd_Load(a[U1] + i), u0), t21y = Simd_Sub(Simd_Load(a[V1] + i), v0);
+            Float4 t31x = Simd_Sub(Simd_Load(a[U2] + i), u0), t31y = Simd_Sub(Simd_Load(a[V2] + i), v0);
+
+            Float4 area = Simd_Sub(Simd_Mul(t21x, t31y), Simd_Mul(t21y, t31x));
+
+            Float4 osx = Simd_Sub(Simd_Mul(t31y, d1x), Simd_Mul(t21y, d2x));
+            Float4 osy = Simd_Sub(Simd_Mul(t31y, d1y), Simd_Mul(t21y, d2y));
+            Float4 osz = Simd_Sub(Simd_Mul(t31y, d1z), Simd_Mul(t21y, d2z));
+            Simd_Normalize3(osx, osy, osz);
+
+            // uv mirrored faces flip the direction, MikkTSpace's orientation sign
+            Float4 sign = Simd_Select(Simd_Greater(area, Simd_Set(0.0f)), one, Simd_Set(-1.0f));
+            Simd_Store(a[OSX] + i, Simd_Mul(osx, sign));
+            Simd_Store(a[OSY] + i, Simd_Mul(osy, sign));
+            Simd_Store(a[OSZ] + i, Simd_Mul(osz, sign));
+            Simd_Store(a[AREA] + i, area);
+
+            // corner angles from the unit edges
+            Float4 d3x = Simd_Sub(d2x, d1x), d3y = Simd_Sub(d2y, d1y), d3z = Simd_Sub(d2z, d1z);
+            Simd_Normalize3(d1x, d1y, d1z);
+            Simd_Normalize3(d2x, d2y, d2z);
+            Simd_Normalize3(d3x, d3y, d3z);
+
+            Simd_Store(a[COS0] + i, Simd_Dot3(d1x, d1y, d1z, d2x, d2y, d2z));
+            Simd_Store(a[COS1] + i, Simd_Sub(Simd_Set(0.0f), Simd_Dot3(d1x, d1y, d1z, d3x, d3y, d3z)));
+            Simd_Store(a[COS2] + i, Simd_Dot3(d2x, d2y, d2z, d3x, d3y, d3z));
+        }
+    }
+
+    static inline float CornerAngle(float c)
+    {
+        return acosf(c < -1.0f ? -1.0f : c > 1.0f ? 1.0f : c);
+    }
+}
+
+// writes MikkTSpace style tangents into the vertices, adding MESH_ATTRIB_TANGENT to the layout
+// needs normals and uvs, returns how many vertices were split for mirrored uvs or -1
+static inline int MeshProcess_GenerateTangents(Mesh& mesh)
+{
+    using namespace mesh_process_detail;
+
+    unsigned int needed = MESH_ATTRIB_NORMAL | MESH_ATTRIB_UV;
+    if ((mesh.layout & needed) != needed || (mesh.layout & MESH_ATTRIB_QUANTIZED) || mesh.primitive != GL_TRIANGLES)
+    {
+        std::cout << "Tangents need a float triangle list with normals and uvs" << std::endl;
+        return -1;
+    }
+
+    int stride = Mesh_VertexStride(mesh.layout);
+    int base_stride = (mesh.layout & MESH_ATTRIB_TANGENT) ? stride - 4 : stride;
+    unsigned int vertex_count = Mesh_VertexCount(mesh);
+    const float* vertices = mesh.vertices.data();
+
+    size_t corner_count = mesh.use_indices ? mesh.indices.size() : vertex_count;
+    size_t tri_count = corner_count / 3;
+    auto corner = [&](size_t k) { return mesh.use_indices ? mesh.indices[k] : (unsigned int)k; };
+
+    // gather, padded to a multiple of four so the last block reads initialized zeros
+    size_t padded = (tri_count + 3) & ~(size_t)3;
+    std::vector<float> face_data(padded * FACE_ARRAYS, 0.0f);
+    float* a[FACE_ARRAYS];
+    for (int i = 0; i < FACE_ARRAYS; ++i) a[i] = face_data.data() + i * padded;
+
+    for (size_t t = 0; t < tri_count; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const float* v = vertices + (size_t)corner(t * 3 + k) * stride;
+            a[P0X + k * 3][t] = v[0];
+            a[P0Y + k * 3][t] = v[1];
+            a[P0Z + k * 3][t] = v[2];
+            a[U0 + k * 2][t] = v[6];
+            a[V0 + k * 2][t] = v[7];
+        }
+    }
+
+    TangentFaces(a, padded);
+
+    // a vertex used by faces of both orientations gets a copy for the mirrored ones
+    std::vector<unsigned char> orientations(vertex_count, 0);
+    for (size_t t = 0; t < tri_count; ++t)
+    {
+        if (a[AREA][t] == 0.0f) continue;
+        unsigned char bit = a[AREA][t] > 0.0f ? 1 : 2;
+        for (int k = 0; k < 3; ++k) orientations[corner(t * 3 + k)] |= bit;
+    }
+
+    std::vector<unsigned int> source(vertex_count);
+    for (unsigned int i = 0; i < vertex_count; ++i) source[i] = i;
+
+    std::vector<unsigned int> split(vertex_count, 0);
+    for (unsigned int i = 0; i < vertex_count; ++i)
+    {
+        if (orientations[i] != 3) continue;
+        split[i] = (unsigned int)source.size();
+        source.push_back(i);
+    }
+
+    size_t out_count = source.size();
+    std::vector<float> tangents(out_count * 4, 0.0f);
+    for (size_t i = 0; i < out_count; ++i) tangents[i * 4 + 3] = 1.0f;
+
+    std::vector<unsigned int> corners(mesh.use_indices ? corner_count : 0);
+
+    for (size_t t = 0; t < tri_count; ++t)
+    {
+        float area = a[AREA][t];
+        bool mirrored = area < 0.0f;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int index = corner(t * 3 + k);
+            if (mirrored && split[index]) index = split[index];
+            if (mesh.use_indices) corners[t * 3 + k] = index;
+
+            if (area == 0.0f) continue;
+
+            // project onto the tangent plane of the vertex normal before weighting
+            const float* n = vertices + (size_t)source[index] * stride + 3;
+            float ox = a[OSX][t], oy = a[OSY][t], oz = a[OSZ][t];
+            float d = n[0] * ox + n[1] * oy + n[2] * oz;
+            float px = ox - n[0] * d, py = oy - n[1] * d, pz = oz - n[2] * d;
+            float length = sqrtf(px * px + py * py + pz * pz);
+            if (length <= 1e-20f) continue;
+
+            float weight = CornerAngle(a[COS0 + k][t]) / length;
+            float* out = &tangents[(size_t)index * 4];
+            out[0] += px * weight;
+            out[1] += py * weight;
+            out[2] += pz * weight;
+            out[3] = mirrored ? -1.0f : 1.0f;
+        }
+    }
+
+    int out_stride = base_stride + 4;
+    std::vector<float> result(out_count * out_stride);
+
+    Thread_ParallelFor(out_count, 16384, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float* v = vertices + (size_t)source[i] * stride;
+            float* out = result.data() + i * out_stride;
+            memcpy(out, v, base_stride * sizeof(float));
+
+            const float* n = v + 3;
+            float* t = &tangents[i * 4];
+
+            // no usable uv gradient around this vertex, any direction in the tangent plane will do
+            if (t[0] == 0.0f && t[1] == 0.0f && t[2] == 0.0f)
+            {
+                if (fabsf(n[0]) < 0.9f) { t[0] = 1.0f; }
+                else { t[1] = 1.0f; }
+            }
+
+            float d = n[0] * t[0] + n[1] * t[1] + n[2] * t[2];
+            float x = t[0] - n[0] * d, y = t[1] - n[1] * d, z = t[2] - n[2] * d;
+            float length = sqrtf(x * x + y * y + z * z);
+            float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+
+            out[base_stride + 0] = x * inverse;
+            out[base_stride + 1] = y * inverse;
+            out[base_stride + 2] = z * inverse;
+            out[base_stride + 3] = t[3];
+        }
+    });
+
+    mesh.vertices.swap(result);
+    if (mesh.use_indices) mesh.indices.swap(corners);
+    mesh.layout |= MESH_ATTRIB_TANGENT;
+
+    return (int)(out_count - vertex_count);
+}
+
+// tangents for many meshes at once, the list is split into one contiguous range per hardware thread
+// (Thread_ParallelFor starts those threads for this call, there is no persistent pool)
+static inline void MeshProcess_GenerateTangents(const std::vector<Mesh*>& meshes)
+{
+    Thread_ParallelFor(meshes.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) MeshProcess_GenerateTangents(*meshes[i]);
+    });
+}
+
+namespace mesh_process_detail
+{
+    // triangles or vertices per thread, smaller meshes stay on the calling thread
+    static constexpr size_t NORMAL_GRAIN = 8192;
+
+    enum NormalArray { FNX, FNY, FNZ, ANGLE0, ANGLE1, ANGLE2, NORMAL_ARRAYS };
+
+    // unit face normals and corner angles for blocks of four triangles, out arrays padded to a multiple of four
+    template<typename Corner>
+    static inline void NormalFaces(const float* vertices, int stride, size_t tri_count, Corner&& corner,
+                                   size_t block_begin, size_t block_end, float* const* out)
+    {
+        for (size_t block = block_begin; block < block_end; ++block)
+        {
+            // gather the corners of four triangles into x, y, z lanes, missing triangles stay zero
+            alignas(16) float p[9][4] = {};
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                size_t t = block * 4 + lane;
+                if (t >= tri_count) break;
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float* v = vertices + (size_t)corner(t * 3 + k) * stride;
+                    p[k * 3 + 0][lane] = v[0];
+                    p[k * 3 + 1][lane] = v[1];
+                    p[k * 3 + 2][lane] = v[2];
+                }
+            }
+
+            Float4 p0x = Simd_Load(p[0]), p0y = Simd_Load(p[1]), p0z = Simd_Load(p[2]);
+            Float4 d1x = Simd_Sub(Simd_Load(p[3]), p0x), d1y = Simd_Sub(Simd_Load(p[4]), p0y), d1z = Simd_Sub(Simd_Load(p[5]), p0z);
+            Float4 d2x = Simd_Sub(Simd_Load(p[6]), p0x), d2y = Simd_Sub(Simd_Load(p[7]), p0y), d2z = Simd_Sub(Simd_Load(p[8]), p0z);
+            Float4 d3x = Simd_Sub(d2x, d1x), d3y = Simd_Sub(d2y, d1y), d3z = Simd_Sub(d2z, d1z);
+
+            Float4 nx, ny, nz;
+            Simd_Cross3(d1x, d1y, d1z, d2x, d2y, d2z, nx, ny, nz);
+            Simd_Normalize3(nx, ny, nz);
+
+            Simd_Normalize3(d1x, d1y, d1z);
+            Simd_Normalize3(d2x, d2y, d2z);
+            Simd_Normalize3(d3x, d3y, d3z);
+
+            size_t i = block * 4;
+            Simd_Store(out[FNX] + i, nx);
+            Simd_Store(out[FNY] + i, ny);
+            Simd_Store(out[FNZ] + i, nz);
+            Simd_Store(out[ANGLE0] + i, Simd_Acos(Simd_Dot3(d1x, d1y, d1z, d2x, d2y, d2z)));
+            Simd_Store(out[ANGLE1] + i, Simd_Acos(Simd_Sub(Simd_Set(0.0f), Simd_Dot3(d1x, d1y, d1z, d3x, d3y, d3z))));
+            Simd_Store(out[ANGLE2] + i, Simd_Acos(Simd_Dot3(d2x, d2y, d2z, d3x, d3y, d3z)));
+        }
+    }
+
+    // gives vertices at exactly the same position the same group id, returns the group count
+    static inline unsigned int PositionGroups(const float* vertices, int stride, size_t count, std::vector<unsigned int>& group)
+    {
+        size_t bucket_count = 1;
+        while (bucket_count < count * 2) bucket_count <<= 1;
+        std::vector<unsigned int> buckets(bucket_count, EMPTY);
+        std::vector<unsigned int> next(count, EMPTY);
+
+        group.resize(count);
+        unsigned int groups = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float* v = vertices + i * stride;
+            size_t bucket = CellHash(FloatBits(v[0]), FloatBits(v[1]), FloatBits(v[2])) & (bucket_count - 1);
+
+            unsigned int found = EMPTY;
+            for (unsigned int k = buckets[bucket]; k != EMPTY; k = next[k])
+            {
+                const float* o = vertices + (size_t)k * stride;
+                if (o[0] == v[0] && o[1] == v[1] && o[2] == v[2])
+                {
+                    found = group[k];
+                    break;
+                }
+            }
+
+            if (found == EMPTY)
+            {
+                found = groups++;
+                next[i] = buckets[bucket];
+                buckets[bucket] = (unsigned int)i;
+            }
+            group[i] = found;
+        }
+
+        return groups;
+    }
+
+    // makes room for a normal after the position of every vertex
+    static inline void AddNormalSlot(Mesh& mesh)
+    {
+        int stride = Mesh_VertexStride(mesh.layout);
+        int out_stride = stride + 3;
+        size_t count = mesh.vertices.size() / stride;
+
+        std::vector<float> result(count * out_stride, 0.0f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float* v = mesh.vertices.data() + i * stride;
+            float* out = result.data() + i * out_stride;
+            memcpy(out, v, 3 * sizeof(float));
+            memcpy(out + 6, v + 3, (stride - 3) * sizeof(float));
+        }
+
+        mesh.vertices.swap(result);
+        mesh.layout |= MESH_ATTRIB_NORMAL;
+    }
+
+    static inline void StoreNormal(float* out, float x, float y, float z)
+    {
+        float length = sqrtf(x * x + y * y + z * z);
+        if (length > 1e-20f)
+        {
+            out[0] = x / length;
+            out[1] = y / length;
+            out[2] = z / length;
+        }
+        else
+        {
+            // only degenerate faces touch this vertex
+            out[0] = 0.0f;
+            out[1] = 1.0f;
+            out[2] = 0.0f;
+        }
+    }
+}
+
+// writes normals into the vertices, adding MESH_ATTRIB_NORMAL to the layout if needed
+// crease_angle (radians) splits smooth normals across sharper edges, pi never splits
+// returns how many vertices were added (flat normals on an indexed mesh unshare every corner) or -1
+static inline int MeshProcess_ComputeNormals(Mesh& mesh, MeshNormalMode mode, float crease_angle = 3.14159265f)
+{
+    using namespace mesh_process_detail;
+
+    if ((mesh.layout & MESH_ATTRIB_QUANTIZED) || mesh.primitive != GL_TRIANGLES)
+    {
+        std::cout << "Normals need a triangle list with float positions" << std::endl;
+        return -1;
+    }
+
+    if (!(mesh.layout & MESH_ATTRIB_NORMAL)) AddNormalSlot(mesh);
+
+    int stride = Mesh_VertexStride(mesh.layout);
+    unsigned int vertex_count = Mesh_VertexCount(mesh);
+    size_t corner_count = mesh.use_indices ? mesh.indices.size() : vertex_count;
+    size_t tri_count = corner_count / 3;
+    corner_count = tri_count * 3;
+    if (tri_count == 0) return 0;
+
+    const unsigned int* indices = mesh.use_indices ? mesh.indices.data() : nullptr;
+    auto corner = [indices](size_t k) { return indices ? indices[k] : (unsigned int)k; };
+
+    size_t blocks = (tri_count + 3) / 4;
+    std::vector<float> face_data(blocks * 4 * NORMAL_ARRAYS);
+    float* faces[NORMAL_ARRAYS];
+    for (int i = 0; i < NORMAL_ARRAYS; ++i) faces[i] = face_data.data() + i * blocks * 4;
+
+    Thread_ParallelFor(blocks, NORMAL_GRAIN / 4, [&](size_t begin, size_t end)
+    {
+        NormalFaces(mesh.vertices.data(), stride, tri_count, corner, begin, end, faces);
+    });
+
+    if (mode == MESH_NORMALS_FLAT)
+    {
+        // every corner needs its own vertex, an indexed mesh is unrolled into a list
+        if (mesh.use_indices)
+        {
+            std::vector<float> result(corner_count * stride);
+            Thread_ParallelFor(corner_count, NORMAL_GRAIN, [&](size_t begin, size_t end)
+            {
+                for (size_t c = begin; c < end; ++c)
+                {
+                    memcpy(result.data() + c * stride, mesh.vertices.data() + (size_t)indices[c] * stride, stride * sizeof(float));
+                }
+            });
+
+            mesh.vertices.swap(result);
+            mesh.indices.clear();
+            mesh.use_indices = false;
+        }
+
+        float* vertices = mesh.vertices.data();
+        Thread_ParallelFor(tri_count, NORMAL_GRAIN, [&](size_t begin, size_t end)
+        {
+            for (size_t t = begin; t < end; ++t)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    float* n = vertices + (t * 3 + k) * stride + 3;
+                    n[0] = faces[FNX][t];
+                    n[1] = faces[FNY][t];
+                    n[2] = faces[FNZ][t];
+                }
+            }
+        });
+
+        return (int)(Mesh_VertexCount(mesh) - vertex_count);
+    }
+
+    // corners around each position, counting sort into one array
+    std::vector<unsigned int> group;
+    unsigned int group_count = PositionGroups(mesh.vertices.data(), stride, vertex_count, group);
+
+    std::vector<unsigned int> group_start(group_count + 1, 0);
+    for (size_t c = 0; c < corner_count; ++c) group_start[group[corner(c)] + 1]++;
+    for (unsigned int g = 0; g < group_count; ++g) group_start[g + 1] += group_start[g];
+
+    std::vector<unsigned int> group_corners(corner_count);
+    std::vector<unsigned int> fill(group_start.begin(), group_start.end() - 1);
+    for (size_t c = 0; c < corner_count; ++c) group_corners[fill[group[corner(c)]]++] = (unsigned int)c;
+
+    auto weighted = [&](unsigned int c, float& x, float& y, float& z)
+    {
+        size_t t = c / 3;
+        float angle = faces[ANGLE0 + c % 3][t];
+        x += faces[FNX][t] * angle;
+        y += faces[FNY][t] * angle;
+        z += faces[FNZ][t] * angle;
+    };
+
+    if (crease_angle >= 3.14159265f)
+    {
+        std::vector<float> group_normals((size_t)group_count * 3);
+        Thread_ParallelFor(group_count, NORMAL_GRAIN, [&](size_t begin, size_t end)
+        {
+            for (size_t g = begin; g < end; ++g)
+            {
+                float x = 0.0f, y = 0.0f, z = 0.0f;
+                for (unsigned int i = group_start[g]; i < group_start[g + 1]; ++i) weighted(group_corners[i], x, y, z);
+                StoreNormal(&group_normals[g * 3], x, y, z);
+            }
+        });
+
+        float* vertices = mesh.vertices.data();
+        Thread_ParallelFor(vertex_count, NORMAL_GRAIN, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; ++v) memcpy(vertices + v * stride + 3, &group_normals[(size_t)group[v] * 3], 3 * sizeof(float));
+        });
+
+        return 0;
+    }
+
+    // each corner only averages the faces around it within the crease angle
+    float crease_cos = cosf(crease_angle);
+    std::vector<float> corner_normals(corner_count * 3);
+    Thread_ParallelFor(corner_count, NORMAL_GRAIN, [&](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            size_t t = c / 3;
+            unsigned int g = group[corner(c)];
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+
+            for (unsigned int i = group_start[g]; i < group_start[g + 1]; ++i)
+            {
+                size_t o = group_corners[i] / 3;
+                float d = faces[FNX][t] * faces[FNX][o] + faces[FNY][t] * faces[FNY][o] + faces[FNZ][t] * faces[FNZ][o];
+                if (o == t || d >= crease_cos) weighted(group_corners[i], x, y, z);
+            }
+            StoreNormal(&corner_normals[c * 3], x, y, z);
+        }
+    });
+
+    if (!mesh.use_indices)
+    {
+        for (size_t c = 0; c < corner_count; ++c) memcpy(mesh.vertices.data() + c * stride + 3, &corner_normals[c * 3], 3 * sizeof(float));
+        return 0;
+    }
+
+    // corners of a vertex that ended up with different normals get their own copies
+    std::vector<unsigned int> source(vertex_count);
+    std::vector<unsigned int> next_copy(vertex_count, EMPTY);
+    std::vector<float> normals((size_t)vertex_count * 3);
+    std::vector<unsigned char> used(vertex_count, 0);
+    for (unsigned int v = 0; v < vertex_count; ++v)
+    {
+        source[v] = v;
+        memcpy(&normals[(size_t)v * 3], mesh.vertices.data() + (size_t)v * stride + 3, 3 * sizeof(float));
+    }
+
+    for (size_t c = 0; c < corner_count; ++c)
+    {
+        unsigned int v = mesh.indices[c];
+        const float* n = &corner_normals[c * 3];
+
+        if (!used[v])
+        {
+            used[v] = 1;
+            memcpy(&normals[(size_t)v * 3], n, 3 * sizeof(float));
+            continue;
+        }
+
+        unsigned int match = EMPTY, last = v;
+        for (unsigned int k = v; k != EMPTY; last = k, k = next_copy[k])
+        {
+            const float* o = &normals[(size_t)k * 3];
+            if (o[0] * n[0] + o[1] * n[1] + o[2] * n[2] > 0.9999f)
+            {
+                match = k;
+                break;
+            }
+        }
+
+        if (match == EMPTY)
+        {
+            match = (unsigned int)source.size();
+            source.push_back(v);
+            next_copy.push_back(EMPTY);
+            normals.insert(normals.end(), n, n + 3);
+            next_copy[last] = match;
+        }
+        mesh.indices[c] = match;
+    }
+
+    size_t out_count = source.size();
+    if (out_count > vertex_count) mesh.vertices.resize(out_count * stride);
+
+    float* vertices = mesh.vertices.data();
+    for (size_t v = vertex_count; v < out_count; ++v) memcpy(vertices + v * stride, vertices + (size_t)source[v] * stride, stride * sizeof(float));
+    for (size_t v = 0; v < out_count; ++v) memcpy(vertices + v * stride + 3, &normals[v * 3], 3 * sizeof(float));
+
+    return (int)(out_count - vertex_count);
+}
+
+// replaces float positions with 16 bit unorm positions over the mesh bounds
+// returns -1 if the mesh is already quantized
+static inline int MeshProcess_QuantizePositions(Mesh& mesh)
+{
+    if (mesh.layout & MESH_ATTRIB_QUANTIZED)
+    {
+        std::cout << "Mesh is already quantized" << std::endl;
+        return -1;
+    }
+
+    int stride = Mesh_VertexStride(mesh.layout);
+    size_t count = mesh.vertices.size() / stride;
+
+    Vector3 bounds_min, bounds_max;
+    Mesh_ComputeBounds(mesh, bounds_min, bounds_max);
+
+    float lo[3] = {bounds_min.x, bounds_min.y, bounds_min.z};
+    float extent[3] = {bounds_max.x - lo[0], bounds_max.y - lo[1], bounds_max.z - lo[2]};
+    float scale[3];
+    for (int i = 0; i < 3; ++i) scale[i] = extent[i] > 0.0f ? 65535.0f / extent[i] : 0.0f;
+
+    // the packed vertex is one float shorter, so it can be rewritten front to back in place
+    float* vertices = mesh.vertices.data();
+    int packed_stride = stride - 1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float source[12];
+        memcpy(source, vertices + i * stride, stride * sizeof(float));
+
+        uint16_t q[4] = {0, 0, 0, 0};
+        for (int k = 0; k < 3; ++k)
+        {
+            float value = (source[k] - lo[k]) * scale[k] + 0.5f;
+            q[k] = (uint16_t)(value < 0.0f ? 0.0f : value > 65535.0f ? 65535.0f : value);
+        }
+
+        float* out = vertices + i * packed_stride;
+        memcpy(out, q, sizeof(q));
+        memcpy(out + 2, source + 3, (stride - 3) * sizeof(float));
+    }
+
+    mesh.vertices.resize(count * packed_stride);
+    mesh.layout |= MESH_ATTRIB_QUANTIZED;
+    mesh.bounds_min = bounds_min;
+    mesh.bounds_max = bounds_max;
+
+    return 0;
+}
+
+// uQuantMin and uQuantExtent for shaders/quantized_vertex.glsl, call per mesh before drawing it
+static inline void MeshProcess_SetDecodeUniforms(Shader& shader, const Mesh& mesh)
+{
+    Shader_SetUniform3f(shader, "uQuantMin", mesh.bounds_min);
+    Shader_SetUniform3f(shader, "uQuantExtent", {mesh.bounds_max.x - mesh.bounds_min.x,
+                                                mesh.bounds_max.y - mesh.bounds_min.y,
+                                                mesh.bounds_max.z - mesh.bounds_min.z});
+}
+
+#endif
@@ -4,20 +4,255 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
 #include "shader_utility.h"
+#include "thread_utility.h"
+
+// vertex attributes are interleaved in the order listed, position is always present
+enum MeshAttribute
+{
+    MESH_ATTRIB_POSITION = 1 << 0,  // vec3, location 0
+    MESH_ATTRIB_NORMAL   = 1 << 1,  // vec3, location 1
+    MESH_ATTRIB_UV       = 1 << 2,  // vec2, location 2
+    MESH_ATTRIB_TANGENT  = 1 << 4,  // vec4, location 3, w is the bitangent sign
+
+    // position stored as 16 bit unorm over bounds_min/bounds_max, 8 bytes (xyz + pad)
+    // the vertex shader decodes it, see mesh_process_utility.h
+    MESH_ATTRIB_QUANTIZED = 1 << 3
+};
+
+struct GeometryPool;
+
+// ends a strip inside one index list, see MeshProcess_Stripify
+static constexpr unsigned int MESH_RESTART_INDEX = 0xffffffffu;
+
+// [first, first + count) in vertices or indices
+struct MeshRange
+{
+    unsigned int first;
+    unsigned int count;
+};
 
 struct Mesh
 {
-    unsigned int VAO;
-    unsigned int VBO;
-    unsigned int EBO;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
 
+    // -1 no shape, 0 ready, 1 upload still in flight (see async_mesh_utility.h)
     int initialized = -1;
     bool use_indices = false;
+    unsigned int layout = MESH_ATTRIB_POSITION;
+
+    // GL_TRIANGLES, or GL_TRIANGLE_STRIP with MESH_RESTART_INDEX between strips
+    GLenum primitive = GL_TRIANGLES;
+
+    // what is on the GPU, the CPU side vectors may be empty for cached meshes
+    unsigned int vertex_count = 0;
+    unsigned int index_count = 0;
+
+    // object space axis aligned bounds
+    Vector3 bounds_min = {0.0f, 0.0f, 0.0f};
+    Vector3 bounds_max = {0.0f, 0.0f, 0.0f};
+
+    // set when the geometry lives in a shared GeometryPool, VAO/VBO/EBO are then the pool's
+    GeometryPool* pool = nullptr;
+    unsigned int base_vertex = 0;
+    unsigned int first_index = 0;
+
+    // room in the GPU buffers, grows geometrically when updates outgrow it
+    unsigned int vertex_capacity = 0;
+    unsigned int index_capacity = 0;
+
+    // edits waiting for Mesh_FlushUpdates, coalesced as they are added
+    std::vector<MeshRange> dirty_vertices;
+    std::vector<MeshRange> dirty_indices;
 };
 
+namespace mesh_detail
+{
+    inline unsigned int bound_vao = 0;
+    inline bool restart_enabled = false;
+}
+
+// binds a VAO unless it is already bound, everything in the engine binds VAOs through this
+static inline void Mesh_BindVertexArray(unsigned int vao)
+{
+    if (mesh_detail::bound_vao == vao) return;
+    glBindVertexArray(vao);
+    mesh_detail::bound_vao = vao;
+}
+
+// primitive restart is only on around strip draws, any other indexed draw sees MESH_RESTART_INDEX as a vertex
+static inline void Mesh_SetPrimitiveRestart(bool enabled)
+{
+    if (mesh_detail::restart_enabled == enabled) return;
+    if (enabled)
+    {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(MESH_RESTART_INDEX);
+    }
+    else glDisable(GL_PRIMITIVE_RESTART);
+    mesh_detail::restart_enabled = enabled;
+}
+
+// number of floats per vertex for a layout
+static inline int Mesh_VertexStride(unsigned int layout)
+{
+    int stride = (layout & MESH_ATTRIB_QUANTIZED) ? 2 : 3;
+    if (layout & MESH_ATTRIB_NORMAL) stride += 3;
+    if (layout & MESH_ATTRIB_UV) stride += 2;
+    if (layout & MESH_ATTRIB_TANGENT) stride += 4;
+    return stride;
+}
+
+static inline unsigned int Mesh_VertexCount(const Mesh& mesh)
+{
+    return (unsigned int)(mesh.vertices.size() / Mesh_VertexStride(mesh.layout));
+}
+
+// bounds of the CPU side vertices
+static inline void Mesh_ComputeBounds(const Mesh& mesh, Vector3& bounds_min, Vector3& bounds_max)
+{
+    // quantized positions are relative to the bounds they were made from
+    if (mesh.layout & MESH_ATTRIB_QUANTIZED)
+    {
+        bounds_min = mesh.bounds_min;
+        bounds_max = mesh.bounds_max;
+        return;
+    }
+
+    int stride = Mesh_VertexStride(mesh.layout);
+    size_t count = mesh.vertices.size() / stride;
+
+    if (count == 0)
+    {
+        bounds_min = {0.0f, 0.0f, 0.0f};
+        bounds_max = {0.0f, 0.0f, 0.0f};
+        return;
+    }
+
+    const float* v = mesh.vertices.data();
+    Vector3 lo = {v[0], v[1], v[2]};
+    Vector3 hi = lo;
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        v += stride;
+        lo.x = fminf(lo.x, v[0]); hi.x = fmaxf(hi.x, v[0]);
+        lo.y = fminf(lo.y, v[1]); hi.y = fmaxf(hi.y, v[1]);
+        lo.z = fminf(lo.z, v[2]); hi.z = fmaxf(hi.z, v[2]);
+    }
+
+    bounds_min = lo;
+    bounds_max = hi;
+}
+
+namespace mesh_detail
+{
+    // the generated shapes carry normals and uvs
+    static constexpr unsigned int SHAPE_LAYOUT = MESH_ATTRIB_POSITION | MESH_ATTRIB_NORMAL | MESH_ATTRIB_UV;
+    static constexpr int SHAPE_STRIDE = 8;
+
+    // vertices per thread before a generator fills rows in parallel
+    static constexpr size_t SHAPE_GRAIN = 16384;
+
+    // sizes the outputs once, regenerating at the same size does not allocate
+    static inline void BeginShape(Mesh& mesh, unsigned int layout, size_t vertex_count, size_t index_count)
+    {
+        mesh.vertices.resize(vertex_count * Mesh_VertexStride(layout));
+        mesh.indices.resize(index_count);
+        mesh.use_indices = index_count > 0;
+        mesh.layout = layout;
+        mesh.primitive = GL_TRIANGLES;
+
+        mesh.VAO = 0;
+        mesh.VBO = 0;
+        mesh.EBO = 0;
+
+        mesh.initialized = 0;
+    }
+
+    // cos and sin of segments + 1 angles spread evenly from start over span
+    static inline void Ring(std::vector<float>& c, std::vector<float>& s, int segments, float start, float span)
+    {
+        c.resize(segments + 1);
+        s.resize(segments + 1);
+        for (int i = 0; i <= segments; ++i)
+        {
+            float angle = start + span * (float)i / (float)segments;
+            c[i] = cosf(angle);
+            s[i] = sinf(angle);
+        }
+    }
+
+    // a full turn, the last entry repeats the first exactly so seams do not crack
+    static inline void TurnRing(std::vector<float>& c, std::vector<float>& s, int segments)
+    {
+        Ring(c, s, segments, 0.0f, 2.0f * consts::PI);
+        c[segments] = c[0];
+        s[segments] = s[0];
+    }
+
+    static inline void ShapeVertex(float* v, float px, float py, float pz, float nx, float ny, float nz, float u, float t)
+    {
+        v[0] = px; v[1] = py; v[2] = pz;
+        v[3] = nx; v[4] = ny; v[5] = nz;
+        v[6] = u;  v[7] = t;
+    }
+
+    // rows x cols quads over (rows + 1) x (cols + 1) vertices, rows run down and columns
+    // run right as seen from the front, a pole row collapses to a point and keeps only
+    // its non degenerate half
+    static inline size_t GridIndexCount(int rows, int cols, bool top_pole, bool bottom_pole)
+    {
+        size_t count = (size_t)rows * cols * 6;
+        if (top_pole) count -= (size_t)cols * 3;
+        if (bottom_pole) count -= (size_t)cols * 3;
+        return count;
+    }
+
+    // writes quad rows [row_begin, row_end) to their place in out, counter clockwise from the front
+    static inline void GridIndices(unsigned int* out, int row_begin, int row_end, int rows, int cols,
+                                   unsigned int base, bool top_pole, bool bottom_pole)
+    {
+        unsigned int* o = out + (size_t)row_begin * cols * 6;
+        if (top_pole && row_begin > 0) o -= (size_t)cols * 3;
+
+        for (int i = row_begin; i < row_end; ++i)
+        {
+            for (int j = 0; j < cols; ++j)
+            {
+                unsigned int a = base + (unsigned int)(i * (cols + 1) + j);
+                unsigned int b = a + cols + 1;
+                unsigned int c = b + 1;
+                unsigned int d = a + 1;
+
+                if (!(top_pole && i == 0))
+                {
+                    *o++ = a; *o++ = b; *o++ = d;
+                }
+                if (!(bottom_pole && i == rows - 1))
+                {
+                    *o++ = d; *o++ = b; *o++ = c;
+                }
+            }
+        }
+    }
+
+    // fn(begin, end) over rows of a grid, split across threads once the grid is big enough
+    template <typename Fn>
+    static inline void ParallelRows(int rows, int row_vertices, Fn&& fn)
+    {
+        size_t grain = SHAPE_GRAIN / (size_t)(row_vertices > 0 ? row_vertices : 1) + 1;
+        Thread_ParallelFor((size_t)rows, grain, [&](size_t begin, size_t end) { fn((int)begin, (int)end); });
+    }
+}
+
 // ALWAYS SET THE SHAPE BEFORE YOU INITIALIZE
 
 static inline void Mesh_SetTriangle(Mesh& mesh)
@@ -29,6 +264,8 @@ static inline void Mesh_SetTriangle(Mesh& mesh)
          0.0f,  0.5f, 0.0f
     };
     mesh.use_indices = false;
+    mesh.layout = MESH_ATTRIB_POSITION;
+    mesh.primitive = GL_TRIANGLES;
 
     mesh.VAO = 0;
     mesh.VBO = 0;
@@ -54,6 +291,8 @@ static inline void Mesh_SetRectangle(Mesh& mesh)
     };
 
     mesh.use_indices = true;
+    mesh.layout = MESH_ATTRIB_POSITION;
+    mesh.primitive = GL_TRIANGLES;
 
     mesh.VAO = 0;
     mesh.VBO = 0;
@@ -62,43 +301,35 @@ static inline void Mesh_SetRectangle(Mesh& mesh)
     mesh.initialized = 0;
 }
 
-// TODO
+// flat disc facing +z
 static inline void Mesh_SetCircle(Mesh& mesh, float radius, int sectors)
 {
-    mesh.vertices.clear();
-    mesh.indices.clear();
+    using namespace mesh_detail;
+    if (sectors < 3) sectors = 3;
 
-    // center vertex
-    mesh.vertices.push_back(0.0f);
-    mesh.vertices.push_back(0.0f);
-    mesh.vertices.push_back(0.0f);
+    std::vector<float> c, s;
+    TurnRing(c, s, sectors);
 
-    // perimeter vertices
-    for (int i = 0; i <= sectors; ++i)
-    {
-        float theta = (float)i / (float)sectors * 2.0f * consts::PI;
-        float x = radius * cosf(theta);
-        float y = radius * sinf(theta);
-        float z = 0.0f;
+    // center, then sectors + 1 perimeter vertices so the last one can carry its own uv
+    BeginShape(mesh, SHAPE_LAYOUT, (size_t)sectors + 2, (size_t)sectors * 3);
 
-        mesh.vertices.push_back(x);
-        mesh.vertices.push_back(y);
-        mesh.vertices.push_back(z);
-    }
+    float* v = mesh.vertices.data();
+    ShapeVertex(v, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f);
+    v += SHAPE_STRIDE;
 
-    // generate the indices for the triangle fan
-    for (int i = 0; i <= sectors; ++i)
+    for (int i = 0; i <= sectors; ++i, v += SHAPE_STRIDE)
     {
-        mesh.indices.push_back(0);      // center
-        mesh.indices.push_back(i);      // current
-        mesh.indices.push_back(i + 1);  // next
+        ShapeVertex(v, radius * c[i], radius * s[i], 0.0f, 0.0f, 0.0f, 1.0f, 0.5f + 0.5f * c[i], 0.5f + 0.5f * s[i]);
     }
 
-    mesh.use_indices = true;
-    mesh.VAO = 0;
-    mesh.VBO = 0;
-    mesh.EBO = 0;
-    mesh.initialized = 0;
+    // triangle fan, perimeter vertex i sits at index i + 1
+    unsigned int* o = mesh.indices.data();
+    for (int i = 0; i < sectors; ++i)
+    {
+        *o++ = 0;
+        *o++ = (unsigned int)i + 1;
+        *o++ = (unsigned int)i + 2;
+    }
 }
 
 static inline void Mesh_SetCube(Mesh& mesh)
@@ -133,6 +364,8 @@ static inline void Mesh_SetCube(Mesh& mesh)
     };
 
     mesh.use_indices = true;
+    mesh.layout = MESH_ATTRIB_POSITION;
+    mesh.primitive = GL_TRIANGLES;
 
     mesh.VAO = 0;
     mesh.VBO = 0;
@@ -141,74 +374,411 @@ static inline void Mesh_SetCube(Mesh& mesh)
     mesh.initialized = 0;
 }
 
+// uv sphere, the seam column is duplicated so uvs wrap cleanly
 static inline void Mesh_SetSphere(Mesh& mesh, float radius, int stacks, int sectors)
 {
-    mesh.vertices.clear();
-    mesh.vertices.clear();
+    using namespace mesh_detail;
+    if (stacks < 2) stacks = 2;
+    if (sectors < 3) sectors = 3;
 
-    int stack_count = stacks + 1;
-    int sector_count = sectors + 1;
+    // theta around y (longitude), phi from +y down to -y (latitude)
+    std::vector<float> cos_theta, sin_theta, cos_phi, sin_phi;
+    TurnRing(cos_theta, sin_theta, sectors);
+    Ring(cos_phi, sin_phi, stacks, 0.0f, consts::PI);
+    cos_phi[0] = 1.0f;       sin_phi[0] = 0.0f;
+    cos_phi[stacks] = -1.0f; sin_phi[stacks] = 0.0f;
 
-    mesh.vertices.reserve(stack_count * sector_count * 3);
+    int columns = sectors + 1;
+    BeginShape(mesh, SHAPE_LAYOUT, (size_t)(stacks + 1) * columns, GridIndexCount(stacks, sectors, true, true));
 
-    // phi from 0 to pi (latitude)
-    // theta from 0 to 2pi (longitude)
+    float* vertices = mesh.vertices.data();
+    unsigned int* indices = mesh.indices.data();
 
-    for (int i = 0; i <= stacks; ++i)
+    ParallelRows(stacks + 1, columns, [&](int begin, int end)
     {
-        float phi = (float)i / (float)stacks * consts::PI;
-        float cos_phi = cosf(phi);
-        float sin_phi = sinf(phi);
+        for (int i = begin; i < end; ++i)
+        {
+            float* v = vertices + (size_t)i * columns * SHAPE_STRIDE;
+            float t = 1.0f - (float)i / (float)stacks;
 
-        for (int j = 0; j < sectors; ++j)
+            for (int j = 0; j <= sectors; ++j, v += SHAPE_STRIDE)
+            {
+                float nx = cos_theta[j] * sin_phi[i];
+                float ny = cos_phi[i];
+                float nz = -sin_theta[j] * sin_phi[i];
+                ShapeVertex(v, radius * nx, radius * ny, radius * nz, nx, ny, nz, (float)j / (float)sectors, t);
+            }
+        }
+
+        GridIndices(indices, begin, end < stacks ? end : stacks, stacks, sectors, 0, true, true);
+    });
+}
+
+// subdivided icosahedron, evenly spread triangles without the crowding at the poles
+static inline void Mesh_SetIcosphere(Mesh& mesh, float radius, int subdivisions)
+{
+    using namespace mesh_detail;
+    if (subdivisions < 0) subdivisions = 0;
+    if (subdivisions > 10) subdivisions = 10;
+
+    size_t faces = (size_t)20 << (2 * subdivisions);
+    size_t points = faces / 2 + 2;
+
+    const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+    const float base[12][3] =
+    {
+        {-1,  t,  0}, { 1,  t,  0}, {-1, -t,  0}, { 1, -t,  0},
+        { 0, -1,  t}, { 0,  1,  t}, { 0, -1, -t}, { 0,  1, -t},
+        { t,  0, -1}, { t,  0,  1}, {-t,  0, -1}, {-t,  0,  1}
+    };
+
+    // unit directions, seam duplicates are appended at the end
+    std::vector<float> p;
+    p.reserve(points * 3);
+    for (const float* b : base)
+    {
+        float len = sqrtf(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+        p.push_back(b[0] / len);
+        p.push_back(b[1] / len);
+        p.push_back(b[2] / len);
+    }
+
+    std::vector<unsigned int> tris =
+    {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+    };
+    tris.reserve(faces * 3);
+
+    std::vector<unsigned int> next;
+    next.reserve(faces * 3);
+
+    // every edge is shared by two faces, the midpoint is made once
+    std::unordered_map<uint64_t, unsigned int> midpoints;
+    midpoints.reserve(faces * 3 / 2);
+
+    auto midpoint = [&](unsigned int a, unsigned int b)
+    {
+        uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+        auto found = midpoints.find(key);
+        if (found != midpoints.end()) return found->second;
+
+        float x = p[a * 3 + 0] + p[b * 3 + 0];
+        float y = p[a * 3 + 1] + p[b * 3 + 1];
+        float z = p[a * 3 + 2] + p[b * 3 + 2];
+        float len = sqrtf(x * x + y * y + z * z);
+
+        unsigned int index = (unsigned int)(p.size() / 3);
+        p.push_back(x / len);
+        p.push_back(y / len);
+        p.push_back(z / len);
+        midpoints.emplace(key, index);
+        return index;
+    };
+
+    for (int level = 0; level < subdivisions; ++level)
+    {
+        next.clear();
+        midpoints.clear();
+
+        for (size_t f = 0; f < tris.size(); f += 3)
         {
-            float theta = (float)j / (float)sectors * 2.0f * consts::PI;
-            float cos_theta = cosf(theta);
-            float sin_theta = sinf(theta);
+            unsigned int a = tris[f], b = tris[f + 1], c = tris[f + 2];
+            unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+
+            unsigned int split[12] = {a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca};
+            next.insert(next.end(), split, split + 12);
+        }
+
+        tris.swap(next);
+    }
+
+    // same uv mapping as Mesh_SetSphere
+    std::vector<float> u(points);
+    for (size_t i = 0; i < points; ++i)
+    {
+        float theta = atan2f(-p[i * 3 + 2], p[i * 3 + 0]);
+        u[i] = theta / (2.0f * consts::PI);
+        if (u[i] < 0.0f) u[i] += 1.0f;
+    }
 
-            float x = radius * cos_theta * sin_phi;
-            float y = radius * cos_phi;
-            float z = radius * sin_theta * sin_phi;
+    // faces straddling the seam get copies of their low u corners shifted by one
+    std::vector<unsigned int> seam(points, 0);
+    size_t total = points;
+    for (size_t f = 0; f < tris.size(); f += 3)
+    {
+        float lo = fminf(u[tris[f]], fminf(u[tris[f + 1]], u[tris[f + 2]]));
+        float hi = fmaxf(u[tris[f]], fmaxf(u[tris[f + 1]], u[tris[f + 2]]));
+        if (hi - lo <= 0.5f) continue;
 
-            mesh.vertices.push_back(x);
-            mesh.vertices.push_back(y);
-            mesh.vertices.push_back(z);
+        for (size_t k = f; k < f + 3; ++k)
+        {
+            unsigned int i = tris[k];
+            if (u[i] >= 0.5f) continue;
+            if (seam[i] == 0) seam[i] = (unsigned int)total++;
+            tris[k] = seam[i];
         }
     }
 
-    // generate indices (two triangles per quad)
-    for (int i = 0; i < stacks; ++i)
+    BeginShape(mesh, SHAPE_LAYOUT, total, tris.size());
+
+    float* vertices = mesh.vertices.data();
+    Thread_ParallelFor(points, SHAPE_GRAIN, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float nx = p[i * 3 + 0], ny = p[i * 3 + 1], nz = p[i * 3 + 2];
+            float v = 1.0f - acosf(fmaxf(-1.0f, fminf(1.0f, ny))) / consts::PI;
+
+            ShapeVertex(vertices + i * SHAPE_STRIDE, radius * nx, radius * ny, radius * nz, nx, ny, nz, u[i], v);
+            if (seam[i])
+            {
+                ShapeVertex(vertices + (size_t)seam[i] * SHAPE_STRIDE, radius * nx, radius * ny, radius * nz, nx, ny, nz, u[i] + 1.0f, v);
+            }
+        }
+    });
+
+    memcpy(mesh.indices.data(), tris.data(), tris.size() * sizeof(unsigned int));
+}
+
+// y axis capsule, height is the length of the straight part between the two hemisphere centers
+static inline void Mesh_SetCapsule(Mesh& mesh, float radius, float height, int rings, int sectors)
+{
+    using namespace mesh_detail;
+    if (rings < 1) rings = 1;
+    if (sectors < 3) sectors = 3;
+
+    std::vector<float> cos_theta, sin_theta, cos_phi, sin_phi;
+    TurnRing(cos_theta, sin_theta, sectors);
+    Ring(cos_phi, sin_phi, rings, 0.0f, 0.5f * consts::PI);
+    cos_phi[0] = 1.0f;     sin_phi[0] = 0.0f;
+    cos_phi[rings] = 0.0f; sin_phi[rings] = 1.0f;
+
+    // rings + 1 rows per hemisphere, the quad band between them is the straight part
+    int rows = 2 * (rings + 1);
+    int columns = sectors + 1;
+    BeginShape(mesh, SHAPE_LAYOUT, (size_t)rows * columns, GridIndexCount(rows - 1, sectors, true, true));
+
+    float half = 0.5f * height;
+    float arc = 0.5f * consts::PI * radius;
+    float length = 2.0f * arc + height;
+
+    float* vertices = mesh.vertices.data();
+    unsigned int* indices = mesh.indices.data();
+
+    ParallelRows(rows, columns, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            bool top = i <= rings;
+            int k = top ? i : i - (rings + 1);
+
+            // the bottom hemisphere continues past the equator, phi = 90 + k steps
+            float cp = top ? cos_phi[k] : -sin_phi[k];
+            float sp = top ? sin_phi[k] : cos_phi[k];
+            float y = (top ? half : -half) + radius * cp;
+            float along = top ? arc * (float)k / (float)rings
+                              : arc + height + arc * (float)k / (float)rings;
+            float t = 1.0f - along / length;
+
+            float* v = vertices + (size_t)i * columns * SHAPE_STRIDE;
+            for (int j = 0; j <= sectors; ++j, v += SHAPE_STRIDE)
+            {
+                float nx = cos_theta[j] * sp;
+                float nz = -sin_theta[j] * sp;
+                ShapeVertex(v, radius * nx, y, radius * nz, nx, cp, nz, (float)j / (float)sectors, t);
+            }
+        }
+
+        GridIndices(indices, begin, end < rows - 1 ? end : rows - 1, rows - 1, sectors, 0, true, true);
+    });
+}
+
+// y axis cylinder centred on the origin, stacks splits the side, caps adds both end discs
+static inline void Mesh_SetCylinder(Mesh& mesh, float radius, float height, int sectors, int stacks = 1, bool caps = true)
+{
+    using namespace mesh_detail;
+    if (sectors < 3) sectors = 3;
+    if (stacks < 1) stacks = 1;
+
+    std::vector<float> c, s;
+    TurnRing(c, s, sectors);
+
+    int columns = sectors + 1;
+    size_t side_vertices = (size_t)(stacks + 1) * columns;
+    size_t side_indices = GridIndexCount(stacks, sectors, false, false);
+    size_t cap_vertices = caps ? (size_t)columns + 1 : 0;
+    size_t cap_indices = caps ? (size_t)sectors * 3 : 0;
+
+    BeginShape(mesh, SHAPE_LAYOUT, side_vertices + 2 * cap_vertices, side_indices + 2 * cap_indices);
+
+    float half = 0.5f * height;
+    float* vertices = mesh.vertices.data();
+    unsigned int* indices = mesh.indices.data();
+
+    ParallelRows(stacks + 1, columns, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            float t = 1.0f - (float)i / (float)stacks;
+            float y = half - height * (float)i / (float)stacks;
+
+            float* v = vertices + (size_t)i * columns * SHAPE_STRIDE;
+            for (int j = 0; j <= sectors; ++j, v += SHAPE_STRIDE)
+            {
+                ShapeVertex(v, radius * c[j], y, -radius * s[j], c[j], 0.0f, -s[j], (float)j / (float)sectors, t);
+            }
+        }
+
+        GridIndices(indices, begin, end < stacks ? end : stacks, stacks, sectors, 0, false, false);
+    });
+
+    if (!caps) return;
+
+    // top then bottom, each a center vertex and its own ring so the normals stay flat
+    for (int cap = 0; cap < 2; ++cap)
     {
+        float ny = cap == 0 ? 1.0f : -1.0f;
+        unsigned int center = (unsigned int)(side_vertices + cap * cap_vertices);
+
+        float* v = vertices + (size_t)center * SHAPE_STRIDE;
+        ShapeVertex(v, 0.0f, ny * half, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+        v += SHAPE_STRIDE;
+
+        for (int j = 0; j <= sectors; ++j, v += SHAPE_STRIDE)
+        {
+            ShapeVertex(v, radius * c[j], ny * half, -radius * s[j], 0.0f, ny, 0.0f, 0.5f + 0.5f * c[j], 0.5f + 0.5f * ny * s[j]);
+        }
+
+        unsigned int* o = indices + side_indices + cap * cap_indices;
         for (int j = 0; j < sectors; ++j)
         {
-            // indices of quad corners
-            int a = i * (sectors + 1) + j;
-            int b = a + sectors + 1;
-            int c = b + 1;
-            int d = a + 1;
-
-            // triangle 1: a, b, d
-            mesh.indices.push_back((unsigned int)a);
-            mesh.indices.push_back((unsigned int)b);
-            mesh.indices.push_back((unsigned int)d);
-
-            // triangle 2: d, b, c
-            mesh.indices.push_back((unsigned int)d);
-            mesh.indices.push_back((unsigned int)b);
-            mesh.indices.push_back((unsigned int)c);
+            unsigned int a = center + 1 + j;
+            *o++ = center;
+            *o++ = cap == 0 ? a : a + 1;
+            *o++ = cap == 0 ? a + 1 : a;
         }
     }
+}
 
-    mesh.use_indices = true;
+// torus around the y axis, rings segments around the main circle and sides around the tube
+static inline void Mesh_SetTorus(Mesh& mesh, float major_radius, float minor_radius, int rings, int sides)
+{
+    using namespace mesh_detail;
+    if (rings < 3) rings = 3;
+    if (sides < 3) sides = 3;
 
-    mesh.VAO = 0;
-    mesh.VBO = 0;
-    mesh.EBO = 0;
+    std::vector<float> cos_theta, sin_theta, cos_psi, sin_psi;
+    TurnRing(cos_theta, sin_theta, rings);
+    TurnRing(cos_psi, sin_psi, sides);
 
-    mesh.initialized = 0;
+    // rows go around the tube, starting on the outer equator and heading down
+    int columns = rings + 1;
+    BeginShape(mesh, SHAPE_LAYOUT, (size_t)(sides + 1) * columns, GridIndexCount(sides, rings, false, false));
+
+    float* vertices = mesh.vertices.data();
+    unsigned int* indices = mesh.indices.data();
+
+    ParallelRows(sides + 1, columns, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            float distance = major_radius + minor_radius * cos_psi[i];
+            float ny = -sin_psi[i];
+            float t = 1.0f - (float)i / (float)sides;
+
+            float* v = vertices + (size_t)i * columns * SHAPE_STRIDE;
+            for (int j = 0; j <= rings; ++j, v += SHAPE_STRIDE)
+            {
+                float nx = cos_psi[i] * cos_theta[j];
+                float nz = -cos_psi[i] * sin_theta[j];
+                ShapeVertex(v, distance * cos_theta[j], minor_radius * ny, -distance * sin_theta[j],
+                            nx, ny, nz, (float)j / (float)rings, t);
+            }
+        }
+
+        GridIndices(indices, begin, end < sides ? end : sides, sides, rings, 0, false, false);
+    });
 }
 
-static inline void Mesh_Generate(Mesh& mesh)
+// xz plane facing +y, split into segments_x by segments_z quads
+static inline void Mesh_SetPlane(Mesh& mesh, float width, float depth, int segments_x, int segments_z)
+{
+    using namespace mesh_detail;
+    if (segments_x < 1) segments_x = 1;
+    if (segments_z < 1) segments_z = 1;
+
+    int columns = segments_x + 1;
+    BeginShape(mesh, SHAPE_LAYOUT, (size_t)(segments_z + 1) * columns, GridIndexCount(segments_z, segments_x, false, false));
+
+    float* vertices = mesh.vertices.data();
+    unsigned int* indices = mesh.indices.data();
+
+    // rows run from -z to +z, which is down when looking at the plane from above
+    ParallelRows(segments_z + 1, columns, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            float fz = (float)i / (float)segments_z;
+            float z = depth * (fz - 0.5f);
+
+            float* v = vertices + (size_t)i * columns * SHAPE_STRIDE;
+            for (int j = 0; j <= segments_x; ++j, v += SHAPE_STRIDE)
+            {
+                float fx = (float)j / (float)segments_x;
+                ShapeVertex(v, width * (fx - 0.5f), 0.0f, z, 0.0f, 1.0f, 0.0f, fx, 1.0f - fz);
+            }
+        }
+
+        GridIndices(indices, begin, end < segments_z ? end : segments_z, segments_z, segments_x, 0, false, false);
+    });
+}
+
+// describes the interleaved layout to the currently bound VAO and VBO
+static inline void Mesh_SetAttributes(unsigned int layout)
+{
+    GLsizei stride = Mesh_VertexStride(layout) * sizeof(float);
+    size_t offset = 0;
+
+    if (layout & MESH_ATTRIB_QUANTIZED)
+    {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offset);
+        offset += 4 * sizeof(unsigned short);
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        offset += 3 * sizeof(float);
+    }
+    glEnableVertexAttribArray(0);
+
+    if (layout & MESH_ATTRIB_NORMAL)
+    {
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glEnableVertexAttribArray(1);
+        offset += 3 * sizeof(float);
+    }
+
+    if (layout & MESH_ATTRIB_UV)
+    {
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glEnableVertexAttribArray(2);
+        offset += 2 * sizeof(float);
+    }
+
+    if (layout & MESH_ATTRIB_TANGENT)
+    {
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glEnableVertexAttribArray(3);
+    }
+}
+
+// uploads vertex data laid out as mesh.layout and optional 32 bit indices,
+// the data can live anywhere (a mapped file, a decode buffer), it is not kept
+static inline void Mesh_GenerateFrom(Mesh& mesh, const void* vertex_data, unsigned int vertex_count,
+                                     const unsigned int* index_data, unsigned int index_count)
 {
     if (mesh.initialized == -1)
     {
@@ -221,18 +791,210 @@ static inline void Mesh_Generate(Mesh& mesh)
 
     if (mesh.use_indices) glGenBuffers(1, &mesh.EBO);
 
-    glBindVertexArray(mesh.VAO);
+    Mesh_BindVertexArray(mesh.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)vertex_count * Mesh_VertexStride(mesh.layout) * sizeof(float), vertex_data, GL_STATIC_DRAW);
 
     if (mesh.use_indices)
     {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)index_count * sizeof(unsigned int), index_data, GL_STATIC_DRAW);
     }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    Mesh_SetAttributes(mesh.layout);
+
+    mesh.vertex_count = vertex_count;
+    mesh.index_count = mesh.use_indices ? index_count : 0;
+    mesh.vertex_capacity = mesh.vertex_count;
+    mesh.index_capacity = mesh.index_count;
+}
+
+static inline void Mesh_Generate(Mesh& mesh)
+{
+    Mesh_GenerateFrom(mesh, mesh.vertices.data(), Mesh_VertexCount(mesh), mesh.indices.data(), (unsigned int)mesh.indices.size());
+    Mesh_ComputeBounds(mesh, mesh.bounds_min, mesh.bounds_max);
+}
+
+namespace mesh_detail
+{
+    // more separate ranges than this and the closest two are merged
+    static constexpr size_t MAX_DIRTY_RANGES = 8;
+
+    // ranges closer than this are merged, one larger upload beats two calls
+    static constexpr unsigned int MERGE_GAP = 64;
+
+    // uploads at least this big go through a mapped range instead of glBufferSubData
+    static constexpr size_t MAP_THRESHOLD = 64 * 1024;
+
+    // keeps ranges sorted and disjoint
+    static inline void AddRange(std::vector<MeshRange>& ranges, unsigned int first, unsigned int count)
+    {
+        if (count == 0) return;
+
+        unsigned int begin = first;
+        unsigned int end = first + count;
+
+        size_t i = 0;
+        while (i < ranges.size() && ranges[i].first + ranges[i].count + MERGE_GAP < begin) ++i;
+
+        // swallow every range that touches [begin, end)
+        size_t j = i;
+        while (j < ranges.size() && ranges[j].first <= end + MERGE_GAP)
+        {
+            begin = ranges[j].first < begin ? ranges[j].first : begin;
+            end = ranges[j].first + ranges[j].count > end ? ranges[j].first + ranges[j].count : end;
+            ++j;
+        }
+
+        ranges.erase(ranges.begin() + i, ranges.begin() + j);
+        ranges.insert(ranges.begin() + i, {begin, end - begin});
+
+        if (ranges.size() <= MAX_DIRTY_RANGES) return;
+
+        size_t closest = 0;
+        unsigned int gap = 0xffffffffu;
+        for (size_t k = 0; k + 1 < ranges.size(); ++k)
+        {
+            unsigned int between = ranges[k + 1].first - (ranges[k].first + ranges[k].count);
+            if (between < gap)
+            {
+                gap = between;
+                closest = k;
+            }
+        }
+
+        ranges[closest].count = ranges[closest + 1].first + ranges[closest + 1].count - ranges[closest].first;
+        ranges.erase(ranges.begin() + closest + 1);
+    }
+
+    // new buffer of new_bytes holding the first used_bytes of the old one, copied on the GPU
+    static inline unsigned int GrowBuffer(unsigned int buffer, size_t used_bytes, size_t new_bytes)
+    {
+        unsigned int grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, NULL, GL_DYNAMIC_DRAW);
+
+        if (buffer)
+        {
+            if (used_bytes > 0)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_bytes);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return grown;
+    }
+
+    static inline void Upload(unsigned int buffer, size_t offset, size_t bytes, const void* data)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+        void* mapped = nullptr;
+        if (bytes >= MAP_THRESHOLD)
+        {
+            mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        }
+
+        if (mapped)
+        {
+            memcpy(mapped, data, bytes);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+        else glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+// marks count vertices from first as changed in mesh.vertices, uploaded by Mesh_FlushUpdates
+// grow the vector first to append, the new vertices are picked up on flush
+static inline void Mesh_UpdateRange(Mesh& mesh, unsigned int first, unsigned int count)
+{
+    mesh_detail::AddRange(mesh.dirty_vertices, first, count);
+}
+
+// same for mesh.indices
+static inline void Mesh_UpdateIndexRange(Mesh& mesh, unsigned int first, unsigned int count)
+{
+    mesh_detail::AddRange(mesh.dirty_indices, first, count);
+}
+
+// pushes this frame's coalesced edits to the GPU, call once before drawing the mesh
+static inline void Mesh_FlushUpdates(Mesh& mesh)
+{
+    using namespace mesh_detail;
+
+    if (mesh.initialized != 0 || mesh.VAO == 0) return;
+
+    size_t vertex_size = Mesh_VertexStride(mesh.layout) * sizeof(float);
+    unsigned int vertex_count = Mesh_VertexCount(mesh);
+    unsigned int index_count = mesh.use_indices ? (unsigned int)mesh.indices.size() : 0;
+
+    // appended data is dirty even if nobody said so
+    if (vertex_count > mesh.vertex_count) AddRange(mesh.dirty_vertices, mesh.vertex_count, vertex_count - mesh.vertex_count);
+    if (index_count > mesh.index_count) AddRange(mesh.dirty_indices, mesh.index_count, index_count - mesh.index_count);
+
+    if (mesh.pool)
+    {
+        // pooled space is fixed, a bigger mesh has to be removed and added again
+        if (vertex_count > mesh.vertex_capacity || index_count > mesh.index_capacity)
+        {
+            std::cout << "Pooled mesh outgrew its pool allocation, re-add it to the pool" << std::endl;
+            if (vertex_count > mesh.vertex_capacity) vertex_count = mesh.vertex_capacity;
+            if (index_count > mesh.index_capacity) index_count = mesh.index_capacity;
+        }
+    }
+    else if (vertex_count > mesh.vertex_capacity || index_count > mesh.index_capacity || (index_count && !mesh.EBO))
+    {
+        if (vertex_count > mesh.vertex_capacity)
+        {
+            unsigned int capacity = mesh.vertex_capacity + mesh.vertex_capacity / 2;
+            if (capacity < vertex_count) capacity = vertex_count;
+            mesh.VBO = GrowBuffer(mesh.VBO, mesh.vertex_count * vertex_size, capacity * vertex_size);
+            mesh.vertex_capacity = capacity;
+        }
+
+        if (index_count > mesh.index_capacity || (index_count && !mesh.EBO))
+        {
+            unsigned int capacity = mesh.index_capacity + mesh.index_capacity / 2;
+            if (capacity < index_count) capacity = index_count;
+            mesh.EBO = GrowBuffer(mesh.EBO, mesh.index_count * sizeof(unsigned int), capacity * sizeof(unsigned int));
+            mesh.index_capacity = capacity;
+        }
+
+        // the VAO still points at the old buffers
+        Mesh_BindVertexArray(mesh.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        Mesh_SetAttributes(mesh.layout);
+        if (mesh.EBO) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        Mesh_BindVertexArray(0);
+    }
+
+    for (const MeshRange& range : mesh.dirty_vertices)
+    {
+        if (range.first >= vertex_count) continue;
+        unsigned int count = range.first + range.count > vertex_count ? vertex_count - range.first : range.count;
+        Upload(mesh.VBO, (size_t)(mesh.base_vertex + range.first) * vertex_size, (size_t)count * vertex_size,
+               mesh.vertices.data() + (size_t)range.first * Mesh_VertexStride(mesh.layout));
+    }
+
+    for (const MeshRange& range : mesh.dirty_indices)
+    {
+        if (range.first >= index_count) continue;
+        unsigned int count = range.first + range.count > index_count ? index_count - range.first : range.count;
+        Upload(mesh.EBO, (size_t)(mesh.first_index + range.first) * sizeof(unsigned int), (size_t)count * sizeof(unsigned int),
+               mesh.indices.data() + range.first);
+    }
+
+    mesh.dirty_vertices.clear();
+    mesh.dirty_indices.clear();
+    mesh.vertex_count = vertex_count;
+    mesh.index_count = index_count;
 }
 
 static inline void Mesh_Draw(const Mesh& mesh)
@@ -243,14 +1005,59 @@ static inline void Mesh_Draw(const Mesh& mesh)
         return;
     } 
 
-    glBindVertexArray(mesh.VAO);
+    if (mesh.initialized == 1) return;
+
+    Mesh_SetPrimitiveRestart(mesh.primitive != GL_TRIANGLES);
+
+    // pooled meshes share one VAO, leave it bound for the next pooled draw
+    if (mesh.pool)
+    {
+        Mesh_BindVertexArray(mesh.VAO);
+
+        if (mesh.use_indices)
+            glDrawElementsBaseVertex(mesh.primitive, mesh.index_count, GL_UNSIGNED_INT,
+                                     (void*)((size_t)mesh.first_index * sizeof(unsigned int)), mesh.base_vertex);
+        else
+            glDrawArrays(mesh.primitive, mesh.base_vertex, mesh.vertex_count);
+
+        Mesh_SetPrimitiveRestart(false);
+        return;
+    }
+
+    Mesh_BindVertexArray(mesh.VAO);
 
     if (mesh.use_indices)
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(mesh.primitive, mesh.index_count, GL_UNSIGNED_INT, 0);
     else
-        glDrawArrays(GL_TRIANGLES, 0, mesh.vertices.size() / 3 * sizeof(float));
+        glDrawArrays(mesh.primitive, 0, mesh.vertex_count);
 
-    glBindVertexArray(0);
+    Mesh_SetPrimitiveRestart(false);
+    Mesh_BindVertexArray(0);
+}
+
+// draws count indices starting at first, e.g. one material group or one LOD
+static inline void Mesh_DrawRange(const Mesh& mesh, unsigned int first, unsigned int count)
+{
+    if (mesh.initialized == -1)
+    {
+        std::cout<< "Mesh not initialized with shape" << std::endl;
+        return;
+    } 
+
+    if (mesh.initialized == 1) return;
+
+    Mesh_SetPrimitiveRestart(mesh.primitive != GL_TRIANGLES);
+
+    Mesh_BindVertexArray(mesh.VAO);
+
+    if (mesh.use_indices)
+        glDrawElementsBaseVertex(mesh.primitive, count, GL_UNSIGNED_INT,
+                                 (void*)((size_t)(mesh.first_index + first) * sizeof(unsigned int)), mesh.base_vertex);
+    else
+        glDrawArrays(mesh.primitive, mesh.base_vertex + first, count);
+
+    Mesh_SetPrimitiveRestart(false);
+    if (!mesh.pool) Mesh_BindVertexArray(0);
 }
 
 static inline void Mesh_DrawWireFrame(const Mesh& mesh)
@@ -266,17 +1073,32 @@ static inline void Mesh_DrawWireFrame(const Mesh& mesh)
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
+// pooled meshes only drop their handles here, GeometryPool_Remove gives their space back
 static inline void Mesh_Delete(Mesh& mesh)
 {
-    if (mesh.EBO) glDeleteBuffers(1, &mesh.EBO);
-    if (mesh.VAO) glDeleteVertexArrays(1, &mesh.VAO);
-    if (mesh.VBO) glDeleteBuffers(1, &mesh.VBO);
+    if (!mesh.pool)
+    {
+        if (mesh.VAO == mesh_detail::bound_vao) Mesh_BindVertexArray(0);
+        if (mesh.EBO) glDeleteBuffers(1, &mesh.EBO);
+        if (mesh.VAO) glDeleteVertexArrays(1, &mesh.VAO);
+        if (mesh.VBO) glDeleteBuffers(1, &mesh.VBO);
+    }
     
     mesh.vertices.clear();
     mesh.indices.clear();
     mesh.VAO = 0;
     mesh.VBO = 0;
     mesh.EBO = 0;
+    mesh.vertex_count = 0;
+    mesh.index_count = 0;
+    mesh.pool = nullptr;
+    mesh.base_vertex = 0;
+    mesh.first_index = 0;
+    mesh.vertex_capacity = 0;
+    mesh.index_capacity = 0;
+    mesh.primitive = GL_TRIANGLES;
+    mesh.dirty_vertices.clear();
+    mesh.dirty_indices.clear();
 }
 
 #endif
\ No newline at end of file
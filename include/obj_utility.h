@@ -0,0 +1,702 @@
+#ifndef OBJ_UTILITY_H
+#define OBJ_UTILITY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+#include "file_utility.h"
+#include "math_utility.h"
+#include "mesh_utility.h"
+#include "parse_utility.h"
+#include "thread_utility.h"
+
+/*
+    Wavefront OBJ + MTL importer
+
+    The file is memory mapped and parsed in place, no line is ever copied.
+    Large files are cut into chunks at line boundaries and the chunks are
+    parsed in parallel, then stitched back together in file order.
+    Polygons are fan triangulated and every unique v/vt/vn triple becomes
+    one welded vertex in the output mesh.
+*/
+
+struct ObjMaterial
+{
+    std::string name;
+    Vector3 ambient = {0.0f, 0.0f, 0.0f};
+    Vector3 diffuse = {1.0f, 1.0f, 1.0f};
+    Vector3 specular = {0.0f, 0.0f, 0.0f};
+    Vector3 emissive = {0.0f, 0.0f, 0.0f};
+    float shininess = 0.0f;
+    float opacity = 1.0f;
+    int illum = 0;
+    std::string diffuse_map;
+    std::string specular_map;
+    std::string normal_map;
+};
+
+// a run of indices that uses one material, material is -1 if none was set
+struct ObjGroup
+{
+    int material;
+    unsigned int first_index;
+    unsigned int index_count;
+};
+
+struct ObjModel
+{
+    std::vector<ObjMaterial> materials;
+    std::vector<ObjGroup> groups;
+};
+
+namespace obj_detail
+{
+    // chunks smaller than this are not worth a thread
+    static constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    // corner index flags, a relative index is resolved against the chunk base
+    static constexpr uint8_t HAS_UV = 1 << 0;
+    static constexpr uint8_t HAS_NORMAL = 1 << 1;
+    static constexpr uint8_t REL_POSITION = 1 << 2;
+    static constexpr uint8_t REL_UV = 1 << 3;
+    static constexpr uint8_t REL_NORMAL = 1 << 4;
+
+    struct Corner
+    {
+        int32_t v, vt, vn;
+        uint8_t flags;
+    };
+
+    struct UseMaterial
+    {
+        const char* name;
+        size_t length;
+        size_t corner;
+    };
+
+    struct Chunk
+    {
+        const char* begin;
+        const char* end;
+
+        std::vector<float> positions;   // xyz
+        std::vector<float> texcoords;   // uv
+        std::vector<float> normals;     // xyz
+        std::vector<Corner> corners;    // 3 per triangle
+        std::vector<UseMaterial> materials;
+        std::vector<UseMaterial> libraries;
+
+        size_t position_base = 0;
+        size_t texcoord_base = 0;
+        size_t normal_base = 0;
+        size_t corner_base = 0;
+    };
+
+    static inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    // never moves past the end of the line
+    static inline const char* SkipSpace(const char* p, const char* end)
+    {
+        while (p < end && IsSpace(*p)) ++p;
+        return p;
+    }
+
+    static inline const char* NextLine(const char* p, const char* end)
+    {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        return nl ? nl + 1 : end;
+    }
+
+    static inline bool StartsWith(const char* p, const char* end, const char* word, size_t length)
+    {
+        return (size_t)(end - p) > length && memcmp(p, word, length) == 0 && IsSpace(p[length]);
+    }
+
+    static inline float ParseFloat(const char*& p, const char* end)
+    {
+        p = SkipSpace(p, end);
+        return (float)Parse_Number(p, end);
+    }
+
+    // signed integer, returns false if there is no number
+    static inline bool ParseInt(const char*& p, const char* end, int32_t& out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            ++p;
+        }
+
+        if (p >= end || !Parse_IsDigit(*p)) return false;
+
+        int64_t value = 0;
+        while (p < end && Parse_IsDigit(*p))
+        {
+            if (value < 0x7FFFFFFF) value = value * 10 + (*p - '0');
+            ++p;
+        }
+        if (value > 0x7FFFFFFF) value = 0x7FFFFFFF;
+
+        out = (int32_t)(negative ? -value : value);
+        return true;
+    }
+
+    // OBJ indices are 1 based, negative ones count back from the last element parsed
+    static inline int32_t EncodeIndex(int32_t raw, size_t local_count, uint8_t rel_flag, uint8_t& flags)
+    {
+        if (raw > 0) return raw - 1;
+
+        flags |= rel_flag;
+        return (int32_t)((int64_t)local_count + raw);
+    }
+
+    // v, v/vt, v//vn or v/vt/vn
+    static inline bool ParseCorner(const char*& p, const char* end, const Chunk& chunk, Corner& corner)
+    {
+        int32_t raw;
+        corner.flags = 0;
+        corner.vt = 0;
+        corner.vn = 0;
+
+        if (!ParseInt(p, end, raw) || raw == 0) return false;
+        corner.v = EncodeIndex(raw, chunk.positions.size() / 3, REL_POSITION, corner.flags);
+
+        if (p < end && *p == '/')
+        {
+            ++p;
+            if (ParseInt(p, end, raw) && raw != 0)
+            {
+                corner.vt = EncodeIndex(raw, chunk.texcoords.size() / 2, REL_UV, corner.flags);
+                corner.flags |= HAS_UV;
+            }
+
+            if (p < end && *p == '/')
+            {
+                ++p;
+                if (ParseInt(p, end, raw) && raw != 0)
+                {
+                    corner.vn = EncodeIndex(raw, chunk.normals.size() / 3, REL_NORMAL, corner.flags);
+                    corner.flags |= HAS_NORMAL;
+                }
+            }
+        }
+
+        // skip anything we did not understand up to the next corner
+        while (p < end && !IsSpace(*p) && *p != '\n') ++p;
+
+        return true;
+    }
+
+    // rest of the line without surrounding whitespace
+    static inline void ParseName(const char* p, const char* end, const char*& name, size_t& length)
+    {
+        p = SkipSpace(p, end);
+        const char* stop = p;
+        while (stop < end && *stop != '\n' && *stop != '#') ++stop;
+        while (stop > p && IsSpace(stop[-1])) --stop;
+
+        name = p;
+        length = stop - p;
+    }
+
+    static inline void ParseChunk(Chunk& chunk)
+    {
+        const char* p = chunk.begin;
+        const char* end = chunk.end;
+
+        while (p < end)
+        {
+            p = SkipSpace(p, end);
+            if (p >= end) break;
+
+            if (p[0] == 'v' && p + 1 < end)
+            {
+                if (IsSpace(p[1]))
+                {
+                    p += 2;
+                    float x = ParseFloat(p, end);
+                    float y = ParseFloat(p, end);
+                    float z = ParseFloat(p, end);
+                    chunk.positions.push_back(x);
+                    chunk.positions.push_back(y);
+                    chunk.positions.push_back(z);
+                }
+                else if (p[1] == 't' && p + 2 < end && IsSpace(p[2]))
+                {
+                    p += 3;
+                    float u = ParseFloat(p, end);
+                    float v = ParseFloat(p, end);
+                    chunk.texcoords.push_back(u);
+                    chunk.texcoords.push_back(v);
+                }
+                else if (p[1] == 'n' && p + 2 < end && IsSpace(p[2]))
+                {
+                    p += 3;
+                    float x = ParseFloat(p, end);
+                    float y = ParseFloat(p, end);
+                    float z = ParseFloat(p, end);
+                    chunk.normals.push_back(x);
+                    chunk.normals.push_back(y);
+                    chunk.normals.push_back(z);
+                }
+            }
+            else if (p[0] == 'f' && p + 1 < end && IsSpace(p[1]))
+            {
+                // fan triangulation streamed corner by corner, polygons of any size
+                p += 2;
+                Corner first = {}, prev = {}, cur;
+                int count = 0;
+
+                while (true)
+                {
+                    p = SkipSpace(p, end);
+                    if (p >= end || *p == '\n' || *p == '#') break;
+                    if (!ParseCorner(p, end, chunk, cur)) break;
+
+                    if (count == 0) first = cur;
+                    else if (count >= 2)
+                    {
+                        chunk.corners.push_back(first);
+                        chunk.corners.push_back(prev);
+                        chunk.corners.push_back(cur);
+                    }
+
+                    prev = cur;
+                    ++count;
+                }
+            }
+            else if (StartsWith(p, end, "usemtl", 6))
+            {
+                UseMaterial use;
+                ParseName(p + 6, end, use.name, use.length);
+                use.corner = chunk.corners.size();
+                chunk.materials.push_back(use);
+            }
+            else if (StartsWith(p, end, "mtllib", 6))
+            {
+                UseMaterial lib;
+                ParseName(p + 6, end, lib.name, lib.length);
+                lib.corner = 0;
+                chunk.libraries.push_back(lib);
+            }
+
+            p = NextLine(p, end);
+        }
+    }
+
+    // resolves relative indices and range checks, out of range attributes are dropped
+    static inline void ResolveChunk(Chunk& chunk, size_t position_count, size_t texcoord_count, size_t normal_count, bool& bad_index)
+    {
+        for (Corner& c : chunk.corners)
+        {
+            int64_t v = c.v + ((c.flags & REL_POSITION) ? (int64_t)chunk.position_base : 0);
+            int64_t vt = c.vt + ((c.flags & REL_UV) ? (int64_t)chunk.texcoord_base : 0);
+            int64_t vn = c.vn + ((c.flags & REL_NORMAL) ? (int64_t)chunk.normal_base : 0);
+
+            if (v < 0 || v >= (int64_t)position_count)
+            {
+                v = 0;
+                bad_index = true;
+            }
+
+            if ((c.flags & HAS_UV) && (vt < 0 || vt >= (int64_t)texcoord_count))
+            {
+                c.flags &= ~HAS_UV;
+                bad_index = true;
+            }
+
+            if ((c.flags & HAS_NORMAL) && (vn < 0 || vn >= (int64_t)normal_count))
+            {
+                c.flags &= ~HAS_NORMAL;
+                bad_index = true;
+            }
+
+            c.v = (int32_t)v;
+            c.vt = (c.flags & HAS_UV) ? (int32_t)vt : -1;
+            c.vn = (c.flags & HAS_NORMAL) ? (int32_t)vn : -1;
+        }
+    }
+
+    // open addressing table from a v/vt/vn triple to an output vertex
+    struct WeldSlot
+    {
+        uint32_t v, vt, vn;
+        uint32_t index;
+    };
+
+    struct WeldTable
+    {
+        std::vector<WeldSlot> slots;
+        size_t mask = 0;
+        size_t count = 0;
+    };
+
+    static inline size_t WeldHash(uint32_t v, uint32_t vt, uint32_t vn)
+    {
+        uint64_t h = v * 0x9E3779B97F4A7C15ull;
+        h ^= (vt + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        h ^= (vn + 0x165667B19E3779F9ull) * 0x85EBCA77C2B2AE63ull;
+        return (size_t)(h ^ (h >> 29));
+    }
+
+    static inline void WeldReserve(WeldTable& table, size_t capacity)
+    {
+        size_t size = 16;
+        while (size < capacity * 2) size <<= 1;
+
+        std::vector<WeldSlot> old;
+        old.swap(table.slots);
+
+        table.slots.assign(size, WeldSlot{0, 0, 0, NONE});
+        table.mask = size - 1;
+
+        for (const WeldSlot& slot : old)
+        {
+            if (slot.index == NONE) continue;
+            size_t i = WeldHash(slot.v, slot.vt, slot.vn) & table.mask;
+            while (table.slots[i].index != NONE) i = (i + 1) & table.mask;
+            table.slots[i] = slot;
+        }
+    }
+
+    // returns the existing vertex or inserts next_index
+    static inline uint32_t WeldInsert(WeldTable& table, uint32_t v, uint32_t vt, uint32_t vn, uint32_t next_index)
+    {
+        if ((table.count + 1) * 2 > table.slots.size()) WeldReserve(table, table.slots.size());
+
+        size_t i = WeldHash(v, vt, vn) & table.mask;
+        while (table.slots[i].index != NONE)
+        {
+            const WeldSlot& slot = table.slots[i];
+            if (slot.v == v && slot.vt == vt && slot.vn == vn) return slot.index;
+            i = (i + 1) & table.mask;
+        }
+
+        table.slots[i] = WeldSlot{v, vt, vn, next_index};
+        ++table.count;
+        return next_index;
+    }
+
+    static inline std::string MapName(const char* data, size_t length)
+    {
+        // map options such as "-bm 0.5 file.png" come before the file name
+        const char* last = data;
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (IsSpace(data[i])) last = data + i + 1;
+        }
+        return std::string(last, data + length - last);
+    }
+}
+
+// appends every material in a .mtl file, a missing library is reported but not fatal
+static inline void Obj_LoadMaterials(std::vector<ObjMaterial>& materials, const char* file)
+{
+    using namespace obj_detail;
+
+    MappedFile mtl;
+    try
+    {
+        mtl = File_Map(file);
+    }
+    catch (const std::ios_base::failure&)
+    {
+        std::cout << "Failed to load material library: " << file << std::endl;
+        return;
+    }
+
+    const char* p = mtl.data;
+    const char* end = mtl.data + mtl.size;
+    ObjMaterial* current = nullptr;
+
+    while (p < end)
+    {
+        p = SkipSpace(p, end);
+        if (p >= end) break;
+
+        const char* name;
+        size_t length;
+
+        if (StartsWith(p, end, "newmtl", 6))
+        {
+            ParseName(p + 6, end, name, length);
+            materials.emplace_back();
+            current = &materials.back();
+            current->name.assign(name, length);
+        }
+        else if (current)
+        {
+            const char* q = p;
+            while (q < end && !IsSpace(*q) && *q != '\n') ++q;
+            size_t word = q - p;
+
+            if (word == 2 && p[0] == 'K')
+            {
+                Vector3 value;
+                value.x = ParseFloat(q, end);
+                value.y = ParseFloat(q, end);
+                value.z = ParseFloat(q, end);
+
+                if (p[1] == 'a') current->ambient = value;
+                else if (p[1] == 'd') current->diffuse = value;
+                else if (p[1] == 's') current->specular = value;
+                else if (p[1] == 'e') current->emissive = value;
+            }
+            else if (word == 2 && p[0] == 'N' && p[1] == 's') current->shininess = ParseFloat(q, end);
+            else if (word == 1 && p[0] == 'd') current->opacity = ParseFloat(q, end);
+            else if (word == 2 && p[0] == 'T' && p[1] == 'r') current->opacity = 1.0f - ParseFloat(q, end);
+            else if (word == 5 && memcmp(p, "illum", 5) == 0) current->illum = (int)ParseFloat(q, end);
+            else if (word == 6 && memcmp(p, "map_Kd", 6) == 0)
+            {
+                ParseName(q, end, name, length);
+                current->diffuse_map = MapName(name, length);
+            }
+            else if (word == 6 && memcmp(p, "map_Ks", 6) == 0)
+            {
+                ParseName(q, end, name, length);
+                current->specular_map = MapName(name, length);
+            }
+            else if ((word == 8 && memcmp(p, "map_Bump", 8) == 0) ||
+                     (word == 8 && memcmp(p, "map_bump", 8) == 0) ||
+                     (word == 4 && memcmp(p, "bump", 4) == 0) ||
+                     (word == 4 && memcmp(p, "norm", 4) == 0))
+            {
+                ParseName(q, end, name, length);
+                current->normal_map = MapName(name, length);
+            }
+        }
+
+        p = NextLine(p, end);
+    }
+
+    File_Unmap(mtl);
+}
+
+// loads an .obj into the mesh (call Mesh_Generate afterwards) and fills the model
+// with its materials and per material index ranges
+static inline void Obj_Load(Mesh& mesh, ObjModel& model, const char* file)
+{
+    using namespace obj_detail;
+
+    MappedFile obj = File_Map(file);
+
+    // cut the file at line boundaries
+    size_t chunk_count = obj.size / CHUNK_SIZE;
+    if (chunk_count > Thread_Count()) chunk_count = Thread_Count();
+    if (chunk_count < 1) chunk_count = 1;
+
+    std::vector<Chunk> chunks(chunk_count);
+    const char* end = obj.data + obj.size;
+    const char* cursor = obj.data;
+
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        chunks[i].begin = cursor;
+        if (i + 1 == chunk_count) cursor = end;
+        else
+        {
+            const char* split = obj.data + obj.size / chunk_count * (i + 1);
+            cursor = split > cursor ? NextLine(split, end) : cursor;
+        }
+        chunks[i].end = cursor;
+    }
+
+    Thread_ParallelFor(chunk_count, 1, [&chunks](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i) ParseChunk(chunks[i]);
+    });
+
+    // global element numbering is the running total over the chunks before
+    size_t position_count = 0, texcoord_count = 0, normal_count = 0, corner_count = 0;
+    for (Chunk& chunk : chunks)
+    {
+        chunk.position_base = position_count;
+        chunk.texcoord_base = texcoord_count;
+        chunk.normal_base = normal_count;
+        chunk.corner_base = corner_count;
+
+        position_count += chunk.positions.size() / 3;
+        texcoord_count += chunk.texcoords.size() / 2;
+        normal_count += chunk.normals.size() / 3;
+        corner_count += chunk.corners.size();
+    }
+
+    // faces with no positions to index would read from an empty array, drop them
+    if (position_count == 0 && corner_count > 0)
+    {
+        std::cout << "OBJ file has faces but no positions: " << file << std::endl;
+        for (Chunk& chunk : chunks)
+        {
+            chunk.corners.clear();
+            chunk.materials.clear();
+            chunk.corner_base = 0;
+        }
+        corner_count = 0;
+    }
+
+    if (corner_count > 0xFFFFFFFFull || position_count > 0x7FFFFFFFull)
+    {
+        std::cout << "OBJ file too large for 32 bit indices: " << file << std::endl;
+        File_Unmap(obj);
+        return;
+    }
+
+    std::vector<float> positions(position_count * 3);
+    std::vector<float> texcoords(texcoord_count * 2);
+    std::vector<float> normals(normal_count * 3);
+    std::vector<char> bad_index(chunk_count, 0);
+
+    Thread_ParallelFor(chunk_count, 1, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            Chunk& chunk = chunks[i];
+            if (!chunk.positions.empty()) memcpy(&positions[chunk.position_base * 3], chunk.positions.data(), chunk.positions.size() * sizeof(float));
+            if (!chunk.texcoords.empty()) memcpy(&texcoords[chunk.texcoord_base * 2], chunk.texcoords.data(), chunk.texcoords.size() * sizeof(float));
+            if (!chunk.normals.empty()) memcpy(&normals[chunk.normal_base * 3], chunk.normals.data(), chunk.normals.size() * sizeof(float));
+
+            bool bad = false;
+            ResolveChunk(chunk, position_count, texcoord_count, normal_count, bad);
+            bad_index[i] = bad;
+
+            std::vector<float>().swap(chunk.positions);
+            std::vector<float>().swap(chunk.texcoords);
+            std::vector<float>().swap(chunk.normals);
+        }
+    });
+
+    for (char bad : bad_index)
+    {
+        if (bad)
+        {
+            std::cout << "OBJ file has out of range face indices: " << file << std::endl;
+            break;
+        }
+    }
+
+    unsigned int layout = MESH_ATTRIB_POSITION;
+    if (normal_count > 0) layout |= MESH_ATTRIB_NORMAL;
+    if (texcoord_count > 0) layout |= MESH_ATTRIB_UV;
+    int stride = Mesh_VertexStride(layout);
+
+    // weld identical corners into shared vertices
+    WeldTable table;
+    WeldReserve(table, position_count > 0 ? position_count : 1);
+
+    mesh.vertices.clear();
+    mesh.vertices.reserve(position_count * stride);
+    mesh.indices.resize(corner_count);
+
+    uint32_t vertex_count = 0;
+    for (const Chunk& chunk : chunks)
+    {
+        unsigned int* out = mesh.indices.data() + chunk.corner_base;
+
+        for (const Corner& c : chunk.corners)
+        {
+            uint32_t index = WeldInsert(table, (uint32_t)c.v, (uint32_t)c.vt, (uint32_t)c.vn, vertex_count);
+            *out++ = index;
+
+            if (index != vertex_count) continue;
+            ++vertex_count;
+
+            size_t at = mesh.vertices.size();
+            mesh.vertices.resize(at + stride);
+            float* v = &mesh.vertices[at];
+
+            memcpy(v, &positions[(size_t)c.v * 3], 3 * sizeof(float));
+            v += 3;
+
+            if (layout & MESH_ATTRIB_NORMAL)
+            {
+                if (c.vn >= 0) memcpy(v, &normals[(size_t)c.vn * 3], 3 * sizeof(float));
+                else v[0] = v[1] = v[2] = 0.0f;
+                v += 3;
+            }
+
+            if (layout & MESH_ATTRIB_UV)
+            {
+                if (c.vt >= 0) memcpy(v, &texcoords[(size_t)c.vt * 2], 2 * sizeof(float));
+                else v[0] = v[1] = 0.0f;
+            }
+        }
+    }
+
+    // material libraries are relative to the .obj; the whole line is one file name when that file
+    // exists (names may contain spaces), otherwise it is a whitespace separated list
+    model.materials.clear();
+    model.groups.clear();
+
+    std::string directory = File_Directory(file);
+    for (const Chunk& chunk : chunks)
+    {
+        for (const UseMaterial& lib : chunk.libraries)
+        {
+            std::string whole = directory + std::string(lib.name, lib.length);
+            if (File_Exists(whole.c_str()))
+            {
+                Obj_LoadMaterials(model.materials, whole.c_str());
+                continue;
+            }
+
+            const char* p = lib.name;
+            const char* stop = lib.name + lib.length;
+            while (p < stop)
+            {
+                p = SkipSpace(p, stop);
+                const char* name = p;
+                while (p < stop && !IsSpace(*p)) ++p;
+                if (p == name) break;
+
+                std::string path = directory + std::string(name, p - name);
+                Obj_LoadMaterials(model.materials, path.c_str());
+            }
+        }
+    }
+
+    std::unordered_map<std::string, int> material_ids;
+    for (size_t i = 0; i < model.materials.size(); ++i) material_ids.emplace(model.materials[i].name, (int)i);
+
+    // usemtl switches become index ranges in file order
+    ObjGroup group = {-1, 0, 0};
+    for (const Chunk& chunk : chunks)
+    {
+        for (const UseMaterial& use : chunk.materials)
+        {
+            unsigned int at = (unsigned int)(chunk.corner_base + use.corner);
+            group.index_count = at - group.first_index;
+            if (group.index_count > 0) model.groups.push_back(group);
+
+            auto found = material_ids.find(std::string(use.name, use.length));
+            group.material = found != material_ids.end() ? found->second : -1;
+            group.first_index = at;
+        }
+    }
+    group.index_count = (unsigned int)corner_count - group.first_index;
+    if (group.index_count > 0) model.groups.push_back(group);
+
+    File_Unmap(obj);
+
+    mesh.use_indices = true;
+    mesh.layout = layout;
+
+    mesh.VAO = 0;
+    mesh.VBO = 0;
+    mesh.EBO = 0;
+
+    mesh.initialized = 0;
+}
+
+static inline void Obj_Load(Mesh& mesh, const char* file)
+{
+    ObjModel model;
+    Obj_Load(mesh, model, file);
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef PARSE_UTILITY_H
+#define PARSE_UTILITY_H
+
+#include <stdint.h>
+
+// helpers shared by the text asset parsers, they work on [p, end) spans
+// of a mapped file and never allocate
+
+namespace parse_detail
+{
+    static constexpr double POW10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+}
+
+static inline bool Parse_IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// decimal number with optional sign, fraction and exponent, 0 if there is no number
+// p is left on the first character after the number
+static inline double Parse_Number(const char*& p, const char* end)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // 19 significant digits always fit in 64 bits, the rest only shift the exponent
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    while (p < end && Parse_IsDigit(*p))
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa) ++digits;
+        }
+        else ++exponent;
+        ++p;
+    }
+
+    if (p < end && *p == '.')
+    {
+        ++p;
+        while (p < end && Parse_IsDigit(*p))
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa) ++digits;
+                --exponent;
+            }
+            ++p;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool exp_negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            exp_negative = *p == '-';
+            ++p;
+        }
+
+        int e = 0;
+        while (p < end && Parse_IsDigit(*p))
+        {
+            if (e < 10000) e = e * 10 + (*p - '0');
+            ++p;
+        }
+        exponent += exp_negative ? -e : e;
+    }
+
+    double value = (double)mantissa;
+    if (value != 0.0)
+    {
+        while (exponent > 22) { value *= 1e22; exponent -= 22; }
+        while (exponent < -22) { value /= 1e22; exponent += 22; }
+        value = exponent < 0 ? value / parse_detail::POW10[-exponent] : value * parse_detail::POW10[exponent];
+    }
+
+    return negative ? -value : value;
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef SHADER_BATCH_UTILITY_H
+#define SHADER_BATCH_UTILITY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "glext_utility.h"
+#include "shader_utility.h"
+
+/*
+    Batched, non-blocking shader compilation
+
+    Shader_Init asks for the compile and link status straight away, which
+    makes the driver finish each program before the next one starts. A
+    ShaderBatch queues everything first: ShaderBatch_Add hands the sources
+    to the driver and returns without asking anything back, and the target
+    Shader uses the fallback program until its own is ready.
+
+    ShaderBatch_Poll runs once per frame. With GL_KHR_parallel_shader_compile
+    the driver compiles on its own threads and Poll only looks at
+    GL_COMPLETION_STATUS_KHR, which never waits; finished programs are
+    checked, cached (see Shader_SetCacheDirectory) and swapped in. Without
+    the extension a status query can stall, so Poll finishes at most
+    sync_per_poll programs per call to spread the cost over frames.
+
+    A program that fails to build reports its log and the target keeps the
+    fallback. Do not Shader_Delete a target while it is still pending, it
+    holds the fallback's program.
+*/
+
+struct ShaderBatchEntry
+{
+    Shader* target = nullptr;
+    unsigned int program = 0;
+    unsigned int vertex_shader = 0;
+    unsigned int fragment_shader = 0;
+    bool cached = false;
+    uint64_t key = 0;
+};
+
+struct ShaderBatch
+{
+    unsigned int fallback = 0;
+    unsigned int sync_per_poll = 4;
+    std::vector<ShaderBatchEntry> pending;
+};
+
+// fallback is drawn with until each program is ready, it can be a plain colour shader built with Shader_Init
+static inline void ShaderBatch_Init(ShaderBatch& batch, const Shader* fallback)
+{
+    batch.fallback = fallback ? fallback->program : 0;
+    batch.pending.clear();
+
+    // let the driver use as many compiler threads as it likes
+    if (GLExt_Caps().parallel_shader_compile) glext::MaxShaderCompilerThreads(0xFFFFFFFFu);
+}
+
+// queues a program, target draws with the fallback until ShaderBatch_Poll swaps the real one in
+static inline void ShaderBatch_Add(ShaderBatch& batch, Shader& target, const std::string& vs_source,
+                                   const std::string& fs_source, const char* defines = nullptr)
+{
+    using namespace shader_detail;
+
+    std::string vs = InjectDefines(vs_source, defines);
+    std::string fs = InjectDefines(fs_source, defines);
+
+    ShaderBatchEntry entry;
+    entry.target = &target;
+    entry.cached = !cache_directory.empty() && GLExt_Caps().program_binary;
+    entry.key = entry.cached ? BinaryKey(vs, fs) : 0;
+
+    // a cached binary is as quick as it gets, no point queueing it
+    if (entry.cached)
+    {
+        unsigned int program = LoadBinary(entry.key);
+        if (program)
+        {
+            target.program = program;
+            return;
+        }
+    }
+
+    entry.vertex_shader = StartCompile(GL_VERTEX_SHADER, vs.c_str());
+    entry.fragment_shader = StartCompile(GL_FRAGMENT_SHADER, fs.c_str());
+    entry.program = StartLink(entry.vertex_shader, entry.fragment_shader, entry.cached);
+
+    target.program = batch.fallback;
+    batch.pending.push_back(entry);
+}
+
+static inline void ShaderBatch_AddFiles(ShaderBatch& batch, Shader& target, const char* vs_file,
+                                        const char* fs_file, const char* defines = nullptr)
+{
+    ShaderBatch_Add(batch, target, Shader_LoadSource(vs_file), Shader_LoadSource(fs_file), defines);
+}
+
+// swaps in the programs that are done, returns how many are still pending
+static inline size_t ShaderBatch_Poll(ShaderBatch& batch)
+{
+    bool parallel = GLExt_Caps().parallel_shader_compile;
+    unsigned int budget = batch.sync_per_poll > 0 ? batch.sync_per_poll : 1;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < batch.pending.size(); ++i)
+    {
+        ShaderBatchEntry& entry = batch.pending[i];
+
+        bool done;
+        if (parallel)
+        {
+            int complete = 0;
+            glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &complete);
+            done = complete != 0;
+        }
+        else done = budget > 0 && budget--;
+
+        if (!done)
+        {
+            batch.pending[kept++] = entry;
+            continue;
+        }
+
+        if (shader_detail::FinishLink(entry.program, entry.vertex_shader, entry.fragment_shader, entry.cached, entry.key))
+        {
+            entry.target->program = entry.program;
+        }
+        else glDeleteProgram(entry.program);
+    }
+    batch.pending.resize(kept);
+
+    return kept;
+}
+
+// blocks until every queued program is built, for loading screens and tools
+static inline void ShaderBatch_Wait(ShaderBatch& batch)
+{
+    for (ShaderBatchEntry& entry : batch.pending)
+    {
+        if (shader_detail::FinishLink(entry.program, entry.vertex_shader, entry.fragment_shader, entry.cached, entry.key))
+        {
+            entry.target->program = entry.program;
+        }
+        else glDeleteProgram(entry.program);
+    }
+    batch.pending.clear();
+}
+
+// drops whatever is still pending, those targets are left with program 0
+static inline void ShaderBatch_Delete(ShaderBatch& batch)
+{
+    for (ShaderBatchEntry& entry : batch.pending)
+    {
+        glDeleteShader(entry.vertex_shader);
+        glDeleteShader(entry.fragment_shader);
+        glDeleteProgram(entry.program);
+        entry.target->program = 0;
+    }
+    batch.pending.clear();
+}
+
+#endif
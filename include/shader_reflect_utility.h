@@ -0,0 +1,401 @@
+#ifndef SHADER_REFLECT_UTILITY_H
+#define SHADER_REFLECT_UTILITY_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <glad/glad.h>
+#include "glext_utility.h"
+#include "math_utility.h"
+#include "shader_utility.h"
+
+/*
+    Block layout reflection and checking
+
+    A C++ struct uploaded into a uniform or storage block has to put every
+    member exactly where the GLSL layout rules do, and nothing complains
+    when it does not: the shader just reads the wrong bytes. Two checks:
+
+    At compile time LAYOUT_CHECK_STD140 / LAYOUT_CHECK_STD430 walk the
+    struct's members in declaration order, place each one by the rules
+    and static_assert that offsetof agrees, then that sizeof matches the
+    rounded struct size (which is the array stride in GLSL).
+
+        LAYOUT_CHECK_STD140(MaterialParams, LAYOUT_FIELD(MaterialParams, colour),
+                                            LAYOUT_FIELD(MaterialParams, params));
+
+    Only types with a GLSL twin are accepted: float, int32_t, uint32_t,
+    Vector2/3/4, Matrix4 and fixed arrays of those. Matrix3 (9 packed
+    floats, GLSL pads each column to a vec4) and bool do not compile.
+
+    At runtime ShaderReflect_Blocks asks the linked program where the
+    driver actually put everything (offsets, array and matrix strides,
+    block sizes) and ShaderReflect_Validate compares that with a list of
+    LAYOUT_MEMBERs, which catches a GLSL side that drifted from the C++
+    side and blocks declared shared or packed. Storage blocks are only
+    reflected when program interface queries are available (4.3).
+*/
+
+enum BlockLayoutRule { BLOCK_LAYOUT_STD140, BLOCK_LAYOUT_STD430 };
+
+namespace layout_detail
+{
+    // base alignment and size of the GLSL twin, left undefined for types that have none
+    template<typename T> struct Type;
+    template<> struct Type<float> { static constexpr size_t align = 4, size = 4; };
+    template<> struct Type<int32_t> { static constexpr size_t align = 4, size = 4; };
+    template<> struct Type<uint32_t> { static constexpr size_t align = 4, size = 4; };
+    template<> struct Type<Vector2> { static constexpr size_t align = 8, size = 8; };
+    template<> struct Type<Vector3> { static constexpr size_t align = 16, size = 12; };
+    template<> struct Type<Vector4> { static constexpr size_t align = 16, size = 16; };
+    template<> struct Type<Matrix4> { static constexpr size_t align = 16, size = 64; };
+
+    static constexpr size_t RoundUp(size_t value, size_t align) { return (value + align - 1) / align * align; }
+
+    template<BlockLayoutRule rule, typename T> struct Rule
+    {
+        static constexpr size_t align = Type<T>::align;
+        static constexpr size_t size = Type<T>::size;
+    };
+
+    // std140 rounds array elements up to a vec4, std430 only to the element's own alignment
+    template<BlockLayoutRule rule, typename T, size_t N> struct Rule<rule, T[N]>
+    {
+        static constexpr size_t align = rule == BLOCK_LAYOUT_STD140 ? RoundUp(Rule<rule, T>::align, 16) : Rule<rule, T>::align;
+        static constexpr size_t stride = RoundUp(Rule<rule, T>::size, align);
+        static constexpr size_t size = stride * N;
+    };
+
+    template<typename T> struct Field { size_t offset; };
+
+    template<BlockLayoutRule rule, typename... T>
+    constexpr bool Matches(size_t struct_size, Field<T>... fields)
+    {
+        size_t offset = 0;
+        size_t align = rule == BLOCK_LAYOUT_STD140 ? 16 : 4;
+        bool ok = true;
+        ((offset = RoundUp(offset, Rule<rule, T>::align),
+          ok = ok && fields.offset == offset,
+          offset += Rule<rule, T>::size,
+          align = align > Rule<rule, T>::align ? align : Rule<rule, T>::align), ...);
+        return ok && struct_size == RoundUp(offset, align);
+    }
+}
+
+#define LAYOUT_FIELD(type, member) layout_detail::Field<decltype(type::member)>{offsetof(type, member)}
+#define LAYOUT_CHECK_STD140(type, ...) \
+    static_assert(layout_detail::Matches<BLOCK_LAYOUT_STD140>(sizeof(type), __VA_ARGS__), #type " does not follow std140")
+#define LAYOUT_CHECK_STD430(type, ...) \
+    static_assert(layout_detail::Matches<BLOCK_LAYOUT_STD430>(sizeof(type), __VA_ARGS__), #type " does not follow std430")
+
+// one member of a C++ struct, as ShaderReflect_Validate sees it
+struct ShaderLayoutMember
+{
+    const char* name;       // GLSL member name, LAYOUT_MEMBER assumes it matches the C++ one
+    size_t offset;
+    size_t size;            // of one element for arrays
+    size_t count;           // 1 unless an array
+};
+
+#define LAYOUT_MEMBER(type, member) ShaderLayoutMember{#member, offsetof(type, member), \
+    sizeof(std::remove_all_extents_t<decltype(type::member)>), \
+    sizeof(decltype(type::member)) / sizeof(std::remove_all_extents_t<decltype(type::member)>)}
+
+struct ShaderBlockMember
+{
+    std::string name;           // as the driver reports it, arrays end in [0]
+    GLenum type = 0;
+    int offset = 0;
+    int array_size = 1;         // 0 for an unsized storage array
+    int array_stride = 0;       // 0 unless an array
+    int matrix_stride = 0;      // 0 unless a matrix
+    int top_level_stride = 0;   // storage blocks only, stride of the outermost array holding the member
+};
+
+struct ShaderBlock
+{
+    std::string name;
+    bool storage = false;
+    int binding = 0;
+    int size = 0;               // minimum buffer size in bytes
+    std::vector<ShaderBlockMember> members;     // by offset
+};
+
+namespace shader_reflect_detail
+{
+    // bytes of one element as the block stores it, 0 for types that never appear in a CPU struct
+    static inline int TypeSize(GLenum type, int matrix_stride)
+    {
+        switch (type)
+        {
+        case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL: return 4;
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: return 8;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: return 12;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: return 16;
+        case GL_FLOAT_MAT2: return 2 * matrix_stride;
+        case GL_FLOAT_MAT3: return 3 * matrix_stride;
+        case GL_FLOAT_MAT4: return 4 * matrix_stride;
+        default: return 0;
+        }
+    }
+
+    static inline const ShaderBlockMember* FindMember(const ShaderBlock& block, const std::string& name)
+    {
+        for (const ShaderBlockMember& member : block.members)
+        {
+            if (member.name == name || member.name == name + "[0]") return &member;
+        }
+        return nullptr;
+    }
+
+    static inline void SortMembers(ShaderBlock& block)
+    {
+        std::sort(block.members.begin(), block.members.end(), [](const ShaderBlockMember& a, const ShaderBlockMember& b)
+        {
+            return a.offset < b.offset;
+        });
+    }
+
+    static inline void UniformBlocks(unsigned int program, std::vector<ShaderBlock>& blocks)
+    {
+        GLint count = 0, name_length = 0, uniform_length = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &name_length);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_length);
+
+        std::vector<char> name(std::max(name_length, uniform_length) + 1);
+        for (GLint b = 0; b < count; ++b)
+        {
+            ShaderBlock block;
+            glGetActiveUniformBlockName(program, (GLuint)b, (GLsizei)name.size(), NULL, name.data());
+            block.name = name.data();
+            glGetActiveUniformBlockiv(program, (GLuint)b, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+            glGetActiveUniformBlockiv(program, (GLuint)b, GL_UNIFORM_BLOCK_DATA_SIZE, &block.size);
+
+            GLint active = 0;
+            glGetActiveUniformBlockiv(program, (GLuint)b, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &active);
+            if (active > 0)
+            {
+                std::vector<GLint> indices(active);
+                glGetActiveUniformBlockiv(program, (GLuint)b, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+                std::vector<GLuint> uniforms(indices.begin(), indices.end());
+
+                std::vector<GLint> type(active), size(active), offset(active), array_stride(active), matrix_stride(active);
+                glGetActiveUniformsiv(program, active, uniforms.data(), GL_UNIFORM_TYPE, type.data());
+                glGetActiveUniformsiv(program, active, uniforms.data(), GL_UNIFORM_SIZE, size.data());
+                glGetActiveUniformsiv(program, active, uniforms.data(), GL_UNIFORM_OFFSET, offset.data());
+                glGetActiveUniformsiv(program, active, uniforms.data(), GL_UNIFORM_ARRAY_STRIDE, array_stride.data());
+                glGetActiveUniformsiv(program, active, uniforms.data(), GL_UNIFORM_MATRIX_STRIDE, matrix_stride.data());
+
+                for (GLint u = 0; u < active; ++u)
+                {
+                    ShaderBlockMember member;
+                    glGetActiveUniformName(program, uniforms[u], (GLsizei)name.size(), NULL, name.data());
+                    member.name = name.data();
+                    member.type = (GLenum)type[u];
+                    member.array_size = size[u];
+                    member.offset = offset[u];
+                    member.array_stride = array_stride[u];
+                    member.matrix_stride = matrix_stride[u];
+                    block.members.push_back(member);
+                }
+            }
+
+            SortMembers(block);
+            blocks.push_back(block);
+        }
+    }
+
+    static inline void StorageBlocks(unsigned int program, std::vector<ShaderBlock>& blocks)
+    {
+        GLint count = 0;
+        glext::GetProgramInterfaceiv(program, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &count);
+
+        for (GLint b = 0; b < count; ++b)
+        {
+            const GLenum block_props[] = {GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES};
+            GLint values[4] = {};
+            glext::GetProgramResourceiv(program, GL_SHADER_STORAGE_BLOCK, (GLuint)b, 4, block_props, 4, NULL, values);
+
+            ShaderBlock block;
+            block.storage = true;
+            std::vector<char> name(values[0] + 1);
+            glext::GetProgramResourceName(program, GL_SHADER_STORAGE_BLOCK, (GLuint)b, (GLsizei)name.size(), NULL, name.data());
+            block.name = name.data();
+            block.binding = values[1];
+            block.size = values[2];
+
+            GLint active = values[3];
+            if (active > 0)
+            {
+                const GLenum list_prop = GL_ACTIVE_VARIABLES;
+                std::vector<GLint> variables(active);
+                glext::GetProgramResourceiv(program, GL_SHADER_STORAGE_BLOCK, (GLuint)b, 1, &list_prop, active, NULL, variables.data());
+
+                for (GLint variable : variables)
+                {
+                    const GLenum props[] = {GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_OFFSET, GL_ARRAY_STRIDE,
+                                            GL_MATRIX_STRIDE, GL_TOP_LEVEL_ARRAY_STRIDE};
+                    GLint v[7] = {};
+                    glext::GetProgramResourceiv(program, GL_BUFFER_VARIABLE, (GLuint)variable, 7, props, 7, NULL, v);
+
+                    ShaderBlockMember member;
+                    std::vector<char> member_name(v[0] + 1);
+                    glext::GetProgramResourceName(program, GL_BUFFER_VARIABLE, (GLuint)variable, (GLsizei)member_name.size(),
+                                                  NULL, member_name.data());
+                    member.name = member_name.data();
+                    member.type = (GLenum)v[1];
+                    member.array_size = v[2];
+                    member.offset = v[3];
+                    member.array_stride = v[4];
+                    member.matrix_stride = v[5];
+                    member.top_level_stride = v[6];
+                    block.members.push_back(member);
+                }
+            }
+
+            SortMembers(block);
+            blocks.push_back(block);
+        }
+    }
+}
+
+// every uniform block of a linked program, storage blocks too where GL can tell us about them
+static inline std::vector<ShaderBlock> ShaderReflect_Blocks(const Shader& shader)
+{
+    std::vector<ShaderBlock> blocks;
+    if (!shader.program) return blocks;
+
+    shader_reflect_detail::UniformBlocks(shader.program, blocks);
+    if (GLExt_Caps().program_interface_query) shader_reflect_detail::StorageBlocks(shader.program, blocks);
+    return blocks;
+}
+
+// null if the program has no active block by that name
+static inline const ShaderBlock* ShaderReflect_Find(const std::vector<ShaderBlock>& blocks, const char* name)
+{
+    for (const ShaderBlock& block : blocks)
+    {
+        if (block.name == name) return &block;
+    }
+    return nullptr;
+}
+
+// compares a CPU struct with a reflected block, prints each difference and returns how many there were
+// element names the block's array of that struct ("uMaterials"), members are then looked up in element 0
+// and struct_size is checked against the array stride; leave it null when the members sit in the block itself
+static inline int ShaderReflect_Validate(const ShaderBlock& block, const std::vector<ShaderLayoutMember>& members,
+                                         size_t struct_size, const char* element = nullptr)
+{
+    using namespace shader_reflect_detail;
+
+    std::string prefix = element ? std::string(element) + "[0]." : "";
+    int mismatches = 0;
+    auto report = [&](const std::string& what)
+    {
+        std::cout << "Block " << block.name << ": " << what << std::endl;
+        mismatches++;
+    };
+
+    // the struct starts where its first member does, wherever the array sits in the block
+    int base = -1;
+    for (const ShaderBlockMember& reflected : block.members)
+    {
+        if (reflected.name.compare(0, prefix.size(), prefix) != 0) continue;
+        if (base == -1 || reflected.offset < base) base = reflected.offset;
+    }
+    if (base == -1)
+    {
+        report("no members" + (element ? " under " + std::string(element) : std::string()));
+        return mismatches;
+    }
+
+    for (const ShaderLayoutMember& member : members)
+    {
+        const ShaderBlockMember* reflected = FindMember(block, prefix + member.name);
+        if (!reflected)
+        {
+            report(std::string(member.name) + " is not in the block");
+            continue;
+        }
+
+        std::string name = member.name;
+        if ((size_t)(reflected->offset - base) != member.offset)
+        {
+            report(name + " is at " + std::to_string(reflected->offset - base) + ", C++ puts it at " + std::to_string(member.offset));
+        }
+
+        int size = TypeSize(reflected->type, reflected->matrix_stride);
+        if (size && (size_t)size != member.size)
+        {
+            report(name + " takes " + std::to_string(size) + " bytes, C++ gives it " + std::to_string(member.size));
+        }
+
+        bool array = member.count > 1 || reflected->array_size != 1;
+        if (array && (size_t)reflected->array_stride != member.size)
+        {
+            report(name + " has an array stride of " + std::to_string(reflected->array_stride) + ", C++ uses " +
+                   std::to_string(member.size));
+        }
+        if (array && reflected->array_size != 0 && (size_t)reflected->array_size != member.count)
+        {
+            report(name + " has " + std::to_string(reflected->array_size) + " elements, C++ has " + std::to_string(member.count));
+        }
+    }
+
+    // GLSL members the struct has no room for
+    for (const ShaderBlockMember& reflected : block.members)
+    {
+        if (reflected.name.compare(0, prefix.size(), prefix) != 0) continue;
+
+        std::string name = reflected.name.substr(prefix.size());
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) name.resize(name.size() - 3);
+
+        bool known = false;
+        for (const ShaderLayoutMember& member : members) known = known || name == member.name;
+        if (!known) report(name + " has no C++ member");
+    }
+
+    if (element && !members.empty())
+    {
+        // uniform blocks list every element, storage blocks report the stride directly
+        const ShaderBlockMember* first = FindMember(block, prefix + members[0].name);
+        const ShaderBlockMember* second = FindMember(block, std::string(element) + "[1]." + members[0].name);
+        int stride = second ? second->offset - first->offset : first ? first->top_level_stride : 0;
+        if (stride && (size_t)stride != struct_size)
+        {
+            report(std::string(element) + " elements are " + std::to_string(stride) + " bytes apart, C++ struct is " +
+                   std::to_string(struct_size));
+        }
+    }
+    else if (!element && (size_t)block.size < struct_size)
+    {
+        report("is " + std::to_string(block.size) + " bytes, smaller than the C++ struct's " + std::to_string(struct_size));
+    }
+
+    return mismatches;
+}
+
+// prints the reflected layout, for comparing against a struct by eye
+static inline void ShaderReflect_Print(const std::vector<ShaderBlock>& blocks)
+{
+    for (const ShaderBlock& block : blocks)
+    {
+        std::cout << (block.storage ? "buffer " : "uniform ") << block.name << ", binding " << block.binding << ", "
+                  << block.size << " bytes" << std::endl;
+        for (const ShaderBlockMember& member : block.members)
+        {
+            std::cout << "  " << member.offset << "\t" << member.name;
+            if (member.array_size != 1) std::cout << " [" << member.array_size << "] stride " << member.array_stride;
+            if (member.matrix_stride) std::cout << " matrix stride " << member.matrix_stride;
+            if (member.top_level_stride) std::cout << " top level stride " << member.top_level_stride;
+            std::cout << std::endl;
+        }
+    }
+}
+
+#endif
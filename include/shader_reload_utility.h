@@ -0,0 +1,362 @@
+#ifndef SHADER_RELOAD_UTILITY_H
+#define SHADER_RELOAD_UTILITY_H
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <glad/glad.h>
+#include "shader_utility.h"
+
+/*
+    Shader hot reload
+
+    ShaderReload_Watch remembers how a Shader was built (files and defines)
+    and watches every file that went into it, includes too. A background
+    thread blocks on inotify and notes which files were written; directories
+    are watched rather than files, so editors that save by renaming a new
+    file over the old one are caught as well.
+
+    ShaderReload_Poll runs on the render thread once per frame. Shaders
+    whose files changed are rebuilt from source; if the new program links,
+    the uniform values of the old one are copied across and Shader::program
+    is swapped in one assignment before the old program is deleted. Uniform
+    names stay the handles (Shader_SetUniform* looks them up by name), so
+    nothing that uses the shader notices. If the build fails the old
+    program stays and the log is printed; the next save tries again.
+*/
+
+struct ShaderWatch
+{
+    Shader* shader = nullptr;
+    std::string vs_file;
+    std::string fs_file;
+    std::string defines;
+    std::vector<std::string> files;     // canonical paths of everything that went in
+};
+
+struct ShaderReloader
+{
+    int inotify = -1;
+    int wake[2] = {-1, -1};             // written to stop the watcher
+    std::thread watcher;
+
+    std::mutex mutex;
+    std::unordered_map<int, std::string> directories;   // watch descriptor -> canonical directory
+    std::unordered_set<std::string> changed;            // canonical paths written since the last Poll
+
+    std::vector<ShaderWatch> watches;   // render thread only
+};
+
+namespace shader_reload_detail
+{
+    static inline void WatchDirectory(ShaderReloader& reloader, const std::string& file)
+    {
+        std::string directory = File_Directory(file.c_str());
+        if (directory.size() > 1) directory.pop_back();
+        if (directory.empty()) directory = ".";
+
+        int wd = inotify_add_watch(reloader.inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd == -1)
+        {
+            std::cout << "Can not watch shader directory: " << directory << std::endl;
+            return;
+        }
+
+        // adding the same directory again returns the same descriptor
+        std::lock_guard<std::mutex> lock(reloader.mutex);
+        reloader.directories[wd] = directory;
+    }
+
+    // files that went into the shader, canonical so they compare against inotify paths
+    static inline void TrackFiles(ShaderReloader& reloader, ShaderWatch& watch, const std::vector<std::string>& vs_files,
+                                  const std::vector<std::string>& fs_files)
+    {
+        watch.files.clear();
+        for (const std::vector<std::string>* list : {&vs_files, &fs_files})
+        {
+            for (const std::string& file : *list)
+            {
+                std::string path = File_Canonical(file.c_str());
+                watch.files.push_back(path);
+                WatchDirectory(reloader, path);
+            }
+        }
+    }
+
+    static inline void Watcher(ShaderReloader& reloader)
+    {
+        alignas(struct inotify_event) char buffer[4096];
+
+        while (true)
+        {
+            struct pollfd fds[2] = {{reloader.inotify, POLLIN, 0}, {reloader.wake[0], POLLIN, 0}};
+            if (poll(fds, 2, -1) == -1)
+            {
+                if (errno == EINTR) continue;
+                std::cout << "Shader hot reload stopped, poll failed: " << strerror(errno) << std::endl;
+                return;
+            }
+            if (fds[1].revents) return;
+
+            ssize_t length = read(reloader.inotify, buffer, sizeof(buffer));
+            if (length == -1 && errno != EAGAIN && errno != EINTR)
+            {
+                std::cout << "Shader hot reload stopped, reading inotify failed: " << strerror(errno) << std::endl;
+                return;
+            }
+            if (length <= 0) continue;
+
+            std::lock_guard<std::mutex> lock(reloader.mutex);
+            for (char* at = buffer; at < buffer + length; )
+            {
+                const struct inotify_event* event = (const struct inotify_event*)at;
+                at += sizeof(struct inotify_event) + event->len;
+
+                auto directory = reloader.directories.find(event->wd);
+                if (directory == reloader.directories.end() || event->len == 0) continue;
+                reloader.changed.insert(directory->second + "/" + event->name);
+            }
+        }
+    }
+
+    // current values of the old program's plain uniforms go to the same names in the new one
+    // every sampler type of GL 3.3, set like an int
+    static inline bool Sampler(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE:
+        case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static inline void CopyUniforms(unsigned int from, unsigned int to)
+    {
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(to);
+
+        GLint count = 0;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            char name[256];
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(from, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+
+            // arrays are reported as "name[0]", each element has its own location
+            std::string base(name);
+            size_t bracket = base.find('[');
+            if (bracket != std::string::npos) base.resize(bracket);
+
+            for (GLint element = 0; element < size; ++element)
+            {
+                std::string element_name = size > 1 ? base + "[" + std::to_string(element) + "]" : std::string(name);
+                GLint source = glGetUniformLocation(from, element_name.c_str());
+                GLint target = glGetUniformLocation(to, element_name.c_str());
+                if (source < 0 || target < 0) continue;
+
+                // block members have no location, so everything here is a plain uniform
+                float f[16];
+                GLint n[4];
+                GLuint u[4];
+                switch (type)
+                {
+                case GL_FLOAT:        glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+                case GL_FLOAT_VEC2:   glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+                case GL_FLOAT_VEC3:   glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+                case GL_FLOAT_VEC4:   glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+                case GL_FLOAT_MAT2:   glGetUniformfv(from, source, f); glUniformMatrix2fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3:   glGetUniformfv(from, source, f); glUniformMatrix3fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4:   glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT2x3: glGetUniformfv(from, source, f); glUniformMatrix2x3fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT2x4: glGetUniformfv(from, source, f); glUniformMatrix2x4fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3x2: glGetUniformfv(from, source, f); glUniformMatrix3x2fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3x4: glGetUniformfv(from, source, f); glUniformMatrix3x4fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4x2: glGetUniformfv(from, source, f); glUniformMatrix4x2fv(target, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4x3: glGetUniformfv(from, source, f); glUniformMatrix4x3fv(target, 1, GL_FALSE, f); break;
+                case GL_UNSIGNED_INT:      glGetUniformuiv(from, source, u); glUniform1uiv(target, 1, u); break;
+                case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glUniform2uiv(target, 1, u); break;
+                case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glUniform3uiv(target, 1, u); break;
+                case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glUniform4uiv(target, 1, u); break;
+                // bools are set through the int functions
+                case GL_INT:  case GL_BOOL:       glGetUniformiv(from, source, n); glUniform1iv(target, 1, n); break;
+                case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, source, n); glUniform2iv(target, 1, n); break;
+                case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, source, n); glUniform3iv(target, 1, n); break;
+                case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, source, n); glUniform4iv(target, 1, n); break;
+                default:
+                    if (Sampler(type))
+                    {
+                        glGetUniformiv(from, source, n);
+                        glUniform1iv(target, 1, n);
+                    }
+                    else std::cout << "Shader reload did not keep uniform " << element_name << ", type 0x" << std::hex << type << std::dec << std::endl;
+                    break;
+                }
+            }
+        }
+
+        glUseProgram((GLuint)previous == from ? to : (GLuint)previous);
+    }
+
+    // rebuilds one shader, the old program stays if anything goes wrong
+    static inline bool Rebuild(ShaderReloader& reloader, ShaderWatch& watch)
+    {
+        std::vector<std::string> vs_files, fs_files;
+        std::string vs, fs;
+        try
+        {
+            vs = Shader_LoadSource(watch.vs_file.c_str(), &vs_files);
+            fs = Shader_LoadSource(watch.fs_file.c_str(), &fs_files);
+        }
+        catch (const std::ios_base::failure& e)
+        {
+            std::cout << "Shader reload skipped, " << e.what() << std::endl;
+            return false;
+        }
+
+        // includes may have been added or removed
+        TrackFiles(reloader, watch, vs_files, fs_files);
+
+        Shader rebuilt;
+        Shader_InitSource(rebuilt, vs, fs, watch.defines.empty() ? nullptr : watch.defines.c_str());
+
+        int success = 0;
+        glGetProgramiv(rebuilt.program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            std::cout << "Shader reload failed, keeping the old program: " << watch.vs_file << ", " << watch.fs_file << std::endl;
+            Shader_Delete(rebuilt);
+            return false;
+        }
+
+        unsigned int old = watch.shader->program;
+        if (old) CopyUniforms(old, rebuilt.program);
+        watch.shader->program = rebuilt.program;
+        if (old) glDeleteProgram(old);
+        return true;
+    }
+}
+
+// starts the watcher thread, returns -1 if inotify is not available
+static inline int ShaderReload_Init(ShaderReloader& reloader)
+{
+    reloader.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reloader.inotify == -1 || pipe(reloader.wake) == -1)
+    {
+        std::cout << "Shader hot reload unavailable, inotify failed" << std::endl;
+        if (reloader.inotify != -1) close(reloader.inotify);
+        reloader.inotify = -1;
+        return -1;
+    }
+
+    reloader.watcher = std::thread(shader_reload_detail::Watcher, std::ref(reloader));
+    return 0;
+}
+
+// builds the shader like Shader_Init and rebuilds it whenever one of its files changes
+static inline void ShaderReload_Watch(ShaderReloader& reloader, Shader& shader, const char* vs_file, const char* fs_file,
+                                      const char* defines = nullptr)
+{
+    ShaderWatch watch;
+    watch.shader = &shader;
+    watch.vs_file = vs_file;
+    watch.fs_file = fs_file;
+    watch.defines = defines ? defines : "";
+
+    std::vector<std::string> vs_files, fs_files;
+    std::string vs = Shader_LoadSource(vs_file, &vs_files);
+    std::string fs = Shader_LoadSource(fs_file, &fs_files);
+    Shader_InitSource(shader, vs, fs, defines);
+
+    if (reloader.inotify == -1) return;
+
+    shader_reload_detail::TrackFiles(reloader, watch, vs_files, fs_files);
+    reloader.watches.push_back(watch);
+}
+
+// stops reloading the shader, call before Shader_Delete
+static inline void ShaderReload_Unwatch(ShaderReloader& reloader, const Shader& shader)
+{
+    for (size_t i = 0; i < reloader.watches.size(); ++i)
+    {
+        if (reloader.watches[i].shader != &shader) continue;
+        reloader.watches[i] = reloader.watches.back();
+        reloader.watches.pop_back();
+        return;
+    }
+}
+
+// once per frame on the render thread, returns how many shaders were swapped
+static inline unsigned int ShaderReload_Poll(ShaderReloader& reloader)
+{
+    std::unordered_set<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(reloader.mutex);
+        if (reloader.changed.empty()) return 0;
+        changed.swap(reloader.changed);
+    }
+
+    unsigned int reloaded = 0;
+    for (ShaderWatch& watch : reloader.watches)
+    {
+        bool dirty = false;
+        for (const std::string& file : watch.files) dirty = dirty || changed.count(file) > 0;
+        if (!dirty) continue;
+
+        if (shader_reload_detail::Rebuild(reloader, watch))
+        {
+            std::cout << "Reloaded shader: " << watch.vs_file << ", " << watch.fs_file << std::endl;
+            reloaded++;
+        }
+    }
+
+    return reloaded;
+}
+
+// stops the watcher, the shaders themselves are left alone
+static inline void ShaderReload_Delete(ShaderReloader& reloader)
+{
+    if (reloader.watcher.joinable())
+    {
+        char stop = 1;
+        if (write(reloader.wake[1], &stop, 1) == 1) reloader.watcher.join();
+        else reloader.watcher.detach();
+    }
+
+    if (reloader.inotify != -1) close(reloader.inotify);
+    if (reloader.wake[0] != -1) close(reloader.wake[0]);
+    if (reloader.wake[1] != -1) close(reloader.wake[1]);
+    reloader.inotify = -1;
+    reloader.wake[0] = reloader.wake[1] = -1;
+
+    reloader.watches.clear();
+    reloader.directories.clear();
+    reloader.changed.clear();
+}
+
+#endif
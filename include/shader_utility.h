@@ -2,12 +2,43 @@
 #define SHADER_UTILITY_H
 
 #include <iostream>
+#include <fstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <string>
 #include "file_utility.h"
+#include "glext_utility.h"
 #include "math_utility.h"
 
+/*
+    Shaders
+
+    Shader_Init compiles and links a vertex and fragment shader from files,
+    Shader_InitSource from text. Both take optional defines that are put
+    after the #version line. Files go through Shader_LoadSource, which
+    pastes #include "file" lines in place (once per file, like a header
+    guard) and adds #line directives so compile errors name the right file
+    and line: the source string number is the file's index in the list
+    Shader_LoadSource returns.
+
+    Shader_InitCompute builds a compute program the same way. Dispatch,
+    storage buffer, image and barrier helpers sit next to it; they need
+    GLExt_Caps().compute (GL 4.3 or the ARB extensions), which
+    Window_GenerateHeadless asks for, and print an error instead of doing
+    anything on the 3.3 fallback.
+
+    With Shader_SetCacheDirectory the linked program is saved through
+    glGetProgramBinary and later runs load it with glProgramBinary instead
+    of compiling. Binaries are keyed by a hash of the final sources (defines
+    included) and the driver's vendor, renderer and version strings, so a
+    change to any of them is a miss. A binary the driver rejects is a miss
+    too; it is compiled from source and the file replaced.
+*/
+
 struct Shader
 {
     unsigned int program = 0;
@@ -29,6 +60,10 @@ static inline void Shader_CompileErrors(unsigned int shader, unsigned int type)
         {
             std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
         }
+        else if (type == GL_COMPUTE_SHADER)
+        {
+            std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
     }
 }
 
@@ -45,33 +80,432 @@ static inline void Shader_LinkErrors(unsigned int program)
     }
 }
 
-static inline void Shader_Init(Shader& shader, const char* vs_file, const char* fs_file)
+namespace shader_detail
 {
-    std::string v_program = LoadTextFile(vs_file);
-    std::string f_program = LoadTextFile(fs_file);
-    const char* vp = v_program.c_str();
-    const char* fp = f_program.c_str();
+    // empty disables the program binary cache
+    inline std::string cache_directory;
+
+    static constexpr uint32_t BINARY_VERSION = 1;
+
+    struct BinaryHeader
+    {
+        char magic[4];          // "GBPB"
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    // FNV-1a, chained so several strings make one key
+    static inline uint64_t Hash(uint64_t h, const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            h ^= (unsigned char)data[i];
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    static inline uint64_t HashString(uint64_t h, const char* text)
+    {
+        // the terminator separates fields, "ab" + "c" and "a" + "bc" differ
+        return text ? Hash(h, text, strlen(text) + 1) : Hash(h, "", 1);
+    }
 
-    unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vp, NULL);
-    glCompileShader(vertex_shader);
-    // check compile errors
-    Shader_CompileErrors(vertex_shader, GL_VERTEX_SHADER);
+    // defines go right after #version, which has to stay the first line
+    static inline std::string InjectDefines(const std::string& source, const char* defines)
+    {
+        if (!defines || !defines[0]) return source;
 
-    unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fp, NULL);
-    glCompileShader(fragment_shader);   
-    Shader_CompileErrors(fragment_shader, GL_FRAGMENT_SHADER);
+        size_t at = 0;
+        size_t version = source.find("#version");
+        if (version != std::string::npos)
+        {
+            at = source.find('\n', version);
+            at = at == std::string::npos ? source.size() : at + 1;
+        }
+
+        // error messages keep pointing at the lines of the file
+        int next_line = 1;
+        for (size_t i = 0; i < at; ++i) next_line += source[i] == '\n';
+
+        std::string text(defines);
+        if (text.back() != '\n') text += '\n';
+        text += "#line " + std::to_string(next_line) + "\n";
+        return source.substr(0, at) + text + source.substr(at);
+    }
+
+    // name of an #include "file" (or <file>) line, empty for any other line
+    static inline std::string IncludeName(const std::string& line)
+    {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string::npos || line.compare(i, 1, "#") != 0) return std::string();
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string::npos || line.compare(i, 7, "include") != 0) return std::string();
+        i = line.find_first_of("\"<", i + 7);
+        if (i == std::string::npos) return std::string();
+
+        size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+        if (end == std::string::npos) return std::string();
+        return line.substr(i + 1, end - i - 1);
+    }
+
+    // pastes includes in place, each file at most once; #line keeps errors pointing at the right file
+    // (its source string number is the index into files, canonical holds the same files resolved)
+    static inline void Preprocess(const std::string& path, std::string& out, std::vector<std::string>& files,
+                                  std::vector<std::string>& canonical)
+    {
+        // a/../b.glsl and b.glsl are the same file
+        std::string resolved = File_Canonical(path.c_str());
+        for (const std::string& seen : canonical)
+        {
+            if (seen == resolved) return;
+        }
+
+        int number = (int)files.size();
+        files.push_back(path);
+        canonical.push_back(resolved);
+        std::string text = LoadTextFile(path.c_str());
+        std::string directory = File_Directory(path.c_str());
+
+        if (number > 0) out += "#line 1 " + std::to_string(number) + "\n";
+
+        size_t begin = 0;
+        int line_number = 1;
+        while (begin < text.size())
+        {
+            size_t end = text.find('\n', begin);
+            if (end == std::string::npos) end = text.size();
+            std::string line = text.substr(begin, end - begin);
+
+            std::string include = IncludeName(line);
+            if (include.empty()) out += line + "\n";
+            else
+            {
+                Preprocess(include[0] == '/' ? include : directory + include, out, files, canonical);
+                out += "#line " + std::to_string(line_number + 1) + " " + std::to_string(number) + "\n";
+            }
+
+            begin = end + 1;
+            line_number++;
+        }
+    }
+
+    // Start* only queue work, nothing there asks the driver for a result
+    static inline unsigned int StartCompile(GLenum type, const char* source)
+    {
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    static inline unsigned int StartLink(unsigned int vertex_shader, unsigned int fragment_shader, bool retrievable)
+    {
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        if (retrievable) glext::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+        return program;
+    }
+
+    static inline std::string BinaryPath(uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return cache_directory + "/" + name;
+    }
+
+    // the driver strings are part of the key, a new driver never sees old binaries
+    static inline uint64_t BinaryKey(const std::string& vs, const std::string& fs)
+    {
+        uint64_t h = 0xcbf29ce484222325ull;
+        h = Hash(h, (const char*)&BINARY_VERSION, sizeof(BINARY_VERSION));
+        h = HashString(h, vs.c_str());
+        h = HashString(h, fs.c_str());
+        h = HashString(h, (const char*)glGetString(GL_VENDOR));
+        h = HashString(h, (const char*)glGetString(GL_RENDERER));
+        h = HashString(h, (const char*)glGetString(GL_VERSION));
+        return h;
+    }
+
+    // 0 on a miss or if the driver rejects the binary
+    static inline unsigned int LoadBinary(uint64_t key)
+    {
+        std::string path = BinaryPath(key);
+        MappedFile map;
+        try
+        {
+            map = File_Map(path.c_str());
+        }
+        catch (const std::ios_base::failure&)
+        {
+            return 0;
+        }
+
+        BinaryHeader header;
+        unsigned int program = 0;
+
+        if (map.size >= sizeof(header))
+        {
+            memcpy(&header, map.data, sizeof(header));
+            if (memcmp(header.magic, "GBPB", 4) == 0 && header.version == BINARY_VERSION &&
+                header.key == key && sizeof(header) + (size_t)header.size == map.size)
+            {
+                program = glCreateProgram();
+                glext::ProgramBinary(program, header.format, map.data + sizeof(header), (GLsizei)header.size);
+
+                int success = 0;
+                glGetProgramiv(program, GL_LINK_STATUS, &success);
+                if (!success)
+                {
+                    glDeleteProgram(program);
+                    program = 0;
+                }
+            }
+        }
+
+        File_Unmap(map);
+        return program;
+    }
+
+    // written next to the final name and renamed, a crash never leaves half a binary behind
+    static inline void SaveBinary(uint64_t key, unsigned int program)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> data(sizeof(BinaryHeader) + length);
+        BinaryHeader header = {{'G', 'B', 'P', 'B'}, BINARY_VERSION, key, 0, 0};
+        GLenum format = 0;
+        glext::GetProgramBinary(program, length, &length, &format, data.data() + sizeof(header));
+        header.format = format;
+        header.size = (uint32_t)length;
+        memcpy(data.data(), &header, sizeof(header));
+
+        if (File_MakeDirectory(cache_directory.c_str()) == -1)
+        {
+            std::cout << "Can not create shader cache directory: " << cache_directory << std::endl;
+            return;
+        }
+
+        std::string path = BinaryPath(key);
+        std::string temp = path + ".tmp";
+        std::ofstream out(temp, std::ios::binary);
+        out.write(data.data(), sizeof(header) + header.size);
+        out.close();
+
+        if (out.fail() || rename(temp.c_str(), path.c_str()) != 0)
+        {
+            std::cout << "Error writing shader cache: " << path << std::endl;
+            remove(temp.c_str());
+        }
+    }
+
+    // reports errors and saves the binary, the status queries wait for the driver to finish
+    static inline bool FinishLink(unsigned int program, unsigned int vertex_shader, unsigned int fragment_shader,
+                                  bool cached, uint64_t key)
+    {
+        Shader_CompileErrors(vertex_shader, GL_VERTEX_SHADER);
+        Shader_CompileErrors(fragment_shader, GL_FRAGMENT_SHADER);
+        Shader_LinkErrors(program);
 
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+
+        int success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (cached && success) SaveBinary(key, program);
+        return success != 0;
+    }
+}
+
+// reads a shader file with its #include "file" lines resolved relative to the including file
+// files gets every file that went in, the first being the one asked for; throws if one is missing
+static inline std::string Shader_LoadSource(const char* file, std::vector<std::string>* files = nullptr)
+{
+    std::vector<std::string> seen, canonical;
+    std::string out;
+    shader_detail::Preprocess(file, out, seen, canonical);
+    if (files) files->swap(seen);
+    return out;
+}
+
+// stores linked programs in dir and loads them on later runs, call after Window_Generate
+// nullptr or "" turns the cache off again
+static inline void Shader_SetCacheDirectory(const char* dir)
+{
+    shader_detail::cache_directory = dir ? dir : "";
+    while (shader_detail::cache_directory.size() > 1 && shader_detail::cache_directory.back() == '/')
+    {
+        shader_detail::cache_directory.pop_back();
+    }
+}
+
+// builds a program from GLSL text, defines ("#define A 1\n...") are placed after #version
+// with a cache directory set, a matching binary is loaded instead of compiling
+static inline void Shader_InitSource(Shader& shader, const std::string& vs_source, const std::string& fs_source,
+                                     const char* defines = nullptr)
+{
+    using namespace shader_detail;
+
+    std::string vs = InjectDefines(vs_source, defines);
+    std::string fs = InjectDefines(fs_source, defines);
+
+    bool cached = !cache_directory.empty() && GLExt_Caps().program_binary;
+    uint64_t key = cached ? BinaryKey(vs, fs) : 0;
+
+    if (cached)
+    {
+        shader.program = LoadBinary(key);
+        if (shader.program) return;
+    }
+
+    unsigned int vertex_shader = StartCompile(GL_VERTEX_SHADER, vs.c_str());
+    unsigned int fragment_shader = StartCompile(GL_FRAGMENT_SHADER, fs.c_str());
+    shader.program = StartLink(vertex_shader, fragment_shader, cached);
+    FinishLink(shader.program, vertex_shader, fragment_shader, cached, key);
+}
+
+static inline void Shader_Init(Shader& shader, const char* vs_file, const char* fs_file, const char* defines = nullptr)
+{
+    std::string v_program = Shader_LoadSource(vs_file);
+    std::string f_program = Shader_LoadSource(fs_file);
+    Shader_InitSource(shader, v_program, f_program, defines);
+}
+
+// compute program from GLSL text, needs GLExt_Caps().compute (Window_GenerateHeadless asks for 4.3)
+static inline void Shader_InitComputeSource(Shader& shader, const std::string& cs_source, const char* defines = nullptr)
+{
+    using namespace shader_detail;
+
+    if (!GLExt_Caps().compute)
+    {
+        std::cout << "Compute shaders need GL 4.3 or ARB_compute_shader" << std::endl;
+        shader.program = 0;
+        return;
+    }
+
+    std::string cs = InjectDefines(cs_source, defines);
+
+    // the second string keeps a compute key apart from a vertex/fragment pair
+    bool cached = !cache_directory.empty() && GLExt_Caps().program_binary;
+    uint64_t key = cached ? BinaryKey(cs, "compute") : 0;
+
+    if (cached)
+    {
+        shader.program = LoadBinary(key);
+        if (shader.program) return;
+    }
+
+    unsigned int compute_shader = StartCompile(GL_COMPUTE_SHADER, cs.c_str());
     shader.program = glCreateProgram();
-    glAttachShader(shader.program, vertex_shader);
-    glAttachShader(shader.program, fragment_shader);
+    glAttachShader(shader.program, compute_shader);
+    if (cached) glext::ProgramParameteri(shader.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(shader.program);
+
+    Shader_CompileErrors(compute_shader, GL_COMPUTE_SHADER);
     Shader_LinkErrors(shader.program);
+    glDeleteShader(compute_shader);
+
+    int success = 0;
+    glGetProgramiv(shader.program, GL_LINK_STATUS, &success);
+    if (cached && success) SaveBinary(key, shader.program);
+}
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-}   
+static inline void Shader_InitCompute(Shader& shader, const char* cs_file, const char* defines = nullptr)
+{
+    Shader_InitComputeSource(shader, Shader_LoadSource(cs_file), defines);
+}
+
+namespace shader_detail
+{
+    // the compute entry points are null without the cap, report instead of calling them
+    static inline bool HasCompute(const char* what)
+    {
+        if (GLExt_Caps().compute) return true;
+        std::cout << what << " needs GL 4.3 or ARB_compute_shader" << std::endl;
+        return false;
+    }
+}
+
+// runs groups_x * groups_y * groups_z work groups, binds the program
+static inline void Shader_Dispatch(const Shader& shader, unsigned int groups_x, unsigned int groups_y = 1, unsigned int groups_z = 1)
+{
+    if (!shader_detail::HasCompute("Shader_Dispatch")) return;
+    if (groups_x == 0 || groups_y == 0 || groups_z == 0) return;
+    glUseProgram(shader.program);
+    glext::DispatchCompute(groups_x, groups_y, groups_z);
+}
+
+// enough groups to cover the thread counts, using the local_size the shader declares
+static inline void Shader_DispatchThreads(const Shader& shader, unsigned int threads_x, unsigned int threads_y = 1, unsigned int threads_z = 1)
+{
+    if (!shader_detail::HasCompute("Shader_DispatchThreads")) return;
+
+    GLint size[3] = {1, 1, 1};
+    glGetProgramiv(shader.program, GL_COMPUTE_WORK_GROUP_SIZE, size);
+    Shader_Dispatch(shader, (threads_x + size[0] - 1) / size[0], (threads_y + size[1] - 1) / size[1], (threads_z + size[2] - 1) / size[2]);
+}
+
+// group counts read from three uints at offset in buffer, so an earlier dispatch can size this one
+static inline void Shader_DispatchIndirect(const Shader& shader, unsigned int buffer, size_t offset = 0)
+{
+    if (!shader_detail::HasCompute("Shader_DispatchIndirect")) return;
+
+    glUseProgram(shader.program);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer);
+    glext::DispatchComputeIndirect((GLintptr)offset);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+// buffer at layout(std430, binding = binding), size 0 binds everything from offset to the end
+static inline void Shader_BindStorageBuffer(unsigned int binding, unsigned int buffer, size_t offset = 0, size_t size = 0)
+{
+    if (!shader_detail::HasCompute("Shader_BindStorageBuffer")) return;
+
+    if (size == 0 && offset == 0)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+        return;
+    }
+
+    // a range has to have a size, take the rest of the buffer
+    if (size == 0)
+    {
+        GLint64 total = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &total);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        if ((GLint64)offset >= total)
+        {
+            std::cout << "Storage buffer offset " << offset << " is past the end of the buffer" << std::endl;
+            return;
+        }
+        size = (size_t)total - offset;
+    }
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, (GLintptr)offset, (GLsizeiptr)size);
+}
+
+// texture level at layout(binding = unit) image, format matches the image's layout qualifier (GL_RGBA32F, ...)
+// access is GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE, layer -1 binds every layer of an array
+static inline void Shader_BindImage(unsigned int unit, unsigned int texture, GLenum access, GLenum format, int level = 0, int layer = -1)
+{
+    if (!shader_detail::HasCompute("Shader_BindImage")) return;
+    glext::BindImageTexture(unit, texture, level, layer < 0 ? GL_TRUE : GL_FALSE, layer < 0 ? 0 : layer, access, format);
+}
+
+// makes compute writes visible to what reads them next, e.g. GL_SHADER_STORAGE_BARRIER_BIT before
+// another dispatch or GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT before drawing from the results
+static inline void Shader_MemoryBarrier(GLbitfield barriers)
+{
+    if (!shader_detail::HasCompute("Shader_MemoryBarrier")) return;
+    glext::MemoryBarrier(barriers);
+}
 
 static inline void Shader_SetUniform1i(Shader& shader, const char *name, int value)
 {
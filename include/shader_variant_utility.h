@@ -0,0 +1,141 @@
+#ifndef SHADER_VARIANT_UTILITY_H
+#define SHADER_VARIANT_UTILITY_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader_utility.h"
+
+/*
+    Shader variants
+
+    One pair of shader files, many programs: INSTANCED, WIREFRAME, LIT and
+    so on are #ifdef'd in the source and a variant is picked by the set of
+    defines it is built with. ShaderVariants_Get takes the set as a space
+    separated string ("LIT INSTANCED LIGHTS=4") and compiles the program
+    the first time that set is asked for.
+
+    The files are read (includes resolved) once at init. A define set is
+    normalised before compiling: names the sources never mention are
+    dropped and the rest sorted, so "LIT WIREFRAME" on a shader without a
+    wireframe path is the same program as "LIT". Programs are keyed by the
+    normalised set, so sets that end up with identical sources share one
+    program however they were spelled.
+
+    Returned references stay valid until ShaderVariants_Delete.
+*/
+
+struct ShaderVariants
+{
+    std::string vs_source;
+    std::string fs_source;
+
+    std::deque<Shader> programs;
+    std::unordered_map<std::string, Shader*> by_defines;    // as asked for, the per frame lookup
+    std::unordered_map<std::string, Shader*> by_block;     // normalised define block, the dedupe
+};
+
+namespace shader_variant_detail
+{
+    static inline bool IsNameChar(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    // whole identifier match, LIT is not found inside LIGHTS
+    static inline bool Mentions(const std::string& source, const std::string& name)
+    {
+        for (size_t at = source.find(name); at != std::string::npos; at = source.find(name, at + 1))
+        {
+            bool start = at == 0 || !IsNameChar(source[at - 1]);
+            bool end = at + name.size() >= source.size() || !IsNameChar(source[at + name.size()]);
+            if (start && end) return true;
+        }
+        return false;
+    }
+
+    // "B A=2 C" -> "#define A 2\n#define B\n" for the names the shaders use,
+    // a name given twice keeps its last value ("A=1 A=2" is A=2)
+    static inline std::string DefineBlock(const ShaderVariants& variants, const std::string& defines)
+    {
+        std::map<std::string, std::string> used;    // name -> define line, sorted by name
+
+        size_t begin = 0;
+        while (begin < defines.size())
+        {
+            size_t end = defines.find(' ', begin);
+            if (end == std::string::npos) end = defines.size();
+            std::string token = defines.substr(begin, end - begin);
+            begin = end + 1;
+            if (token.empty()) continue;
+
+            size_t equals = token.find('=');
+            std::string name = token.substr(0, equals);
+            if (!Mentions(variants.vs_source, name) && !Mentions(variants.fs_source, name)) continue;
+
+            std::string line = "#define " + name;
+            if (equals != std::string::npos) line += " " + token.substr(equals + 1);
+            used[name] = line + "\n";
+        }
+
+        std::string block;
+        for (const auto& entry : used) block += entry.second;
+        return block;
+    }
+}
+
+// reads both files once, throws like Shader_Init if one is missing
+static inline void ShaderVariants_Init(ShaderVariants& variants, const char* vs_file, const char* fs_file)
+{
+    variants.vs_source = Shader_LoadSource(vs_file);
+    variants.fs_source = Shader_LoadSource(fs_file);
+    variants.programs.clear();
+    variants.by_defines.clear();
+    variants.by_block.clear();
+}
+
+// the program for a space separated define set, compiled on first use
+static inline Shader& ShaderVariants_Get(ShaderVariants& variants, const char* defines = "")
+{
+    using namespace shader_variant_detail;
+
+    std::string asked(defines ? defines : "");
+    auto found = variants.by_defines.find(asked);
+    if (found != variants.by_defines.end()) return *found->second;
+
+    std::string block = DefineBlock(variants, asked);
+
+    // the block is the only thing that differs between variants of the same files,
+    // equal blocks mean equal final sources
+    Shader* shader;
+    auto same = variants.by_block.find(block);
+    if (same != variants.by_block.end()) shader = same->second;
+    else
+    {
+        variants.programs.emplace_back();
+        shader = &variants.programs.back();
+        Shader_InitSource(*shader, variants.vs_source, variants.fs_source, block.c_str());
+        variants.by_block[block] = shader;
+    }
+
+    variants.by_defines[asked] = shader;
+    return *shader;
+}
+
+// distinct programs compiled so far
+static inline size_t ShaderVariants_Count(const ShaderVariants& variants)
+{
+    return variants.programs.size();
+}
+
+static inline void ShaderVariants_Delete(ShaderVariants& variants)
+{
+    for (Shader& shader : variants.programs) Shader_Delete(shader);
+    variants.programs.clear();
+    variants.by_defines.clear();
+    variants.by_block.clear();
+}
+
+#endif
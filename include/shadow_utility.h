@@ -0,0 +1,391 @@
+#ifndef SHADOW_UTILITY_H
+#define SHADOW_UTILITY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <glad/glad.h>
+#include "math_utility.h"
+#include "camera_utility.h"
+#include "frustum_utility.h"
+#include "mesh_utility.h"
+#include "mesh_process_utility.h"
+#include "shader_utility.h"
+#include "frame_graph_utility.h"
+
+/*
+    Cascaded shadow maps for one directional light
+
+    The camera's view range is cut into cascades (Shadow_ComputeSplits, a
+    blend of uniform and logarithmic splits) and each cascade gets its own
+    orthographic shadow map, one layer of a depth texture array, so near
+    objects get many texels and far ones few.
+
+    Shadow_Update fits every cascade in light space. Stable fitting (the
+    default) wraps the cascade's slice of the view frustum in a sphere, so
+    the map covers the same area however the camera turns, and snaps the
+    centre to whole texels, so moving the camera slides the map by whole
+    texels and edges do not shimmer. Without it the fit is the slice's
+    tight light space box, sharper but it swims as the camera turns.
+
+    Casters are queued every frame with their model matrix. Each gets its
+    light space bounds once, then a cascade keeps the casters overlapping
+    its rectangle that are not entirely behind it; the depth range of the
+    cascade stretches toward the light just far enough for them. Only
+    those are drawn, so shadow cost follows what can cast into view, not
+    the size of the scene.
+
+    Shadow_AddPasses renders the cascades through a FrameGraph, depth only
+    with shaders/depth_vertex.glsl, and returns the texture resource for
+    the passes that sample it. Shaders sampling it include
+    shaders/shadow.glsl and get their uniforms from Shadow_SetUniforms.
+*/
+
+static constexpr int SHADOW_MAX_CASCADES = 4;  // uShadowMatrices[4] in shaders/shadow.glsl
+
+struct ShadowCaster
+{
+    const Mesh* mesh;
+    Matrix4 model;
+    Vector3 light_min;      // light space bounds, filled by Shadow_Update
+    Vector3 light_max;
+};
+
+struct ShadowCascade
+{
+    float split_near = 0.0f;        // view space distances
+    float split_far = 0.0f;
+    float texel_size = 0.0f;        // world units per shadow map texel
+    Matrix4 projection;             // light space to clip
+    Matrix4 view_projection;        // world to clip
+    std::vector<unsigned int> casters;  // into ShadowMap::casters
+};
+
+struct ShadowMap
+{
+    int resolution = 2048;
+    int cascade_count = SHADOW_MAX_CASCADES;
+    float split_lambda = 0.75f;     // 0 uniform splits, 1 logarithmic
+    float max_distance = 0.0f;      // shadows end here, 0 uses the camera's far plane
+    bool stable = true;
+
+    // slope scaled and constant offset while rendering, against acne
+    float bias_factor = 2.0f;
+    float bias_units = 4.0f;
+
+    Vector3 light_direction = {0.0f, -1.0f, 0.0f};  // the way the light travels
+    Matrix4 light_view;             // world to light space, rotation only
+
+    unsigned int texture = 0;
+    Shader depth_shader;
+    Shader depth_shader_quantized;
+
+    ShadowCascade cascades[SHADOW_MAX_CASCADES];
+    std::vector<ShadowCaster> casters;
+    unsigned int drawn = 0;         // caster draws over all cascades in the last update
+};
+
+namespace shadow_detail
+{
+    static inline Matrix4 Orthographic(float left, float right, float bottom, float top, float near_plane, float far_plane)
+    {
+        Matrix4 result = Math_Mat4Identity();
+        result.m[0] = 2.0f / (right - left);
+        result.m[5] = 2.0f / (top - bottom);
+        result.m[10] = -2.0f / (far_plane - near_plane);
+        result.m[12] = -(right + left) / (right - left);
+        result.m[13] = -(top + bottom) / (top - bottom);
+        result.m[14] = -(far_plane + near_plane) / (far_plane - near_plane);
+        return result;
+    }
+
+    // looks along the light, -z is the direction it travels
+    static inline Matrix4 LightView(const Vector3& direction)
+    {
+        Vector3 back = Math_Vec3Normalize(Math_Vec3Scale(direction, -1.0f));
+        Vector3 reference = fabsf(back.y) > 0.99f ? Vector3{1.0f, 0.0f, 0.0f} : Vector3{0.0f, 1.0f, 0.0f};
+        Vector3 side = Math_Vec3Normalize(Math_Vec3Cross(reference, back));
+        Vector3 up = Math_Vec3Cross(back, side);
+
+        Matrix4 result = Math_Mat4Identity();
+        result.m[0] = side.x; result.m[4] = side.y; result.m[8] = side.z;
+        result.m[1] = up.x;   result.m[5] = up.y;   result.m[9] = up.z;
+        result.m[2] = back.x; result.m[6] = back.y; result.m[10] = back.z;
+        return result;
+    }
+
+    static inline Vector3 Transform(const Matrix4& m, const Vector3& p)
+    {
+        return {m.m[0] * p.x + m.m[4] * p.y + m.m[8] * p.z + m.m[12],
+                m.m[1] * p.x + m.m[5] * p.y + m.m[9] * p.z + m.m[13],
+                m.m[2] * p.x + m.m[6] * p.y + m.m[10] * p.z + m.m[14]};
+    }
+
+    // world space corners of the view frustum between two view distances
+    static inline void SliceCorners(const Camera& camera, float fov, float aspect, float near_plane, float far_plane,
+                                    Vector3 corners[8])
+    {
+        // rows of the view matrix are the camera's axes in world space
+        Matrix4 view = Camera_ViewMatrix(camera);
+        Vector3 side = {view.m[0], view.m[4], view.m[8]};
+        Vector3 up = {view.m[1], view.m[5], view.m[9]};
+        Vector3 forward = {-view.m[2], -view.m[6], -view.m[10]};
+
+        float tan_y = tanf(fov * 0.5f);
+        float tan_x = tan_y * aspect;
+
+        int i = 0;
+        for (float distance : {near_plane, far_plane})
+        {
+            Vector3 centre = Math_Vec3Add(camera.position, Math_Vec3Scale(forward, distance));
+            Vector3 x = Math_Vec3Scale(side, distance * tan_x);
+            Vector3 y = Math_Vec3Scale(up, distance * tan_y);
+            for (float sx : {-1.0f, 1.0f})
+            {
+                for (float sy : {-1.0f, 1.0f})
+                {
+                    corners[i++] = Math_Vec3Add(centre, Math_Vec3Add(Math_Vec3Scale(x, sx), Math_Vec3Scale(y, sy)));
+                }
+            }
+        }
+    }
+
+    static inline void DrawCascade(ShadowMap& shadows, int index)
+    {
+        const ShadowCascade& cascade = shadows.cascades[index];
+        if (cascade.casters.empty()) return;
+
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(shadows.bias_factor, shadows.bias_units);
+        glDepthFunc(GL_LESS);
+
+        Shader* bound = nullptr;
+        for (unsigned int i : cascade.casters)
+        {
+            const ShadowCaster& caster = shadows.casters[i];
+            Shader* shader = (caster.mesh->layout & MESH_ATTRIB_QUANTIZED) ? &shadows.depth_shader_quantized : &shadows.depth_shader;
+            if (shader != bound)
+            {
+                Shader_Enable(*shader);
+                Shader_SetUniformMat4(*shader, "uView", shadows.light_view);
+                Shader_SetUniformMat4(*shader, "uProjection", cascade.projection);
+                bound = shader;
+            }
+
+            Shader_SetUniformMat4(*shader, "uModel", caster.model);
+            if (caster.mesh->layout & MESH_ATTRIB_QUANTIZED) MeshProcess_SetDecodeUniforms(*shader, *caster.mesh);
+            Mesh_Draw(*caster.mesh);
+        }
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        Shader_Disable();
+    }
+}
+
+// far distance of each of count cascades between near and far, lambda 0 spaces them evenly, 1 logarithmically
+static inline void Shadow_ComputeSplits(float near_plane, float far_plane, int count, float lambda, float* splits)
+{
+    for (int i = 1; i <= count; ++i)
+    {
+        float t = (float)i / (float)count;
+        float logarithmic = near_plane * powf(far_plane / near_plane, t);
+        float uniform = near_plane + (far_plane - near_plane) * t;
+        splits[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+}
+
+// creates the depth texture array, throws like Shader_Init if the depth shaders are missing
+static inline void Shadow_Init(ShadowMap& shadows, int resolution = 2048, int cascade_count = SHADOW_MAX_CASCADES)
+{
+    shadows.resolution = resolution;
+    shadows.cascade_count = cascade_count < 1 ? 1 : cascade_count > SHADOW_MAX_CASCADES ? SHADOW_MAX_CASCADES : cascade_count;
+    shadows.light_view = shadow_detail::LightView(shadows.light_direction);
+
+    Shader_Init(shadows.depth_shader, "shaders/depth_vertex.glsl", "shaders/depth_fragment.glsl");
+    Shader_Init(shadows.depth_shader_quantized, "shaders/depth_vertex.glsl", "shaders/depth_fragment.glsl", "#define QUANTIZED\n");
+
+    // compared on lookup, linear filtering then gives 2x2 PCF for free
+    glGenTextures(1, &shadows.texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadows.texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, shadows.cascade_count, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    shadows.casters.clear();
+}
+
+static inline void Shadow_SetLight(ShadowMap& shadows, const Vector3& direction)
+{
+    shadows.light_direction = Math_Vec3Normalize(direction);
+    shadows.light_view = shadow_detail::LightView(shadows.light_direction);
+}
+
+// starts a new frame of casters
+static inline void Shadow_Begin(ShadowMap& shadows)
+{
+    shadows.casters.clear();
+}
+
+static inline void Shadow_AddCaster(ShadowMap& shadows, const Mesh& mesh, const Matrix4& model)
+{
+    if (mesh.initialized != 0) return;
+    shadows.casters.push_back({&mesh, model, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}});
+}
+
+// fits the cascades to the camera (with the fov, aspect and planes given to Math_ProjectionMatrix)
+// and picks the casters each one draws
+static inline void Shadow_Update(ShadowMap& shadows, const Camera& camera, float fov, float aspect, float near_plane, float far_plane)
+{
+    using namespace shadow_detail;
+
+    for (ShadowCaster& caster : shadows.casters)
+    {
+        Frustum_TransformAABB(Math_Mat4Multiply(shadows.light_view, caster.model), caster.mesh->bounds_min,
+                              caster.mesh->bounds_max, caster.light_min, caster.light_max);
+    }
+
+    float range = shadows.max_distance > 0.0f && shadows.max_distance < far_plane ? shadows.max_distance : far_plane;
+    float splits[SHADOW_MAX_CASCADES];
+    Shadow_ComputeSplits(near_plane, range, shadows.cascade_count, shadows.split_lambda, splits);
+
+    shadows.drawn = 0;
+    float resolution = (float)shadows.resolution;
+    for (int c = 0; c < shadows.cascade_count; ++c)
+    {
+        ShadowCascade& cascade = shadows.cascades[c];
+        cascade.split_near = c == 0 ? near_plane : splits[c - 1];
+        cascade.split_far = splits[c];
+
+        Vector3 corners[8];
+        SliceCorners(camera, fov, aspect, cascade.split_near, cascade.split_far, corners);
+
+        Vector3 lo, hi;
+        if (shadows.stable)
+        {
+            // the sphere only depends on the slice's shape, not on where the camera looks
+            Vector3 centre = {0.0f, 0.0f, 0.0f};
+            for (const Vector3& corner : corners) centre = Math_Vec3Add(centre, Math_Vec3Scale(corner, 0.125f));
+            float radius = 0.0f;
+            for (const Vector3& corner : corners) radius = fmaxf(radius, Math_Vec3Length(Math_Vec3Sub(corner, centre)));
+            radius = ceilf(radius * 16.0f) / 16.0f;
+
+            // whole texel steps in light space, the map slides instead of resampling
+            cascade.texel_size = 2.0f * radius / resolution;
+            Vector3 light_centre = Transform(shadows.light_view, centre);
+            light_centre.x = floorf(light_centre.x / cascade.texel_size) * cascade.texel_size;
+            light_centre.y = floorf(light_centre.y / cascade.texel_size) * cascade.texel_size;
+
+            lo = {light_centre.x - radius, light_centre.y - radius, light_centre.z - radius};
+            hi = {light_centre.x + radius, light_centre.y + radius, light_centre.z + radius};
+        }
+        else
+        {
+            lo = hi = Transform(shadows.light_view, corners[0]);
+            for (int i = 1; i < 8; ++i)
+            {
+                Vector3 p = Transform(shadows.light_view, corners[i]);
+                lo = {fminf(lo.x, p.x), fminf(lo.y, p.y), fminf(lo.z, p.z)};
+                hi = {fmaxf(hi.x, p.x), fmaxf(hi.y, p.y), fmaxf(hi.z, p.z)};
+            }
+
+            // at least the edges land on texels
+            cascade.texel_size = fmaxf(hi.x - lo.x, hi.y - lo.y) / resolution;
+            lo.x = floorf(lo.x / cascade.texel_size) * cascade.texel_size;
+            lo.y = floorf(lo.y / cascade.texel_size) * cascade.texel_size;
+            hi.x = ceilf(hi.x / cascade.texel_size) * cascade.texel_size;
+            hi.y = ceilf(hi.y / cascade.texel_size) * cascade.texel_size;
+        }
+
+        // casters over the rectangle and not wholly behind the slice; +z points at the light
+        float nearest = hi.z;
+        cascade.casters.clear();
+        for (unsigned int i = 0; i < shadows.casters.size(); ++i)
+        {
+            const ShadowCaster& caster = shadows.casters[i];
+            if (caster.light_max.x < lo.x || caster.light_min.x > hi.x) continue;
+            if (caster.light_max.y < lo.y || caster.light_min.y > hi.y) continue;
+            if (caster.light_max.z < lo.z) continue;
+
+            cascade.casters.push_back(i);
+            nearest = fmaxf(nearest, caster.light_max.z);
+        }
+        shadows.drawn += (unsigned int)cascade.casters.size();
+
+        // a little slack so casters on the near plane are not clipped
+        float margin = cascade.texel_size * 4.0f;
+        cascade.projection = Orthographic(lo.x, hi.x, lo.y, hi.y, -(nearest + margin), -(lo.z - margin));
+        cascade.view_projection = Math_Mat4Multiply(cascade.projection, shadows.light_view);
+    }
+}
+
+// one depth pass per cascade, returns the texture resource for the passes that sample it
+static inline unsigned int Shadow_AddPasses(ShadowMap& shadows, FrameGraph& graph)
+{
+    FrameGraphTextureDesc desc;
+    desc.width = shadows.resolution;
+    desc.height = shadows.resolution;
+    desc.format = GL_DEPTH_COMPONENT24;
+    desc.layers = shadows.cascade_count;
+    unsigned int texture = FrameGraph_ImportTexture(graph, "shadow map", shadows.texture, desc);
+
+    static const char* names[SHADOW_MAX_CASCADES] = {"shadow cascade 0", "shadow cascade 1", "shadow cascade 2", "shadow cascade 3"};
+    for (int c = 0; c < shadows.cascade_count; ++c)
+    {
+        unsigned int pass = FrameGraph_AddPass(graph, names[c], [&shadows, c](FrameGraph&)
+        {
+            shadow_detail::DrawCascade(shadows, c);
+        });
+        FrameGraph_Write(graph, pass, texture, FRAME_GRAPH_CLEAR, c);
+    }
+
+    return texture;
+}
+
+// uniforms of shaders/shadow.glsl for a shader that is currently enabled, the map goes to unit
+static inline void Shadow_SetUniforms(const ShadowMap& shadows, Shader& shader, int unit)
+{
+    // clip space to texture space
+    Matrix4 bias = Math_Mat4Identity();
+    bias.m[0] = bias.m[5] = bias.m[10] = 0.5f;
+    bias.m[12] = bias.m[13] = bias.m[14] = 0.5f;
+
+    float matrices[SHADOW_MAX_CASCADES * 16] = {};
+    Vector4 splits = {0.0f, 0.0f, 0.0f, 0.0f};
+    float* split = &splits.x;
+    for (int c = 0; c < shadows.cascade_count; ++c)
+    {
+        Matrix4 m = Math_Mat4Multiply(bias, shadows.cascades[c].view_projection);
+        for (int k = 0; k < 16; ++k) matrices[c * 16 + k] = m.m[k];
+        split[c] = shadows.cascades[c].split_far;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadows.texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniformMatrix4fv(glGetUniformLocation(shader.program, "uShadowMatrices"), SHADOW_MAX_CASCADES, GL_FALSE, matrices);
+    Shader_SetUniform4f(shader, "uCascadeSplits", splits);
+    Shader_SetUniform1i(shader, "uCascadeCount", shadows.cascade_count);
+    Shader_SetUniform1i(shader, "uShadowMap", unit);
+    Shader_SetUniform3f(shader, "uLightDirection", shadows.light_direction);
+}
+
+static inline void Shadow_Delete(ShadowMap& shadows)
+{
+    if (shadows.texture) glDeleteTextures(1, &shadows.texture);
+    shadows.texture = 0;
+    shadows.casters.clear();
+    for (ShadowCascade& cascade : shadows.cascades) cascade.casters.clear();
+
+    Shader_Delete(shadows.depth_shader);
+    Shader_Delete(shadows.depth_shader_quantized);
+}
+
+#endif
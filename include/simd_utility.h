@@ -0,0 +1,105 @@
+#ifndef SIMD_UTILITY_H
+#define SIMD_UTILITY_H
+
+#include <math.h>
+
+/*
+    Four wide float math
+
+    SSE2 on x86 (always there on x86-64), plain loops everywhere else. The
+    mesh processing passes run their per triangle math four triangles at a
+    time through these, with the data laid out as separate x, y, z arrays.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+struct Float4 { __m128 v; };
+
+static inline Float4 Simd_Load(const float* p)              { return {_mm_loadu_ps(p)}; }
+static inline void   Simd_Store(float* p, Float4 a)         { _mm_storeu_ps(p, a.v); }
+static inline Float4 Simd_Set(float s)                      { return {_mm_set1_ps(s)}; }
+static inline Float4 Simd_Add(Float4 a, Float4 b)           { return {_mm_add_ps(a.v, b.v)}; }
+static inline Float4 Simd_Sub(Float4 a, Float4 b)           { return {_mm_sub_ps(a.v, b.v)}; }
+static inline Float4 Simd_Mul(Float4 a, Float4 b)           { return {_mm_mul_ps(a.v, b.v)}; }
+static inline Float4 Simd_Div(Float4 a, Float4 b)           { return {_mm_div_ps(a.v, b.v)}; }
+static inline Float4 Simd_Sqrt(Float4 a)                    { return {_mm_sqrt_ps(a.v)}; }
+static inline Float4 Simd_Min(Float4 a, Float4 b)           { return {_mm_min_ps(a.v, b.v)}; }
+static inline Float4 Simd_Max(Float4 a, Float4 b)           { return {_mm_max_ps(a.v, b.v)}; }
+
+// all bits set in the lanes where a > b
+static inline Float4 Simd_Greater(Float4 a, Float4 b)       { return {_mm_cmpgt_ps(a.v, b.v)}; }
+
+// lanes of a where mask is set, b elsewhere
+static inline Float4 Simd_Select(Float4 mask, Float4 a, Float4 b)
+{
+    return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+
+#else
+
+struct Float4 { float v[4]; };
+
+static inline Float4 Simd_Load(const float* p)              { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void   Simd_Store(float* p, Float4 a)         { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+static inline Float4 Simd_Set(float s)                      { return {{s, s, s, s}}; }
+static inline Float4 Simd_Add(Float4 a, Float4 b)           { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+static inline Float4 Simd_Sub(Float4 a, Float4 b)           { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+static inline Float4 Simd_Mul(Float4 a, Float4 b)           { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+static inline Float4 Simd_Div(Float4 a, Float4 b)           { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+static inline Float4 Simd_Sqrt(Float4 a)                    { for (int i = 0; i < 4; ++i) a.v[i] = sqrtf(a.v[i]); return a; }
+static inline Float4 Simd_Min(Float4 a, Float4 b)           { for (int i = 0; i < 4; ++i) a.v[i] = fminf(a.v[i], b.v[i]); return a; }
+static inline Float4 Simd_Max(Float4 a, Float4 b)           { for (int i = 0; i < 4; ++i) a.v[i] = fmaxf(a.v[i], b.v[i]); return a; }
+
+// 1 in the lanes where a > b, the scalar path only ever feeds masks to Simd_Select
+static inline Float4 Simd_Greater(Float4 a, Float4 b)       { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? 1.0f : 0.0f; return a; }
+
+static inline Float4 Simd_Select(Float4 mask, Float4 a, Float4 b)
+{
+    for (int i = 0; i < 4; ++i) a.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i];
+    return a;
+}
+
+#endif
+
+// dot and cross of three lane vectors held as separate x, y, z
+static inline Float4 Simd_Dot3(Float4 ax, Float4 ay, Float4 az, Float4 bx, Float4 by, Float4 bz)
+{
+    return Simd_Add(Simd_Add(Simd_Mul(ax, bx), Simd_Mul(ay, by)), Simd_Mul(az, bz));
+}
+
+static inline void Simd_Cross3(Float4 ax, Float4 ay, Float4 az, Float4 bx, Float4 by, Float4 bz,
+                               Float4& cx, Float4& cy, Float4& cz)
+{
+    cx = Simd_Sub(Simd_Mul(ay, bz), Simd_Mul(az, by));
+    cy = Simd_Sub(Simd_Mul(az, bx), Simd_Mul(ax, bz));
+    cz = Simd_Sub(Simd_Mul(ax, by), Simd_Mul(ay, bx));
+}
+
+// acos to about 7e-5 radians (Abramowitz and Stegun 4.4.45), inputs clamped to [-1, 1]
+static inline Float4 Simd_Acos(Float4 x)
+{
+    Float4 one = Simd_Set(1.0f);
+    x = Simd_Min(Simd_Max(x, Simd_Set(-1.0f)), one);
+    Float4 a = Simd_Max(x, Simd_Sub(Simd_Set(0.0f), x));
+
+    Float4 p = Simd_Add(Simd_Set(0.0742610f), Simd_Mul(a, Simd_Set(-0.0187293f)));
+    p = Simd_Add(Simd_Set(-0.2121144f), Simd_Mul(a, p));
+    p = Simd_Add(Simd_Set(1.5707288f), Simd_Mul(a, p));
+    Float4 r = Simd_Mul(Simd_Sqrt(Simd_Sub(one, a)), p);
+
+    return Simd_Select(Simd_Greater(Simd_Set(0.0f), x), Simd_Sub(Simd_Set(3.14159265f), r), r);
+}
+
+// scales x, y, z to unit length, zero length lanes become zero
+static inline void Simd_Normalize3(Float4& x, Float4& y, Float4& z)
+{
+    Float4 length = Simd_Sqrt(Simd_Dot3(x, y, z, x, y, z));
+    Float4 valid = Simd_Greater(length, Simd_Set(1e-20f));
+    Float4 inverse = Simd_Select(valid, Simd_Div(Simd_Set(1.0f), Simd_Max(length, Simd_Set(1e-20f))), Simd_Set(0.0f));
+    x = Simd_Mul(x, inverse);
+    y = Simd_Mul(y, inverse);
+    z = Simd_Mul(z, inverse);
+}
+
+#endif
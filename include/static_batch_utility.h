@@ -0,0 +1,299 @@
+#ifndef STATIC_BATCH_UTILITY_H
+#define STATIC_BATCH_UTILITY_H
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <math.h>
+#include "math_utility.h"
+#include "mesh_utility.h"
+#include "shader_utility.h"
+#include "thread_utility.h"
+#include "frustum_utility.h"
+
+/*
+    Static batching
+
+    Objects that never move are added once with their model matrix. Build
+    bakes the transform into a copy of the vertices and merges everything
+    that shares a shader, colour and vertex layout into one mesh per grid
+    cell (an instance belongs to the cell holding the center of its world
+    bounds). Each cell keeps its own bounds, so Draw can still frustum cull
+    and issues one draw per visible cell.
+
+    Source meshes need their CPU side vertices and must stay alive until
+    StaticBatch_Build, they can be deleted afterwards.
+*/
+
+struct StaticInstance
+{
+    const Mesh* mesh;
+    Matrix4 model;
+};
+
+struct StaticCell
+{
+    int64_t key;
+    std::vector<unsigned int> instances;    // into StaticBatcher::instances until built
+    Mesh mesh;
+};
+
+struct StaticBatch
+{
+    Shader* shader;
+    Vector4 colour;
+    unsigned int layout;
+    std::vector<StaticCell> cells;
+    std::unordered_map<int64_t, size_t> cell_lookup;
+};
+
+struct StaticBatcher
+{
+    float cell_size = 32.0f;
+    std::vector<StaticInstance> instances;
+    std::vector<StaticBatch> batches;
+};
+
+namespace static_batch_detail
+{
+    // 21 bits per axis, plenty of cells either side of the origin
+    static inline int64_t CellKey(const Vector3& center, float cell_size)
+    {
+        int64_t x = (int64_t)floorf(center.x / cell_size) & 0x1fffff;
+        int64_t y = (int64_t)floorf(center.y / cell_size) & 0x1fffff;
+        int64_t z = (int64_t)floorf(center.z / cell_size) & 0x1fffff;
+        return (x << 42) | (y << 21) | z;
+    }
+
+    // pre-transforms every instance of a cell into one indexed mesh, CPU side only
+    static inline void BakeCell(const StaticBatcher& batcher, unsigned int layout, StaticCell& cell)
+    {
+        int stride = Mesh_VertexStride(layout);
+        bool has_normal = (layout & MESH_ATTRIB_NORMAL) != 0;
+        bool has_uv = (layout & MESH_ATTRIB_UV) != 0;
+        bool has_tangent = (layout & MESH_ATTRIB_TANGENT) != 0;
+
+        size_t vertex_total = 0, index_total = 0;
+        for (unsigned int i : cell.instances)
+        {
+            const Mesh& mesh = *batcher.instances[i].mesh;
+            vertex_total += Mesh_VertexCount(mesh);
+            index_total += mesh.use_indices ? mesh.indices.size() : Mesh_VertexCount(mesh);
+        }
+
+        Mesh& out = cell.mesh;
+        out.vertices.resize(vertex_total * stride);
+        out.indices.resize(index_total);
+        out.layout = layout;
+        out.use_indices = true;
+        out.initialized = 0;
+
+        float* v_out = out.vertices.data();
+        unsigned int* i_out = out.indices.data();
+        unsigned int base = 0;
+
+        for (unsigned int i : cell.instances)
+        {
+            const Mesh& mesh = *batcher.instances[i].mesh;
+            const float* m = batcher.instances[i].model.m;
+
+            // normals go through the cofactor matrix, the inverse transpose up to a scale
+            Vector3 c0 = {m[0], m[1], m[2]}, c1 = {m[4], m[5], m[6]}, c2 = {m[8], m[9], m[10]};
+            Vector3 n0 = Math_Vec3Cross(c1, c2), n1 = Math_Vec3Cross(c2, c0), n2 = Math_Vec3Cross(c0, c1);
+            bool mirrored = Math_Vec3Dot(c0, n0) < 0.0f;
+
+            unsigned int count = Mesh_VertexCount(mesh);
+            const float* v = mesh.vertices.data();
+
+            for (unsigned int k = 0; k < count; ++k, v += stride, v_out += stride)
+            {
+                v_out[0] = m[0] * v[0] + m[4] * v[1] + m[8] * v[2] + m[12];
+                v_out[1] = m[1] * v[0] + m[5] * v[1] + m[9] * v[2] + m[13];
+                v_out[2] = m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14];
+
+                int at = 3;
+                if (has_normal)
+                {
+                    float x = n0.x * v[3] + n1.x * v[4] + n2.x * v[5];
+                    float y = n0.y * v[3] + n1.y * v[4] + n2.y * v[5];
+                    float z = n0.z * v[3] + n1.z * v[4] + n2.z * v[5];
+                    float length = sqrtf(x * x + y * y + z * z);
+                    float scale = length > 0.0f ? (mirrored ? -1.0f : 1.0f) / length : 0.0f;
+                    v_out[3] = x * scale;
+                    v_out[4] = y * scale;
+                    v_out[5] = z * scale;
+                    at = 6;
+                }
+
+                if (has_uv)
+                {
+                    v_out[at] = v[at];
+                    v_out[at + 1] = v[at + 1];
+                    at += 2;
+                }
+
+                // tangents follow the surface, so they take the model matrix itself
+                if (has_tangent)
+                {
+                    const float* t = v + at;
+                    float x = m[0] * t[0] + m[4] * t[1] + m[8] * t[2];
+                    float y = m[1] * t[0] + m[5] * t[1] + m[9] * t[2];
+                    float z = m[2] * t[0] + m[6] * t[1] + m[10] * t[2];
+                    float length = sqrtf(x * x + y * y + z * z);
+                    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+                    v_out[at] = x * scale;
+                    v_out[at + 1] = y * scale;
+                    v_out[at + 2] = z * scale;
+                    v_out[at + 3] = mirrored ? -t[3] : t[3];
+                }
+            }
+
+            // a mirroring transform flips the winding, swap two corners to undo it
+            size_t corners = mesh.use_indices ? mesh.indices.size() : count;
+            for (size_t k = 0; k + 2 < corners; k += 3)
+            {
+                unsigned int a = mesh.use_indices ? mesh.indices[k] : (unsigned int)k;
+                unsigned int b = mesh.use_indices ? mesh.indices[k + 1] : (unsigned int)k + 1;
+                unsigned int c = mesh.use_indices ? mesh.indices[k + 2] : (unsigned int)k + 2;
+                *i_out++ = base + a;
+                *i_out++ = base + (mirrored ? c : b);
+                *i_out++ = base + (mirrored ? b : c);
+            }
+
+            base += count;
+        }
+
+        // a trailing partial triangle in a source mesh is dropped
+        out.indices.resize(i_out - out.indices.data());
+    }
+}
+
+// cell_size is the edge of the grid cells in world units, bigger cells mean fewer draws and coarser culling
+static inline void StaticBatch_Init(StaticBatcher& batcher, float cell_size)
+{
+    batcher.cell_size = cell_size > 0.0f ? cell_size : 32.0f;
+    batcher.instances.clear();
+    batcher.batches.clear();
+}
+
+// queues a non moving object, nothing is copied until StaticBatch_Build
+static inline void StaticBatch_Add(StaticBatcher& batcher, Shader& shader, const Vector4& colour, const Mesh& mesh, const Matrix4& model)
+{
+    if (mesh.vertices.empty() || (mesh.layout & MESH_ATTRIB_QUANTIZED) || mesh.primitive != GL_TRIANGLES)
+    {
+        std::cout << "Static batching needs the float vertices and triangle list of a mesh on the CPU" << std::endl;
+        return;
+    }
+
+    StaticBatch* batch = nullptr;
+    for (StaticBatch& b : batcher.batches)
+    {
+        if (b.shader == &shader && b.layout == mesh.layout &&
+            b.colour.x == colour.x && b.colour.y == colour.y && b.colour.z == colour.z && b.colour.w == colour.w)
+        {
+            batch = &b;
+            break;
+        }
+    }
+
+    if (!batch)
+    {
+        batcher.batches.push_back({&shader, colour, mesh.layout, {}, {}});
+        batch = &batcher.batches.back();
+    }
+
+    Vector3 local_min, local_max, world_min, world_max;
+    Mesh_ComputeBounds(mesh, local_min, local_max);
+    Frustum_TransformAABB(model, local_min, local_max, world_min, world_max);
+
+    Vector3 center = Math_Vec3Scale(Math_Vec3Add(world_min, world_max), 0.5f);
+    int64_t key = static_batch_detail::CellKey(center, batcher.cell_size);
+
+    auto found = batch->cell_lookup.find(key);
+    if (found == batch->cell_lookup.end())
+    {
+        found = batch->cell_lookup.emplace(key, batch->cells.size()).first;
+        batch->cells.emplace_back();
+        batch->cells.back().key = key;
+    }
+
+    batch->cells[found->second].instances.push_back((unsigned int)batcher.instances.size());
+    batcher.instances.push_back({&mesh, model});
+}
+
+// bakes every cell on worker threads and uploads the merged meshes
+static inline void StaticBatch_Build(StaticBatcher& batcher)
+{
+    std::vector<std::pair<unsigned int, StaticCell*>> work;
+    for (StaticBatch& batch : batcher.batches)
+    {
+        for (StaticCell& cell : batch.cells)
+        {
+            if (!cell.instances.empty()) work.push_back({batch.layout, &cell});
+        }
+    }
+
+    Thread_ParallelFor(work.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) static_batch_detail::BakeCell(batcher, work[i].first, *work[i].second);
+    });
+
+    for (auto& item : work)
+    {
+        StaticCell& cell = *item.second;
+        Mesh_Generate(cell.mesh);
+        cell.instances.clear();
+        cell.instances.shrink_to_fit();
+    }
+
+    batcher.instances.clear();
+    batcher.instances.shrink_to_fit();
+}
+
+// draws the cells inside the view frustum, returns the number of draws issued
+static inline unsigned int StaticBatch_Draw(StaticBatcher& batcher, const Matrix4& view, const Matrix4& projection)
+{
+    Frustum frustum = Frustum_FromMatrix(Math_Mat4Multiply(projection, view));
+    unsigned int draws = 0;
+
+    for (StaticBatch& batch : batcher.batches)
+    {
+        bool bound = false;
+
+        for (StaticCell& cell : batch.cells)
+        {
+            if (cell.mesh.VAO == 0) continue;
+            if (!Frustum_TestAABB(frustum, cell.mesh.bounds_min, cell.mesh.bounds_max)) continue;
+
+            // skip the shader entirely when none of its cells are visible
+            if (!bound)
+            {
+                Shader_Enable(*batch.shader);
+                Shader_SetUniformMat4(*batch.shader, "uModel", Math_Mat4Identity());
+                Shader_SetUniformMat4(*batch.shader, "uView", view);
+                Shader_SetUniformMat4(*batch.shader, "uProjection", projection);
+                Shader_SetUniform4f(*batch.shader, "uColor", batch.colour);
+                bound = true;
+            }
+
+            Mesh_Draw(cell.mesh);
+            draws++;
+        }
+    }
+
+    return draws;
+}
+
+static inline void StaticBatch_Delete(StaticBatcher& batcher)
+{
+    for (StaticBatch& batch : batcher.batches)
+    {
+        for (StaticCell& cell : batch.cells) Mesh_Delete(cell.mesh);
+    }
+
+    batcher.batches.clear();
+    batcher.instances.clear();
+}
+
+#endif
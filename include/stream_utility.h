@@ -0,0 +1,190 @@
+#ifndef STREAM_UTILITY_H
+#define STREAM_UTILITY_H
+
+#include <iostream>
+#include <glad/glad.h>
+#include "glext_utility.h"
+
+/*
+    Streaming buffer for per frame data
+
+    Transient vertices, indices and uniform blocks are bump allocated out of
+    one buffer. With buffer storage the buffer holds three frame sized
+    regions that stay mapped for the life of the buffer; a fence per region
+    stops the CPU from writing a region the GPU is still reading. On plain
+    3.3 the buffer is one region, orphaned and mapped unsynchronized at the
+    start of every frame, so the driver hands us fresh memory instead of
+    stalling.
+
+    Per frame:
+        StreamBuffer_BeginFrame(stream);
+        StreamAllocation a = StreamBuffer_Alloc(stream, bytes, alignment);
+        ... write to a.ptr ...
+        StreamBuffer_Commit(stream);       // before any draw reads the buffer
+        ... draws using a.offset into stream.buffer ...
+        StreamBuffer_EndFrame(stream);     // after the last draw
+*/
+
+static constexpr int STREAM_FRAMES = 3;
+
+struct StreamAllocation
+{
+    void* ptr;          // where to write, nullptr if the frame is out of space
+    size_t offset;      // byte offset into the buffer for GL calls
+};
+
+struct StreamBuffer
+{
+    unsigned int buffer = 0;
+    size_t frame_size = 0;
+    int frame = 0;
+    size_t head = 0;
+    bool persistent = false;
+
+    // the whole buffer when persistent, the current frame otherwise
+    unsigned char* mapped = nullptr;
+    GLsync fences[STREAM_FRAMES] = {};
+};
+
+namespace stream_detail
+{
+    static inline void Wait(GLsync& fence)
+    {
+        if (!fence) return;
+
+        while (true)
+        {
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+        }
+
+        glDeleteSync(fence);
+        fence = 0;
+    }
+}
+
+// offset alignment glBindBufferRange needs for uniform blocks
+static inline size_t StreamBuffer_UniformAlignment()
+{
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return (size_t)alignment;
+}
+
+// frame_size is the most bytes a single frame will allocate, rounded up so every region
+// starts on a uniform buffer offset boundary
+static inline void StreamBuffer_Init(StreamBuffer& stream, size_t frame_size)
+{
+    size_t granularity = StreamBuffer_UniformAlignment();
+    if (granularity < 256) granularity = 256;
+    frame_size = (frame_size + granularity - 1) / granularity * granularity;
+
+    stream.frame_size = frame_size;
+    stream.frame = 0;
+    stream.head = 0;
+    stream.persistent = GLExt_Caps().buffer_storage;
+
+    glGenBuffers(1, &stream.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+
+    if (stream.persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glext::BufferStorage(GL_COPY_WRITE_BUFFER, frame_size * STREAM_FRAMES, NULL, flags);
+        stream.mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frame_size * STREAM_FRAMES, flags);
+
+        if (!stream.mapped)
+        {
+            std::cout << "Persistent mapping failed, streaming falls back to orphaning" << std::endl;
+            glDeleteBuffers(1, &stream.buffer);
+            glGenBuffers(1, &stream.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+            stream.persistent = false;
+        }
+    }
+
+    if (!stream.persistent)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, frame_size, NULL, GL_STREAM_DRAW);
+        stream.mapped = nullptr;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// moves to the next region, waiting only if the GPU is still three frames behind
+static inline void StreamBuffer_BeginFrame(StreamBuffer& stream)
+{
+    stream.head = 0;
+
+    if (stream.persistent)
+    {
+        stream.frame = (stream.frame + 1) % STREAM_FRAMES;
+        stream_detail::Wait(stream.fences[stream.frame]);
+        return;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, stream.frame_size, NULL, GL_STREAM_DRAW);
+    stream.mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, stream.frame_size,
+                                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// bump allocates bytes from this frame, alignment must be a power of two
+// and applies to the offset into the whole buffer
+static inline StreamAllocation StreamBuffer_Alloc(StreamBuffer& stream, size_t bytes, size_t alignment = 16)
+{
+    size_t region = stream.persistent ? (size_t)stream.frame * stream.frame_size : 0;
+    size_t start = ((region + stream.head + alignment - 1) & ~(alignment - 1)) - region;
+    if (!stream.mapped || start + bytes > stream.frame_size)
+    {
+        std::cout << "Stream buffer out of space for this frame" << std::endl;
+        return {nullptr, 0};
+    }
+
+    stream.head = start + bytes;
+    return {stream.mapped + region + start, region + start};
+}
+
+// makes this frame's writes visible, call before drawing from the buffer
+static inline void StreamBuffer_Commit(StreamBuffer& stream)
+{
+    // coherent persistent writes are visible to commands issued afterwards
+    if (stream.persistent || !stream.mapped) return;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    stream.mapped = nullptr;
+}
+
+// fences the region after the frame's last draw that reads it
+static inline void StreamBuffer_EndFrame(StreamBuffer& stream)
+{
+    if (!stream.persistent) return;
+
+    if (stream.fences[stream.frame]) glDeleteSync(stream.fences[stream.frame]);
+    stream.fences[stream.frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+static inline void StreamBuffer_Delete(StreamBuffer& stream)
+{
+    for (GLsync& fence : stream.fences) stream_detail::Wait(fence);
+
+    if (stream.buffer)
+    {
+        if (stream.mapped)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &stream.buffer);
+    }
+
+    stream.buffer = 0;
+    stream.mapped = nullptr;
+}
+
+#endif
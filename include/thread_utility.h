@@ -0,0 +1,49 @@
+#ifndef THREAD_UTILITY_H
+#define THREAD_UTILITY_H
+
+#include <thread>
+#include <vector>
+#include <stddef.h>
+
+// number of hardware threads, never less than 1
+static inline unsigned int Thread_Count()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// splits [0, count) into contiguous ranges of at least min_grain items and calls
+// fn(begin, end) for each range, one range per thread
+// the calling thread runs the first range itself and joins the rest before returning
+template <typename Fn>
+static inline void Thread_ParallelFor(size_t count, size_t min_grain, Fn&& fn)
+{
+    if (count == 0) return;
+    if (min_grain == 0) min_grain = 1;
+
+    size_t ranges = count / min_grain;
+    if (ranges > Thread_Count()) ranges = Thread_Count();
+    if (ranges <= 1)
+    {
+        fn((size_t)0, count);
+        return;
+    }
+
+    size_t per_range = (count + ranges - 1) / ranges;
+
+    std::vector<std::thread> workers;
+    workers.reserve(ranges - 1);
+    for (size_t r = 1; r < ranges; ++r)
+    {
+        size_t begin = r * per_range;
+        size_t end = begin + per_range < count ? begin + per_range : count;
+        if (begin >= end) break;
+        workers.emplace_back([&fn, begin, end]() { fn(begin, end); });
+    }
+
+    fn((size_t)0, per_range < count ? per_range : count);
+
+    for (std::thread& worker : workers) worker.join();
+}
+
+#endif
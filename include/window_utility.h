@@ -7,6 +7,7 @@
 #include <string>
 
 #include "math_utility.h"
+#include "glext_utility.h"
 
 static inline void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -35,31 +36,66 @@ static inline Window Window_Init(int w, int h, float fov, std::string t)
     return window;
 }
 
+namespace window_detail
+{
+    static inline int Create(Window& window, int major, int minor, bool visible)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+        window.w = glfwCreateWindow(window.width, window.height, window.title.c_str(), NULL, NULL);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        return window.w ? 0 : -1;
+    }
+
+    static inline int Load(Window& window)
+    {
+        glfwMakeContextCurrent(window.w);
+
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+
+        GLExt_Load();
+
+        glfwSetFramebufferSizeCallback(window.w, framebuffer_size_callback);
+
+        return 0;
+    }
+}
+
 static inline int Window_Generate(Window& window)
 {
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    window.w = glfwCreateWindow(window.width, window.height, window.title.c_str(), NULL, NULL);
-    if (window.w == NULL)
+    if (window_detail::Create(window, 3, 3, true) == -1)
     {
         std::cout << "Failed ot create GLFW window" << std::endl;
         glfwTerminate();
         return -1;
     }
-    glfwMakeContextCurrent(window.w);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    return window_detail::Load(window);
+}
+
+// hidden window for tools and batch jobs, asks for 4.3 so compute shaders are core
+// falls back to 3.3 (compute then depends on GLExt_Caps().compute)
+static inline int Window_GenerateHeadless(Window& window)
+{
+    glfwInit();
+
+    if (window_detail::Create(window, 4, 3, false) == -1 && window_detail::Create(window, 3, 3, false) == -1)
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+        std::cout << "Failed to create hidden GLFW window" << std::endl;
+        glfwTerminate();
         return -1;
     }
 
-    glfwSetFramebufferSizeCallback(window.w, framebuffer_size_callback);
-
-    return 0;
+    return window_detail::Load(window);
 }
 
 static inline bool Window_ShouldClose(Window window)
@@ -0,0 +1,6 @@
+#version 330 core
+
+// depth only, colour writes are off while this runs
+void main()
+{
+}
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProjection;
+
+#ifdef QUANTIZED
+uniform vec3 uQuantMin;
+uniform vec3 uQuantExtent;
+#endif
+
+// the colour pass tests GL_EQUAL against this depth, both must compute it the same way
+invariant gl_Position;
+
+void main()
+{
+#ifdef QUANTIZED
+    vec3 position = uQuantMin + aPos * uQuantExtent;
+    gl_Position = uProjection * uView * uModel * vec4(position, 1.0);
+#else
+    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0);
+#endif
+}
@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 7) in uint aDrawID;
+
+// per draw data, 5 texels per draw: model matrix columns then colour
+uniform samplerBuffer uDrawData;
+uniform int uDrawBase;
+
+uniform mat4 uView;
+uniform mat4 uProjection;
+
+flat out vec4 vColor;
+
+invariant gl_Position;     // see depth_prepass_utility.h
+
+void main()
+{
+    int base = (int(aDrawID) - uDrawBase) * 5;
+    mat4 model = mat4(texelFetch(uDrawData, base),
+                      texelFetch(uDrawData, base + 1),
+                      texelFetch(uDrawData, base + 2),
+                      texelFetch(uDrawData, base + 3));
+
+    vColor = texelFetch(uDrawData, base + 4);
+    gl_Position = uProjection * uView * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+#include "shadow.glsl"
+
+uniform vec4 uColor;
+uniform vec3 uLightDirection;       // the way the light travels
+
+in vec3 vWorldPosition;
+in vec3 vNormal;
+in float vViewDepth;
+out vec4 FragColor;
+
+void main()
+{
+    // flat shapes are seen from both sides
+    vec3 normal = normalize(gl_FrontFacing ? vNormal : -vNormal);
+    float diffuse = max(dot(normal, -uLightDirection), 0.0);
+    if (diffuse > 0.0) diffuse *= ShadowVisibility(vWorldPosition, vViewDepth);
+
+    FragColor = vec4(uColor.rgb * (0.35 + 0.65 * diffuse), uColor.a);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProjection;
+
+out vec3 vWorldPosition;
+out vec3 vNormal;
+out float vViewDepth;
+
+invariant gl_Position;     // see depth_prepass_utility.h
+
+void main()
+{
+    vec4 world = uModel * vec4(aPos, 1.0);
+    vWorldPosition = world.xyz;
+    vNormal = mat3(uModel) * aNormal;       // models are only uniformly scaled
+    vViewDepth = -(uView * world).z;
+    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0);
+}
@@ -0,0 +1,11 @@
+// per material parameters, laid out like MaterialParams in material_utility.h
+struct MaterialParams
+{
+    vec4 colour;
+    vec4 params[3];
+};
+
+layout (std140) uniform Materials
+{
+    MaterialParams uMaterials[256];     // MATERIAL_PAGE_SIZE, one page is bound at a time
+};
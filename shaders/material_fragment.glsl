@@ -0,0 +1,10 @@
+#version 330 core
+#include "material.glsl"
+
+flat in uint vMaterial;
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = uMaterials[vMaterial].colour;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 6) in uint aMaterial;
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProjection;
+
+flat out uint vMaterial;
+
+invariant gl_Position;     // see depth_prepass_utility.h
+
+void main()
+{
+    vMaterial = aMaterial;
+    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0);
+}
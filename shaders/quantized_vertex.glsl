@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;     // 16 bit unorm, 0..1 across the mesh bounds
+
+uniform vec3 uQuantMin;
+uniform vec3 uQuantExtent;
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProjection;
+
+invariant gl_Position;     // see depth_prepass_utility.h
+
+void main()
+{
+    vec3 position = uQuantMin + aPos * uQuantExtent;
+    gl_Position = uProjection * uView * uModel * vec4(position, 1.0);
+}
@@ -0,0 +1,25 @@
+// cascaded shadow lookup, the uniforms come from Shadow_SetUniforms in shadow_utility.h
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[4];    // SHADOW_MAX_CASCADES, world to shadow map space
+uniform vec4 uCascadeSplits;        // far view distance of each cascade
+uniform int uCascadeCount;
+
+// 1 lit, 0 shadowed; view_depth is the distance in front of the camera
+float ShadowVisibility(vec3 world_position, float view_depth)
+{
+    int cascade = 0;
+    while (cascade < uCascadeCount - 1 && view_depth > uCascadeSplits[cascade]) cascade++;
+    if (view_depth > uCascadeSplits[uCascadeCount - 1]) return 1.0;
+
+    vec3 coord = (uShadowMatrices[cascade] * vec4(world_position, 1.0)).xyz;
+    if (coord.z >= 1.0) return 1.0;
+
+    // four compared taps half a texel apart, each already filtered 2x2 by the hardware
+    vec2 texel = 0.5 / vec2(textureSize(uShadowMap, 0).xy);
+    float lit = 0.0;
+    lit += texture(uShadowMap, vec4(coord.xy + vec2(-texel.x, -texel.y), float(cascade), coord.z));
+    lit += texture(uShadowMap, vec4(coord.xy + vec2( texel.x, -texel.y), float(cascade), coord.z));
+    lit += texture(uShadowMap, vec4(coord.xy + vec2(-texel.x,  texel.y), float(cascade), coord.z));
+    lit += texture(uShadowMap, vec4(coord.xy + vec2( texel.x,  texel.y), float(cascade), coord.z));
+    return lit * 0.25;
+}
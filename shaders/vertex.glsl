@@ -5,6 +5,8 @@ uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProjection;
 
+invariant gl_Position;     // see depth_prepass_utility.h
+
 void main()
 {
     // gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <string.h>
+#include "obj_utility.h"
+#include "mesh_cache_utility.h"
+#include "mesh_process_utility.h"
+
+// offline asset cook step, converts source meshes into the binary mesh cache
+// usage: ./Cook [--strip] input.obj output.gbm
+
+int main(int argc, char** argv)
+{
+    bool strip = argc == 4 && strcmp(argv[1], "--strip") == 0;
+    if (argc != 3 && !strip)
+    {
+        std::cout << "usage: " << argv[0] << " [--strip] input.obj output.gbm" << std::endl;
+        return -1;
+    }
+
+    const char* input = argv[argc - 2];
+    const char* output = argv[argc - 1];
+
+    try
+    {
+        Mesh mesh;
+        Obj_Load(mesh, input);
+
+        if (strip)
+        {
+            StripStats stats;
+            int result = MeshProcess_Stripify(mesh, &stats);
+            if (result >= 0)
+            {
+                std::cout << "strips: " << stats.list_indices << " -> " << stats.strip_indices << " indices in "
+                          << stats.strips << " strips" << (result == 1 ? ", kept the list" : "") << std::endl;
+            }
+        }
+
+        MeshCache_Write(mesh, output);
+
+        std::cout << output << ": " << Mesh_VertexCount(mesh) << " vertices, "
+                  << mesh.indices.size() << " indices" << std::endl;
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -12,21 +12,45 @@ int main(void)
         return -1;
     }
 
-    // Create shader
+    // Linked programs are kept here, warm runs skip compiling
+    Shader_SetCacheDirectory("shader_cache");
+
+    // Create shader, rebuilt whenever its files are saved
+    ShaderReloader reloader;
+    ShaderReload_Init(reloader);
+
     Shader shader;
-    Shader_Init(shader, "shaders/vertex.glsl", "shaders/fragment.glsl");
+    ShaderReload_Watch(reloader, shader, "shaders/vertex.glsl", "shaders/fragment.glsl");
+
+    // Lit and shadowed shader for the solid surfaces
+    Shader lit;
+    ShaderReload_Watch(reloader, lit, "shaders/lit_vertex.glsl", "shaders/lit_fragment.glsl");
 
-    // Enable depth testing
+    // Enable depth testing, opaque draws go through a depth pre-pass
     Window_EnableDepthTesting();
 
-    // Create a triangle
+    DepthPrepass prepass;
+    DepthPrepass_Init(prepass);
+
+    // Passes are described every frame, render targets are kept between frames
+    FrameGraph graph;
+
+    // Sun shadows, four cascades over the first 60 units
+    ShadowMap shadows;
+    Shadow_SetLight(shadows, {-0.4f, -1.0f, -0.3f});
+    shadows.max_distance = 60.0f;
+    Shadow_Init(shadows, 2048, 4);
+
+    // Create a triangle, the lit shader needs normals and the simple shapes only have positions
     Mesh triangle;
     Mesh_SetTriangle(triangle);
+    MeshProcess_ComputeNormals(triangle, MESH_NORMALS_FLAT);
     Mesh_Generate(triangle);
 
     // Create a rectangle
     Mesh rectangle;
     Mesh_SetRectangle(rectangle);
+    MeshProcess_ComputeNormals(rectangle, MESH_NORMALS_FLAT);
     Mesh_Generate(rectangle);
 
     // Create a circle
@@ -37,6 +61,7 @@ int main(void)
     // Create a cube
     Mesh cube;
     Mesh_SetCube(cube);
+    MeshProcess_ComputeNormals(cube, MESH_NORMALS_FLAT);
     Mesh_Generate(cube);
 
     // Create a sphere
@@ -44,6 +69,11 @@ int main(void)
     Mesh_SetSphere(sphere, 1.0f, 24, 48);
     Mesh_Generate(sphere);
 
+    // Create a ground plane
+    Mesh ground;
+    Mesh_SetPlane(ground, 40.0f, 40.0f, 1, 1);
+    Mesh_Generate(ground);
+
     // Create the camera
     Camera camera;
     Camera_Init(camera, 5.0f, 90.0f, {0.0f, 0.0f, 0.0f});
@@ -52,134 +82,131 @@ int main(void)
     while (Window_ShouldClose(window))
     {
         Time_Update();
+        ShaderReload_Poll(reloader);
 
         // Update the camera
         Camera_Update(window, camera, Time_Delta());
 
-        Window_Clear(Colour::White);
+        Matrix4 view = Camera_ViewMatrix(camera);
+        Matrix4 projection = Math_ProjectionMatrix(window.fov, window.aspect, 0.1f, 100.0f);
+        Matrix4 ground_model = Math_Mat4Translate({0.0f,-3.0f,0.0f});
 
-        // Drawing the rectangle
+        // Placing the rectangle
         Transform_PushMatrix();
-
-            // Perform transformations here
             Transform_Translate({-5.0f,0.0f,0.0f});
             Transform_Rotate(Math_DegToRad(45.0f)*Time_Total(), {0,1,0});
-
-            Shader_Enable(shader);
-
-            // model, view, projection
-            Shader_SetUniformMat4(shader, "uModel",      Transform_ModelMatrix());
-            Shader_SetUniformMat4(shader, "uView",       Camera_ViewMatrix(camera));
-            Shader_SetUniformMat4(shader, "uProjection", Math_ProjectionMatrix(window.fov, window.aspect, 0.1f, 100.0f));
-
-            Shader_SetUniform4f(shader, "uColor", Colour::SteelBlue);
-            Mesh_Draw(rectangle);
-            Shader_SetUniform4f(shader, "uColor", Colour::DarkGray);
-            Mesh_DrawWireFrame(rectangle);
-            Shader_Disable();
-
+            Matrix4 rectangle_model = Transform_ModelMatrix();
         Transform_PopMatrix();
 
-        // Drawing the triangle
+        // Placing the triangle
         Transform_PushMatrix();
-
             Transform_Translate({5.0f,0.0f,0.0f});
             Transform_Rotate(Math_DegToRad(30.0f)*Time_Total(), {1,1,0});
-
-            Shader_Enable(shader);
-
-            // model, view, projection
-            Shader_SetUniformMat4(shader, "uModel",      Transform_ModelMatrix());
-            Shader_SetUniformMat4(shader, "uView",       Camera_ViewMatrix(camera));
-            Shader_SetUniformMat4(shader, "uProjection", Math_ProjectionMatrix(window.fov, window.aspect, 0.1f, 100.0f));
-
-            Shader_SetUniform4f(shader, "uColor", Colour::DeepPink);
-            Mesh_Draw(triangle);
-            Shader_SetUniform4f(shader, "uColor", Colour::DarkGray);
-            Mesh_DrawWireFrame(triangle);
-
-            Shader_Disable();
-
+            Matrix4 triangle_model = Transform_ModelMatrix();
         Transform_PopMatrix();
 
-        // Drawing the circle
+        // Placing the circle
         Transform_PushMatrix();
-
             Transform_Translate({2.0f,0.0f,7.0f});
             Transform_Rotate(Math_DegToRad(50.0f)*Time_Total(), {0,1,1});
-
-            Shader_Enable(shader);
-
-            // model, view, projection
-            Shader_SetUniformMat4(shader, "uModel",      Transform_ModelMatrix());
-            Shader_SetUniformMat4(shader, "uView",       Camera_ViewMatrix(camera));
-            Shader_SetUniformMat4(shader, "uProjection", Math_ProjectionMatrix(window.fov, window.aspect, 0.1f, 100.0f));
-
-            Shader_SetUniform4f(shader, "uColor", Colour::Crimson);
-            Mesh_Draw(circle);
-            Shader_SetUniform4f(shader, "uColor", Colour::DarkGray);
-            Mesh_DrawWireFrame(circle);
-
-            Shader_Disable();
-
+            Matrix4 circle_model = Transform_ModelMatrix();
         Transform_PopMatrix();
 
-        // Drawing the cube
+        // Placing the cube
         Transform_PushMatrix();
-
             Transform_Translate({0.0f,0.0f,-10.0f});
             Transform_Rotate(Math_DegToRad(25.0f)*Time_Total(), {1,1,1});
-
-            Shader_Enable(shader);
-
-            // model, view, projection
-            Shader_SetUniformMat4(shader, "uModel",      Transform_ModelMatrix());
-            Shader_SetUniformMat4(shader, "uView",       Camera_ViewMatrix(camera));
-            Shader_SetUniformMat4(shader, "uProjection", Math_ProjectionMatrix(window.fov, window.aspect, 0.1f, 100.0f));
-
-            Shader_SetUniform4f(shader, "uColor", Colour::Turquoise);
-            Mesh_Draw(cube);
-            Shader_SetUniform4f(shader, "uColor", Colour::Black);
-            Mesh_DrawWireFrame(cube);
-
-            Shader_Disable();
-
+            Matrix4 cube_model = Transform_ModelMatrix();
         Transform_PopMatrix();
 
-        // Drawing the sphere
+        // Placing the sphere
         Transform_PushMatrix();
-
             Transform_Translate({0.0f,0.0f,10.0f});
+            Matrix4 sphere_model = Transform_ModelMatrix();
+        Transform_PopMatrix();
 
+        // Shadow casters, each cascade keeps the ones that can shadow what it covers
+        Shadow_Begin(shadows);
+        Shadow_AddCaster(shadows, rectangle, rectangle_model);
+        Shadow_AddCaster(shadows, triangle,  triangle_model);
+        Shadow_AddCaster(shadows, circle,    circle_model);
+        Shadow_AddCaster(shadows, cube,      cube_model);
+        Shadow_AddCaster(shadows, sphere,    sphere_model);
+        Shadow_Update(shadows, camera, window.fov, window.aspect, 0.1f, 100.0f);
+
+        // The frame, shadow cascades and then the scene into the window
+        FrameGraph_Begin(graph);
+        unsigned int backbuffer = FrameGraph_ImportBackbuffer(graph);
+        unsigned int shadow_map = Shadow_AddPasses(shadows, graph);
+
+        unsigned int scene = FrameGraph_AddPass(graph, "scene", [&](FrameGraph&)
+        {
+            Shader_Enable(lit);
+            Shadow_SetUniforms(shadows, lit, 0);
+
+            // Solid surfaces, depth first and then colour with each pixel shaded once
+            DepthPrepass_Begin(prepass);
+            DepthPrepass_Add(prepass, lit, ground,    ground_model,    Colour::LightGray);
+            DepthPrepass_Add(prepass, lit, rectangle, rectangle_model, Colour::SteelBlue);
+            DepthPrepass_Add(prepass, lit, triangle,  triangle_model,  Colour::DeepPink);
+            DepthPrepass_Add(prepass, lit, circle,    circle_model,    Colour::Crimson);
+            DepthPrepass_Add(prepass, lit, cube,      cube_model,      Colour::Turquoise);
+            DepthPrepass_Add(prepass, lit, sphere,    sphere_model,    Colour::Gold);
+            DepthPrepass_Submit(prepass, view, projection);
+
+            // Wireframes on top
             Shader_Enable(shader);
 
-            // model, view, projection
-            Shader_SetUniformMat4(shader, "uModel",      Transform_ModelMatrix());
-            Shader_SetUniformMat4(shader, "uView",       Camera_ViewMatrix(camera));
-            Shader_SetUniformMat4(shader, "uProjection", Math_ProjectionMatrix(window.fov, window.aspect, 0.1f, 100.0f));
+                Shader_SetUniformMat4(shader, "uView",       view);
+                Shader_SetUniformMat4(shader, "uProjection", projection);
 
-            Shader_SetUniform4f(shader, "uColor", Colour::Gold);
-            Mesh_Draw(sphere);
-            Shader_SetUniform4f(shader, "uColor", Colour::Bronze);
-            Mesh_DrawWireFrame(sphere);
+                Shader_SetUniformMat4(shader, "uModel", rectangle_model);
+                Shader_SetUniform4f(shader, "uColor", Colour::DarkGray);
+                Mesh_DrawWireFrame(rectangle);
 
-            Shader_Disable();
+                Shader_SetUniformMat4(shader, "uModel", triangle_model);
+                Shader_SetUniform4f(shader, "uColor", Colour::DarkGray);
+                Mesh_DrawWireFrame(triangle);
 
-        Transform_PopMatrix();
+                Shader_SetUniformMat4(shader, "uModel", circle_model);
+                Shader_SetUniform4f(shader, "uColor", Colour::DarkGray);
+                Mesh_DrawWireFrame(circle);
 
+                Shader_SetUniformMat4(shader, "uModel", cube_model);
+                Shader_SetUniform4f(shader, "uColor", Colour::Black);
+                Mesh_DrawWireFrame(cube);
+
+                Shader_SetUniformMat4(shader, "uModel", sphere_model);
+                Shader_SetUniform4f(shader, "uColor", Colour::Bronze);
+                Mesh_DrawWireFrame(sphere);
+
+            Shader_Disable();
+        });
+        FrameGraph_Read(graph, scene, shadow_map);
+        FrameGraph_Write(graph, scene, backbuffer, FRAME_GRAPH_CLEAR);
+        FrameGraph_SetClear(graph, scene, Colour::White);
+
+        FrameGraph_Execute(graph);
 
         Window_PollEvents();
         Window_SwapBuffers(window);
     }
 
     // Here we delete any meshes, shaders, and the window
+    ShaderReload_Delete(reloader);
     Shader_Delete(shader);
+    Shader_Delete(lit);
+
+    FrameGraph_Delete(graph);
+    Shadow_Delete(shadows);
+    DepthPrepass_Delete(prepass);
 
     Mesh_Delete(triangle);
     Mesh_Delete(rectangle);
     Mesh_Delete(cube);
     Mesh_Delete(sphere);
     Mesh_Delete(circle);
+    Mesh_Delete(ground);
 
     Window_Delete();
 